@@ -0,0 +1,152 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Actor send() -> process() throughput, a token ring and the cost of
+// a million idle actors.
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_actor.hpp"
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+static std::atomic<uint64_t> processed{0};
+
+class Hop: public tec::Actor<> {
+public:
+    Hop* next{nullptr};
+
+protected:
+    void process(const tec::Message& msg) override {
+        processed.fetch_add(1, std::memory_order_release);
+        // Pass the token on, `command` is the hops left.
+        if( next && msg.command > 1 ) {
+            next->send({msg.command - 1});
+        }
+    }
+};
+
+
+static void wait_processed(uint64_t target) {
+    while( processed.load(std::memory_order_acquire) < target ) {
+        std::this_thread::yield();
+    }
+}
+
+
+//! Resident set size in bytes.
+static uint64_t rss() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size{0}, resident{0};
+    statm >> size >> resident;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("actor", argc, argv);
+
+    {
+        tec::ActorSystemParams params;
+        params.name = "bench_actor";
+        tec::ActorSystem system{params};
+
+        auto* single = system.spawn<Hop>();
+        std::vector<Hop*> ring;
+        for( size_t i = 0; i < 1000; ++i ) {
+            ring.push_back(system.spawn<Hop>());
+        }
+        for( size_t i = 0; i < ring.size(); ++i ) {
+            ring[i]->next = ring[(i + 1) % ring.size()];
+        }
+        system.run();
+
+        suite.run_batch("Actor/throughput", [single](uint64_t n) {
+            const uint64_t target = processed.load() + n;
+            for( uint64_t i = 0; i < n; ++i ) {
+                single->send({1});
+            }
+            wait_processed(target);
+        });
+
+        suite.run_batch("Actor/ring of 1000 (per hop)", [&ring](uint64_t n) {
+            const uint64_t target = processed.load() + n;
+            ring[0]->send({n});
+            wait_processed(target);
+        });
+
+        suite.run_batch("Actor/fan-out to 1000", [&ring](uint64_t n) {
+            const uint64_t target = processed.load() + n;
+            for( uint64_t i = 0; i < n; ++i ) {
+                ring[i % ring.size()]->send({1});
+            }
+            wait_processed(target);
+        });
+
+        system.terminate();
+    }
+
+    // A million actors: spawn, one message each, terminate.
+    {
+        constexpr size_t kActors{1000000};
+        tec::ActorSystemParams params;
+        params.name = "bench_actor_1m";
+        tec::ActorSystem system{params};
+        system.run();
+        const size_t threads = system.threads();
+
+        const uint64_t rss0 = rss();
+        tec::BasicStopwatch<tec::MonoClock> sw;
+        std::vector<Hop*> actors;
+        actors.reserve(kActors);
+        for( size_t i = 0; i < kActors; ++i ) {
+            actors.push_back(system.spawn<Hop>());
+        }
+        const uint64_t t_spawn = sw.lap();
+        const uint64_t target = processed.load() + kActors;
+        for( auto* actor: actors ) {
+            actor->send({1});
+        }
+        wait_processed(target);
+        const uint64_t t_send = sw.lap();
+        const uint64_t bytes = rss() - rss0;
+        system.terminate();
+        const uint64_t t_terminate = sw.lap();
+
+        tec::println("1M actors on {} threads: spawn {} ms, send+process {} ms, terminate {} ms",
+                     threads, t_spawn / 1000000, t_send / 1000000, t_terminate / 1000000);
+        tec::println("idle footprint: {} bytes/actor RSS, sizeof(Actor<>)={}",
+                     bytes / kActors, sizeof(tec::Actor<>));
+    }
+
+    return suite.finish();
+}
@@ -0,0 +1,68 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Building a 16 KiB frame from a header and a body, then cutting
+// it into 1 KiB chunks: std::string copies vs tec::Buffer slices.
+
+#include <string>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_buffer.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("buffer", argc, argv);
+    const std::string header(64, 'h');
+    const std::string body(16 * 1024, 'b');
+    constexpr size_t kChunk{1024};
+
+    suite.run("concat/std::string", [&] {
+        std::string frame = header + body;
+        tec::bench::do_not_optimize(frame);
+    });
+    const tec::Buffer bh = tec::Buffer::copy(header);
+    const tec::Buffer bb = tec::Buffer::copy(body);
+    suite.run("concat/Buffer", [&] {
+        tec::Buffer frame = bh + bb;
+        tec::bench::do_not_optimize(frame);
+    });
+
+    const std::string sframe = header + body;
+    suite.run("chunk/std::string", [&] {
+        for( size_t off = 0; off < sframe.size(); off += kChunk ) {
+            std::string chunk = sframe.substr(off, kChunk);
+            tec::bench::do_not_optimize(chunk);
+        }
+    });
+    const tec::Buffer bframe = bh + bb;
+    suite.run("chunk/Buffer", [&] {
+        for( size_t off = 0; off < bframe.size(); off += kChunk ) {
+            tec::Buffer chunk = bframe.slice(off, kChunk);
+            tec::bench::do_not_optimize(chunk);
+        }
+    });
+
+    return suite.finish();
+}
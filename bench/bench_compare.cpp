@@ -0,0 +1,265 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *  Compares two runs of a benchmark suite (see tec_bench.hpp) and fails
+ *  if anything got slower by more than a threshold:
+ *
+ *      bench_compare [--threshold=5] [--alpha=0.05] [--resamples=2000] OLD.json NEW.json
+ *
+ *  For every benchmark present in both files it reports the change of
+ *  the median with a bootstrap 95% confidence interval and
+ *  the Mann-Whitney U test p-value. A benchmark is a regression if it is
+ *  significantly slower (p < alpha) and the lower bound of the interval
+ *  exceeds the threshold, so noise alone does not fail the gate.
+ *
+ *  Exit code: 0 OK, 1 regression(s) found, 2 usage or input error.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Statistics
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+double median(std::vector<double> v) {
+    return tec::bench::stats_of(std::move(v)).median;
+}
+
+
+// Bootstrap CI of the relative change of the median, in percent.
+std::pair<double, double> bootstrap_ci(const std::vector<double>& a, const std::vector<double>& b,
+                                       size_t resamples, std::mt19937_64& rng) {
+    std::vector<double> deltas;
+    deltas.reserve(resamples);
+    std::vector<double> ra(a.size());
+    std::vector<double> rb(b.size());
+    std::uniform_int_distribution<size_t> pick_a(0, a.size() - 1);
+    std::uniform_int_distribution<size_t> pick_b(0, b.size() - 1);
+    for( size_t i = 0; i < resamples; ++i ) {
+        for( auto& x: ra ) x = a[pick_a(rng)];
+        for( auto& x: rb ) x = b[pick_b(rng)];
+        const double ma = median(ra);
+        if( ma > 0 ) {
+            deltas.push_back((median(rb) - ma) / ma * 100.0);
+        }
+    }
+    if( deltas.empty() ) {
+        return {0.0, 0.0};
+    }
+    std::sort(deltas.begin(), deltas.end());
+    const auto at = [&deltas](double q) {
+        return deltas[std::min(deltas.size() - 1, static_cast<size_t>(q * static_cast<double>(deltas.size())))];
+    };
+    return {at(0.025), at(0.975)};
+}
+
+
+// Two-sided Mann-Whitney U test, normal approximation with tie correction.
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    const size_t n1 = a.size();
+    const size_t n2 = b.size();
+    std::vector<std::pair<double, int>> all;
+    all.reserve(n1 + n2);
+    for( double x: a ) all.emplace_back(x, 0);
+    for( double x: b ) all.emplace_back(x, 1);
+    std::sort(all.begin(), all.end());
+
+    double rank_a{0};
+    double ties{0};
+    for( size_t i = 0; i < all.size(); ) {
+        size_t j = i;
+        while( j < all.size() && all[j].first == all[i].first ) ++j;
+        const double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2.0;
+        const double t = static_cast<double>(j - i);
+        ties += t * t * t - t;
+        for( size_t k = i; k < j; ++k ) {
+            if( all[k].second == 0 ) rank_a += rank;
+        }
+        i = j;
+    }
+    const double N1 = static_cast<double>(n1);
+    const double N2 = static_cast<double>(n2);
+    const double N = N1 + N2;
+    const double u = rank_a - N1 * (N1 + 1) / 2.0;
+    const double mean = N1 * N2 / 2.0;
+    const double var = N1 * N2 / 12.0 * ((N + 1) - ties / (N * (N - 1)));
+    if( var <= 0 ) {
+        return 1.0;
+    }
+    const double z = (std::fabs(u - mean) - 0.5) / std::sqrt(var);
+    return std::erfc(std::max(0.0, z) / std::sqrt(2.0));
+}
+
+
+std::string ci(double lo, double hi) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "[%+.1f, %+.1f]", lo, hi);
+    return buf;
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                              MAIN
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct CompareParams {
+    double threshold{5.0};   // %
+    double alpha{0.05};
+    size_t resamples{2000};
+    uint64_t seed{42};
+    std::string old_path;
+    std::string new_path;
+};
+
+
+tec::Result parse(int argc, char* argv[], CompareParams& params) {
+    std::vector<std::string> files;
+    for( int i = 1; i < argc; ++i ) {
+        const std::string arg{argv[i]};
+        const auto eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string val = (eq == std::string::npos) ? std::string{} : arg.substr(eq + 1);
+        if( key == "--threshold" ) {
+            params.threshold = std::strtod(val.c_str(), nullptr);
+        }
+        else if( key == "--alpha" ) {
+            params.alpha = std::strtod(val.c_str(), nullptr);
+        }
+        else if( key == "--resamples" ) {
+            params.resamples = std::max<size_t>(100, std::strtoul(val.c_str(), nullptr, 10));
+        }
+        else if( key == "--seed" ) {
+            params.seed = std::strtoull(val.c_str(), nullptr, 10);
+        }
+        else if( arg.compare(0, 2, "--") == 0 ) {
+            return {tec::format("unknown argument \"{}\"", arg), tec::Result::Kind::Invalid};
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+    if( files.size() != 2 ) {
+        return {"usage: bench_compare [--threshold=PCT] [--alpha=P] [--resamples=N] [--seed=N] OLD.json NEW.json",
+                tec::Result::Kind::Invalid};
+    }
+    params.old_path = files[0];
+    params.new_path = files[1];
+    return {};
+}
+
+
+int main(int argc, char* argv[]) {
+    CompareParams params;
+    if( auto result = parse(argc, argv, params); !result ) {
+        std::cerr << result.desc.value_or("") << "\n";
+        return 2;
+    }
+
+    auto old_reports = tec::bench::load_reports(params.old_path);
+    auto new_reports = tec::bench::load_reports(params.new_path);
+    for( const auto* loaded: {&old_reports, &new_reports} ) {
+        if( !*loaded ) {
+            std::cerr << loaded->error() << "\n";
+            return 2;
+        }
+    }
+
+    std::map<std::string, const tec::bench::Report*> old_by_name;
+    for( const auto& r: *old_reports ) {
+        old_by_name[r.name] = &r;
+    }
+
+    std::mt19937_64 rng(params.seed);
+    int regressions{0};
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right
+              << std::setw(12) << "old" << std::setw(12) << "new"
+              << std::setw(10) << "delta%" << std::setw(22) << "95% CI" << std::setw(10) << "p"
+              << "  verdict\n";
+    std::cout << std::fixed;
+    for( const auto& nr: *new_reports ) {
+        auto it = old_by_name.find(nr.name);
+        if( it == old_by_name.end() ) {
+            std::cout << std::left << std::setw(40) << nr.name << std::right << "  (new)\n";
+            continue;
+        }
+        const auto& orp = *it->second;
+        old_by_name.erase(it);
+        if( orp.samples.size() < 2 || nr.samples.size() < 2 ) {
+            std::cout << std::left << std::setw(40) << nr.name << std::right << "  (not enough samples)\n";
+            continue;
+        }
+
+        const double mo = orp.stats.median;
+        const double mn = nr.stats.median;
+        const double delta = mo > 0 ? (mn - mo) / mo * 100.0 : 0.0;
+        const auto [lo, hi] = bootstrap_ci(orp.samples, nr.samples, params.resamples, rng);
+        const double p = mann_whitney_p(orp.samples, nr.samples);
+
+        const char* verdict = "same";
+        if( p < params.alpha ) {
+            if( delta > 0 && lo > params.threshold ) {
+                verdict = "REGRESSION";
+                ++regressions;
+            }
+            else {
+                verdict = (delta > 0) ? "slower" : "faster";
+            }
+        }
+        std::cout << std::left << std::setw(40) << nr.name << std::right << std::setprecision(1)
+                  << std::setw(12) << mo << std::setw(12) << mn
+                  << std::setw(10) << std::showpos << delta << std::noshowpos
+                  << std::setw(22) << ci(lo, hi)
+                  << std::setprecision(4) << std::setw(10) << p
+                  << "  " << verdict << "\n";
+    }
+    for( const auto& [name, _]: old_by_name ) {
+        std::cout << std::left << std::setw(40) << name << std::right << "  (removed)\n";
+    }
+
+    if( regressions ) {
+        std::cout << std::defaultfloat << regressions << " regression(s) over " << params.threshold << "%\n";
+        return 1;
+    }
+    return 0;
+}
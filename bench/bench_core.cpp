@@ -0,0 +1,83 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// tec::format, Tracer and Result construction.
+
+#include <string>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_sink.hpp"
+#include "tec/tec_trace.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("core", argc, argv);
+
+    // format()
+    suite.run("format/no args", [] {
+        tec::bench::do_not_optimize(tec::format("no arguments at all"));
+    });
+    suite.run("format/3 args", [] {
+        tec::bench::do_not_optimize(tec::format("int={} double={} str={}", 42, 3.14, "three"));
+    });
+
+    // Tracer, as TEC_ENTER/TEC_TRACE expand when _TEC_TRACE_ON is defined,
+    // into a sink that discards everything.
+    tec::NullSink null_sink;
+    suite.run("Tracer/enter", [&null_sink] {
+        tec::Tracer<> tracer("bench");
+        tracer.enter(&null_sink);
+    });
+    suite.run("Tracer/trace 2 args", [&null_sink] {
+        tec::Tracer<> tracer("bench");
+        tracer.trace(&null_sink, "count={} name={}.", 42, "bench");
+    });
+
+    // Result
+    suite.run("Result/ok", [] {
+        tec::Result r;
+        tec::bench::do_not_optimize(r);
+    });
+    suite.run("Result/code+literal", [] {
+        tec::Result r{42, "literal description", tec::Result::Kind::IOErr};
+        tec::bench::do_not_optimize(r);
+    });
+    const std::string desc{"a dynamic description longer than SSO buffers"};
+    suite.run("Result/code+string", [&desc] {
+        tec::Result r{42, desc, tec::Result::Kind::IOErr};
+        tec::bench::do_not_optimize(r);
+    });
+    const tec::Result dyn{42, desc, tec::Result::Kind::IOErr};
+    suite.run("Result/copy dynamic", [&dyn] {
+        tec::Result r{dyn};
+        tec::bench::do_not_optimize(r);
+    });
+    suite.run("Result/as_string", [&dyn] {
+        tec::bench::do_not_optimize(dyn.as_string());
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,81 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Fan-out of one event to 50 subscribers: per-subscriber copies vs EventBus.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_eventbus.hpp"
+#include "tec/tec_queue.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Event {
+    std::string payload;
+};
+
+constexpr size_t kSubscribers{50};
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("eventbus", argc, argv);
+    const Event event{std::string(256, 'x')};
+
+    // Baseline: every subscriber gets its own copy through its own queue.
+    std::vector<tec::SafeQueue<Event>> queues(kSubscribers);
+    suite.run("SafeQueue/copy x50", [&] {
+        for( auto& q: queues ) {
+            q.enqueue(event);
+        }
+        for( auto& q: queues ) {
+            tec::bench::do_not_optimize(q.dequeue());
+        }
+    });
+
+    tec::EventBus<Event> bus("bench");
+    std::vector<std::shared_ptr<tec::QueueMailbox<Event>>> mailboxes;
+    for( size_t i = 0; i < kSubscribers; ++i ) {
+        mailboxes.push_back(std::make_shared<tec::QueueMailbox<Event>>());
+        bus.subscribe("queue", mailboxes.back());
+    }
+    suite.run("EventBus/QueueMailbox x50", [&] {
+        bus.publish("queue", event);
+        for( auto& mb: mailboxes ) {
+            tec::bench::do_not_optimize(mb->pop());
+        }
+    });
+
+    // Nobody reads the rings: the publisher keeps dropping the oldest.
+    for( size_t i = 0; i < kSubscribers; ++i ) {
+        bus.subscribe("ring", std::make_shared<tec::RingMailbox<Event>>(64, "bench"));
+    }
+    suite.run("EventBus/RingMailbox x50/unread", [&] {
+        tec::bench::do_not_optimize(bus.publish("ring", event));
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,88 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// 4 KiB writes: blocking pwrite() vs IoWorker on io_uring and on threads.
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_io.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+constexpr size_t kBlock{4096};
+constexpr uint64_t kFileBlocks{1024};
+
+char block[kBlock];
+
+
+void io_writes(tec::IoWorker& io, int fd, uint64_t n) {
+    std::atomic<uint64_t> done{0};
+    for( uint64_t i = 0; i < n; ++i ) {
+        io.write(fd, block, kBlock, (i % kFileBlocks) * kBlock,
+                 [&done](const tec::IoCompletion&) { done.fetch_add(1, std::memory_order_release); });
+    }
+    while( done.load(std::memory_order_acquire) < n ) {
+        std::this_thread::yield();
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("io", argc, argv);
+
+    std::string path = "/tmp/tec_bench_io.XXXXXX";
+    const int fd = ::mkstemp(path.data());
+    if( fd < 0 ) {
+        return 1;
+    }
+
+    suite.run("pwrite/4KiB", [fd, i = uint64_t{0}]() mutable {
+        tec::bench::do_not_optimize(::pwrite(fd, block, kBlock, static_cast<off_t>((i++ % kFileBlocks) * kBlock)));
+    });
+
+    for( auto backend: {tec::IoBackend::Uring, tec::IoBackend::Threads} ) {
+        tec::IoParams params;
+        params.backend = backend;
+        tec::IoWorker io(params);
+        if( !io.run() ) {
+            continue;
+        }
+        const char* name = (backend == tec::IoBackend::Uring) ? "uring" : "threads";
+        suite.run_batch(tec::format("IoWorker/{}/write 4KiB", name), [&io, fd](uint64_t n) {
+            io_writes(io, fd, n);
+        });
+        io.terminate();
+    }
+
+    ::close(fd);
+    ::unlink(path.c_str());
+    return suite.finish();
+}
@@ -0,0 +1,106 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// A 40-byte payload sent to a Worker: in a std::string member
+// vs inline in a SmallMessage; and copying the messages.
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_message.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Params: tec::WorkerParams {};
+
+struct StringMessage {
+    tec::Message::cmd_t command;
+    std::string text;
+
+    bool quit() const { return command == tec::Message::QUIT; }
+};
+
+struct Text {
+    char data[40];
+};
+
+std::atomic<uint64_t> received{0};
+
+
+template <typename TMessage>
+class Receiver: public tec::Worker<Params, TMessage> {
+public:
+    Receiver(): tec::Worker<Params, TMessage>(Params{}) {}
+protected:
+    void process(const TMessage& msg) override {
+        tec::bench::do_not_optimize(&msg);
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+
+template <typename TMessage, typename TMake>
+void run(tec::bench::Suite& suite, const char* name, TMake make) {
+    Receiver<TMessage> receiver;
+    receiver.run();
+    suite.run_batch(name, [&](uint64_t n) {
+        received = 0;
+        for( uint64_t i = 0; i < n; ++i ) {
+            receiver.send(make());
+        }
+        while( received.load(std::memory_order_acquire) < n ) {
+            std::this_thread::yield();
+        }
+    });
+    receiver.terminate();
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("message", argc, argv);
+    const std::string text(40, 'x');
+
+    run<StringMessage>(suite, "send/std::string 40B", [&text] {
+        return StringMessage{1, text};
+    });
+    run<tec::SmallMessage>(suite, "send/SmallMessage 40B", [] {
+        return tec::SmallMessage{1, Text{}};
+    });
+
+    const StringMessage sm{1, text};
+    suite.run("copy/std::string 40B", [&sm] {
+        StringMessage copy = sm;
+        tec::bench::do_not_optimize(copy);
+    });
+    const tec::SmallMessage small{1, Text{}};
+    suite.run("copy/SmallMessage 40B", [&small] {
+        tec::SmallMessage copy = small;
+        tec::bench::do_not_optimize(copy);
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Local vs remote memory latency: a dependent pointer chase through
+// a NumaArena, for every (CPU node, memory node) pair.
+// On single-node machines the topology is simulated with 2 nodes: the
+// code paths are exercised, but local and remote are the same memory.
+
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_numa.hpp"
+#include "tec/tec_thread.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+static constexpr const size_t kArenaSize{64 << 20};
+static constexpr const size_t kSlots{kArenaSize / 2 / sizeof(uint32_t)};
+
+
+// Creates a chase cycle in an arena bound to `mem_node`, touching it
+// from a thread on `cpus`.
+std::unique_ptr<tec::NumaArena> make_chain(int mem_node, const std::vector<int>& cpus, uint32_t*& chain) {
+    std::unique_ptr<tec::NumaArena> arena;
+    std::thread t([&] {
+        tec::set_thread_affinity(cpus);
+        arena = std::make_unique<tec::NumaArena>(kArenaSize, mem_node);
+        chain = static_cast<uint32_t*>(arena->allocate(kSlots * sizeof(uint32_t), 64));
+        std::vector<uint32_t> order(kSlots);
+        std::iota(order.begin(), order.end(), 0u);
+        std::shuffle(order.begin() + 1, order.end(), std::mt19937{42});
+        for( size_t i = 0; i < kSlots; ++i ) {
+            chain[order[i]] = order[(i + 1) % kSlots];
+        }
+    });
+    t.join();
+    return arena;
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("numa", argc, argv);
+
+    auto topo = tec::NumaTopology::discover();
+    if( topo.size() < 2 ) {
+        tec::println("single NUMA node: simulating 2 nodes, local == remote");
+        topo = tec::NumaTopology::simulate(2, topo);
+    }
+
+    for( const auto& mem: topo.nodes() ) {
+        uint32_t* chain{nullptr};
+        const int bind_node = topo.simulated() ? 0 : mem.id;
+        auto arena = make_chain(bind_node, mem.cpus, chain);
+        if( !arena->bind_result() ) {
+            tec::println("node {}: {}, using first touch", mem.id, arena->bind_result());
+        }
+        for( const auto& cpu: topo.nodes() ) {
+            tec::set_thread_affinity(cpu.cpus);
+            uint32_t idx{0};
+            suite.run(tec::format("chase/cpu{}/mem{}{}", cpu.id, mem.id, cpu.id == mem.id ? " (local)" : ""),
+                      [&idx, chain] {
+                          idx = chain[idx];
+                          tec::bench::do_not_optimize(idx);
+                      });
+        }
+    }
+
+    // Placement overview.
+    for( auto policy: {tec::Placement::Compact, tec::Placement::Spread} ) {
+        const auto places = tec::place_workers(topo, 4, policy);
+        std::string line;
+        for( const auto& p: places ) {
+            line += tec::format(" n{}:c{}", p.node, p.cpu);
+        }
+        tec::println("{}:{}", policy == tec::Placement::Compact ? "compact" : "spread", line);
+    }
+
+    return suite.finish();
+}
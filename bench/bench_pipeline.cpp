@@ -0,0 +1,95 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Per-item cost of a three-stage pipeline: plain, filtering, and with
+// a parallel ordered middle stage.
+
+#include <cstdint>
+#include <optional>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_pipeline.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+// About 1 us of work.
+static uint64_t work(uint64_t x) {
+    for( int i = 0; i < 300; ++i ) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return x;
+}
+
+
+template <typename TMiddle>
+void bench_pipeline(tec::bench::Suite& suite, const std::string& name,
+                    const tec::StageParams& middle_params, TMiddle middle) {
+    tec::PipelineStats last;
+    suite.run_batch(name, [&](uint64_t n) {
+        tec::PipelineParams params;
+        params.name = "bench_pipeline";
+        uint64_t sum{0};
+        auto pipeline = tec::Pipeline<uint64_t>::build(params)
+            .stage("source", [](uint64_t x) { return x + 1; })
+            .stage("middle", middle_params, middle)
+            .sink("sink", [&sum](uint64_t x) { sum += x; });
+        pipeline->run();
+        for( uint64_t i = 0; i < n; ++i ) {
+            pipeline->push(i);
+        }
+        pipeline->terminate();
+        tec::bench::do_not_optimize(sum);
+        last = pipeline->stats();
+    });
+    tec::println("{}", last);
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("pipeline", argc, argv);
+
+    tec::StageParams single;
+    bench_pipeline(suite, "Pipeline/3 stages", single,
+                   [](uint64_t x) { return x * 2; });
+
+    bench_pipeline(suite, "Pipeline/filter half", single,
+                   [](uint64_t x) -> std::optional<uint64_t> {
+                       if( x & 1 ) {
+                           return std::nullopt;
+                       }
+                       return x;
+                   });
+
+    bench_pipeline(suite, "Pipeline/1us work x1", single,
+                   [](uint64_t x) { return work(x); });
+
+    tec::StageParams pool;
+    pool.workers = 4;
+    pool.ordered = true;
+    bench_pipeline(suite, "Pipeline/1us work x4 ordered", pool,
+                   [](uint64_t x) { return work(x); });
+
+    return suite.finish();
+}
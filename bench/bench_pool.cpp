@@ -0,0 +1,114 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Payloads allocated by the sender and released by the receiving Worker:
+// new/delete (std::shared_ptr) vs a SlabPool of the sending thread.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_pool.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Params: tec::WorkerParams {};
+
+struct Payload {
+    uint64_t id;
+    char data[120];
+};
+
+std::atomic<uint64_t> received{0};
+
+void wait_received(uint64_t n) {
+    while( received.load(std::memory_order_acquire) < n ) {
+        std::this_thread::yield();
+    }
+}
+
+
+template <typename TPtr>
+struct Msg {
+    tec::Message::cmd_t command;
+    TPtr payload;
+
+    bool quit() const { return command == tec::Message::QUIT; }
+};
+
+
+template <typename TPtr>
+class Receiver: public tec::Worker<Params, Msg<TPtr>> {
+public:
+    Receiver(): tec::Worker<Params, Msg<TPtr>>(Params{}) {}
+protected:
+    void process(const Msg<TPtr>& msg) override {
+        tec::bench::do_not_optimize(msg.payload->id);
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+
+template <typename TPtr, typename TMake>
+void run(tec::bench::Suite& suite, const char* name, TMake make) {
+    Receiver<TPtr> receiver;
+    receiver.run();
+    suite.run_batch(name, [&](uint64_t n) {
+        received = 0;
+        for( uint64_t i = 0; i < n; ++i ) {
+            receiver.send({1, make(i)});
+        }
+        wait_received(n);
+    });
+    receiver.terminate();
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("pool", argc, argv);
+
+    run<std::shared_ptr<Payload>>(suite, "payload/make_shared", [](uint64_t i) {
+        return std::make_shared<Payload>(Payload{i, {}});
+    });
+    run<tec::PoolPtr<Payload>>(suite, "payload/make_pooled", [](uint64_t i) {
+        return tec::make_pooled<Payload>(Payload{i, {}});
+    });
+
+    auto* pool = tec::SlabPool::create();
+    suite.run("SlabPool/allocate+deallocate", [pool] {
+        void* p = pool->allocate();
+        tec::bench::do_not_optimize(p);
+        tec::SlabPool::deallocate(p);
+    });
+    suite.run("malloc+free/256", [] {
+        void* p = std::malloc(256);
+        tec::bench::do_not_optimize(p);
+        std::free(p);
+    });
+    pool->release();
+
+    return suite.finish();
+}
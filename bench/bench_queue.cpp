@@ -0,0 +1,79 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// SafeQueue enqueue/dequeue, alone and under contention.
+
+#include <thread>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_queue.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+// P producers, one consumer (the calling thread), `n` elements in total.
+template <typename TQueue>
+void contended(TQueue& q, unsigned producers, uint64_t n) {
+    std::vector<std::thread> threads;
+    for( unsigned p = 0; p < producers; ++p ) {
+        const uint64_t count = n / producers + (p < n % producers ? 1 : 0);
+        threads.emplace_back([&q, count] {
+            for( uint64_t i = 0; i < count; ++i ) {
+                q.enqueue({1});
+            }
+        });
+    }
+    for( uint64_t i = 0; i < n; ++i ) {
+        tec::bench::do_not_optimize(q.dequeue());
+    }
+    for( auto& t: threads ) {
+        t.join();
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("queue", argc, argv);
+
+    tec::SafeQueue<tec::Message> q;
+    suite.run("SafeQueue/enqueue+dequeue", [&q] {
+        q.enqueue({1});
+        tec::bench::do_not_optimize(q.dequeue());
+    });
+
+    tec::SafeQueue<tec::Message> qm("bench");
+    suite.run("SafeQueue/enqueue+dequeue/metrics", [&qm] {
+        qm.enqueue({1});
+        tec::bench::do_not_optimize(qm.dequeue());
+    });
+
+    for( unsigned producers: {1u, 2u, 4u} ) {
+        suite.run_batch(tec::format("SafeQueue/contended/{}p1c", producers), [&q, producers](uint64_t n) {
+            contended(q, producers, n);
+        });
+    }
+
+    return suite.finish();
+}
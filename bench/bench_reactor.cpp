@@ -0,0 +1,139 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Pipe readiness to processing: a reader thread forwarding to a Worker
+// vs one ReactorWorker watching the pipe; and send() to both.
+
+#include <atomic>
+#include <thread>
+
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_reactor.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Params: tec::WorkerParams {};
+
+std::atomic<uint64_t> handled{0};
+
+void wait_handled(uint64_t n) {
+    while( handled.load(std::memory_order_acquire) < n ) {
+        std::this_thread::yield();
+    }
+}
+
+
+class Counter: public tec::Worker<Params> {
+public:
+    Counter(): tec::Worker<Params>(Params{}) {}
+protected:
+    void process(const tec::Message& msg) override {
+        handled.fetch_add(msg.command, std::memory_order_release);
+    }
+};
+
+
+class Reactor: public tec::ReactorWorker<Params> {
+    int fd_;
+public:
+    explicit Reactor(int fd): tec::ReactorWorker<Params>(Params{}), fd_{fd} {}
+protected:
+    tec::Result init() override { return watch(fd_, true); }
+    void on_readable(int fd) override {
+        char buf[4096];
+        const auto n = ::read(fd, buf, sizeof(buf));
+        if( n > 0 ) {
+            handled.fetch_add(static_cast<uint64_t>(n), std::memory_order_release);
+        }
+    }
+    void process(const tec::Message& msg) override {
+        handled.fetch_add(msg.command, std::memory_order_release);
+    }
+};
+
+
+// Writes `n` single bytes, waits until all are handled.
+void pump(int fd, uint64_t n) {
+    handled = 0;
+    const char c{'x'};
+    for( uint64_t i = 0; i < n; ++i ) {
+        [[maybe_unused]] auto r = ::write(fd, &c, 1);
+    }
+    wait_handled(n);
+}
+
+
+template <typename TWorker>
+void send_all(TWorker& worker, uint64_t n) {
+    handled = 0;
+    for( uint64_t i = 0; i < n; ++i ) {
+        worker.send({1});
+    }
+    wait_handled(n);
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("reactor", argc, argv);
+
+    {
+        int fds[2];
+        if( ::pipe(fds) != 0 ) {
+            return 1;
+        }
+        Counter counter;
+        counter.run();
+        std::thread reader([&counter, fd = fds[0]] {
+            char buf[4096];
+            ssize_t n;
+            while( (n = ::read(fd, buf, sizeof(buf))) > 0 ) {
+                counter.send({static_cast<tec::Message::cmd_t>(n)});
+            }
+        });
+        suite.run_batch("pipe/reader thread+Worker", [fd = fds[1]](uint64_t n) { pump(fd, n); });
+        suite.run_batch("send/Worker", [&counter](uint64_t n) { send_all(counter, n); });
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+    }
+
+    {
+        int fds[2];
+        if( ::pipe(fds) != 0 ) {
+            return 1;
+        }
+        Reactor reactor(fds[0]);
+        reactor.run();
+        suite.run_batch("pipe/ReactorWorker", [fd = fds[1]](uint64_t n) { pump(fd, n); });
+        suite.run_batch("send/ReactorWorker", [&reactor](uint64_t n) { send_all(reactor, n); });
+        reactor.terminate();
+        ::close(fds[1]);
+        ::close(fds[0]);
+    }
+
+    return suite.finish();
+}
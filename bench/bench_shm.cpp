@@ -0,0 +1,114 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Messages from a forked process to a ShmWorker through shared memory,
+// against send() from a thread of the same process.
+
+#include <atomic>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_shm.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Params: tec::WorkerParams {};
+
+struct Msg {
+    tec::Message::cmd_t command;
+    uint64_t value;
+
+    bool quit() const { return command == tec::Message::QUIT; }
+};
+
+constexpr const char* kRing{"/tec_bench_shm"};
+
+std::atomic<uint64_t> received{0};
+
+
+class Receiver: public tec::ShmWorker<Params, Msg> {
+public:
+    explicit Receiver(std::unique_ptr<tec::ShmRing> ring)
+        : tec::ShmWorker<Params, Msg>(Params{}, std::move(ring))
+    {}
+protected:
+    void process(const Msg&) override {
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+
+void wait_received(uint64_t n) {
+    while( received.load(std::memory_order_acquire) < n ) {
+        std::this_thread::yield();
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("shm", argc, argv);
+
+    auto ring = tec::ShmRing::create(kRing, 1 << 20);
+    if( !ring ) {
+        tec::println("{}", ring.error());
+        return 1;
+    }
+    Receiver receiver(std::move(*ring));
+    if( !receiver.run() ) {
+        return 1;
+    }
+
+    suite.run_batch("ShmSender/other process", [](uint64_t n) {
+        received = 0;
+        const pid_t pid = ::fork();
+        if( pid == 0 ) {
+            auto sender = tec::ShmSender<Msg>::connect(kRing);
+            for( uint64_t i = 0; sender && i < n; ++i ) {
+                sender->send({1, i});
+            }
+            // Detach so that the next batch can attach.
+            sender = tec::Result{};
+            ::_exit(0);
+        }
+        wait_received(n);
+        ::waitpid(pid, nullptr, 0);
+    });
+
+    suite.run_batch("send/same process", [&receiver](uint64_t n) {
+        received = 0;
+        std::thread sender([&receiver, n] {
+            for( uint64_t i = 0; i < n; ++i ) {
+                receiver.send({1, i});
+            }
+        });
+        wait_received(n);
+        sender.join();
+    });
+
+    receiver.terminate();
+    return suite.finish();
+}
@@ -0,0 +1,70 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Signal set/wait, uncontended and ping-pong between two threads.
+
+#include <atomic>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_semaphore.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("signal", argc, argv);
+
+    Signal sig;
+    suite.run("Signal/set+wait+reset", [&sig] {
+        sig.set();
+        sig.wait();
+        sig.reset();
+    });
+
+    suite.run("Signal/wait_for/signalled", [&sig] {
+        sig.set();
+        tec::bench::do_not_optimize(sig.wait_for(tec::MilliSec{1}));
+    });
+
+    // Ping-pong: one op is a full round trip.
+    suite.run_batch("Signal/ping-pong", [](uint64_t n) {
+        Signal ping;
+        Signal pong;
+        std::thread peer([&] {
+            for( uint64_t i = 0; i < n; ++i ) {
+                ping.wait();
+                ping.reset();
+                pong.set();
+            }
+        });
+        for( uint64_t i = 0; i < n; ++i ) {
+            ping.set();
+            pong.wait();
+            pong.reset();
+        }
+        peer.join();
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,96 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Construct, run() and terminate() many workers, eager vs lazy launch.
+// One op is the whole lifecycle of one worker within a batch of workers.
+
+#include <memory>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct StartupParams: public tec::WorkerParams {};
+
+using StartupWorker = tec::Worker<StartupParams>;
+
+
+// Returns ns spent in {construct, run, terminate}.
+std::array<uint64_t, 3> lifecycle(size_t count, tec::Launch launch) {
+    StartupParams params;
+    params.name = "startup";
+    std::vector<std::unique_ptr<StartupWorker>> workers;
+    workers.reserve(count);
+
+    tec::BasicStopwatch<tec::MonoClock> sw;
+    for( size_t i = 0; i < count; ++i ) {
+        workers.push_back(std::make_unique<StartupWorker>(params, launch));
+    }
+    const uint64_t t_construct = sw.lap();
+    for( auto& w: workers ) {
+        w->run();
+    }
+    const uint64_t t_run = sw.lap();
+    for( auto& w: workers ) {
+        w->terminate();
+    }
+    const uint64_t t_terminate = sw.lap();
+    return {t_construct, t_run, t_terminate};
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("startup", argc, argv);
+
+    for( auto launch: {tec::Launch::Eager, tec::Launch::Lazy} ) {
+        const char* mode = (launch == tec::Launch::Eager) ? "eager" : "lazy";
+        suite.run_batch(tec::format("Worker/{}/lifecycle x100", mode), [launch](uint64_t n) {
+            for( uint64_t i = 0; i < n; i += 100 ) {
+                lifecycle(100, launch);
+            }
+        });
+        suite.run_batch(tec::format("Worker/{}/construct only", mode), [launch](uint64_t n) {
+            StartupParams params;
+            for( uint64_t i = 0; i < n; ++i ) {
+                StartupWorker w(params, launch);
+                tec::bench::do_not_optimize(w);
+            }
+        });
+    }
+
+    // The headline number: 10k workers at once.
+    for( auto launch: {tec::Launch::Eager, tec::Launch::Lazy} ) {
+        const auto t = lifecycle(10000, launch);
+        tec::println("10k workers, {}: construct {} ms, run {} ms (started in {} ms), terminate {} ms",
+                     launch == tec::Launch::Eager ? "eager" : "lazy",
+                     t[0] / 1000000, t[1] / 1000000, (t[0] + t[1]) / 1000000, t[2] / 1000000);
+    }
+    tec::println("sizeof(Signal)={} sizeof(Worker)={}", sizeof(Signal), sizeof(StartupWorker));
+
+    return suite.finish();
+}
@@ -0,0 +1,154 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Messages through a Worker: in memory vs logged by a DurableWorker,
+// sent one at a time or in batches, with and without sync.
+// The log lives in a temporary directory.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_wal.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct Params: tec::WorkerParams {};
+
+struct Order {
+    tec::Message::cmd_t command;
+    uint64_t id;
+    double price;
+    char symbol[16];
+
+    bool quit() const { return command == tec::Message::QUIT; }
+};
+
+std::atomic<uint64_t> received{0};
+
+
+class Memory: public tec::Worker<Params, Order> {
+public:
+    Memory(): tec::Worker<Params, Order>(Params{}) {}
+protected:
+    void process(const Order& msg) override {
+        tec::bench::do_not_optimize(&msg);
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+class Durable: public tec::DurableWorker<Params, Order> {
+public:
+    explicit Durable(std::unique_ptr<tec::Wal> wal)
+        : tec::DurableWorker<Params, Order>(Params{}, std::move(wal)) {}
+protected:
+    void process(const Order& msg) override {
+        tec::bench::do_not_optimize(&msg);
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+
+void wait_received(uint64_t n) {
+    while( received.load(std::memory_order_acquire) < n ) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename TWorker>
+void run_single(tec::bench::Suite& suite, const char* name, TWorker& worker) {
+    suite.run_batch(name, [&](uint64_t n) {
+        received = 0;
+        for( uint64_t i = 0; i < n; ++i ) {
+            worker.send(Order{1, i, 1.0, "TEC"});
+        }
+        wait_received(n);
+    });
+}
+
+template <typename TSend>
+void run_batched(tec::bench::Suite& suite, const char* name, size_t size, TSend send) {
+    const Order order{1, 0, 1.0, "TEC"};
+    std::vector<Order> batch;
+    suite.run_batch(name, [&](uint64_t n) {
+        received = 0;
+        for( uint64_t i = 0; i < n; i += batch.size() ) {
+            batch.assign(std::min<uint64_t>(size, n - i), order);
+            send(batch);
+        }
+        wait_received(n);
+    });
+}
+
+std::unique_ptr<tec::Wal> open_wal(const std::string& dir, bool sync) {
+    std::system(("rm -rf " + dir).c_str());
+    tec::WalParams params;
+    params.dir = dir;
+    params.sync = sync;
+    params.name = sync ? "bench_sync" : "bench_nosync";
+    auto wal = tec::Wal::open(params);
+    if( !wal ) {
+        tec::println("Wal::open: {}", wal.error());
+        std::exit(1);
+    }
+    return std::move(*wal);
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("wal", argc, argv);
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string dir = std::string(tmp ? tmp : "/tmp") + "/tec_bench_wal";
+
+    {
+        Memory worker;
+        worker.run();
+        run_single(suite, "memory/send", worker);
+        run_batched(suite, "memory/send x256", 256, [&](const std::vector<Order>& batch) {
+            for( const auto& msg: batch ) {
+                worker.send(msg);
+            }
+        });
+        worker.terminate();
+    }
+    for( bool sync: {false, true} ) {
+        Durable worker(open_wal(dir, sync));
+        worker.run();
+        run_single(suite, sync ? "wal+sync/send" : "wal/send", worker);
+        const auto send_batch = [&](const std::vector<Order>& batch) { worker.send_batch(batch); };
+        run_batched(suite, sync ? "wal+sync/send_batch 256" : "wal/send_batch 256", 256, send_batch);
+        if( sync ) {
+            run_batched(suite, "wal+sync/send_batch 4096", 4096, send_batch);
+        }
+        worker.terminate();
+    }
+    std::system(("rm -rf " + dir).c_str());
+
+    return suite.finish();
+}
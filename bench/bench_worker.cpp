@@ -0,0 +1,92 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+// Worker send() -> process() round trip and throughput.
+
+#include <atomic>
+#include <cstdint>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_semaphore.hpp"
+#include "tec/tec_worker.hpp"
+#include "tec/bench/tec_bench.hpp"
+
+
+struct BenchWorkerParams: public tec::WorkerParams {};
+
+static constexpr const tec::Message::cmd_t CMD_PING{1};
+
+template <typename TStats>
+class PingWorker: public tec::Worker<BenchWorkerParams, tec::Message, tec::MilliSec, TStats> {
+    using Base = tec::Worker<BenchWorkerParams, tec::Message, tec::MilliSec, TStats>;
+
+public:
+    Signal pong;
+    std::atomic<uint64_t> processed{0};
+
+    explicit PingWorker(const BenchWorkerParams& params): Base(params) {}
+
+protected:
+    void process(const tec::Message&) override {
+        processed.fetch_add(1, std::memory_order_release);
+        pong.set();
+    }
+};
+
+
+template <typename TStats>
+void bench_worker(tec::bench::Suite& suite, const std::string& policy) {
+    BenchWorkerParams params;
+    params.name = "bench_" + policy;
+    PingWorker<TStats> worker(params);
+    worker.run();
+
+    suite.run(tec::format("Worker<{}>/round-trip", policy), [&worker] {
+        worker.pong.reset();
+        worker.send({CMD_PING});
+        worker.pong.wait();
+    });
+
+    suite.run_batch(tec::format("Worker<{}>/throughput", policy), [&worker](uint64_t n) {
+        const uint64_t target = worker.processed.load() + n;
+        for( uint64_t i = 0; i < n; ++i ) {
+            worker.send({CMD_PING});
+        }
+        while( worker.processed.load(std::memory_order_acquire) < target ) {
+            std::this_thread::yield();
+        }
+    });
+
+    worker.terminate();
+}
+
+
+int main(int argc, char* argv[]) {
+    tec::bench::Suite suite("worker", argc, argv);
+
+    bench_worker<tec::NoStats>(suite, "NoStats");
+    bench_worker<tec::WorkerStats>(suite, "WorkerStats");
+
+    return suite.finish();
+}
@@ -0,0 +1,563 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_bench.hpp
+ *   @brief A minimal microbenchmark harness.
+ *
+ *  Every benchmark is warmed up, then its iteration count is grown
+ *  until a single sample takes at least `min_sample_time`; the harness
+ *  then collects `samples` timings, reports ns per operation and keeps
+ *  the raw samples in the JSON output (see bench_compare.cpp).
+ *
+ *  @code
+ *  int main(int argc, char* argv[]) {
+ *      tec::bench::Suite suite("core", argc, argv);
+ *      suite.run("format/3 args", []{
+ *          tec::bench::do_not_optimize(tec::format("{} {} {}", 1, 2.0, "three"));
+ *      });
+ *      return suite.finish();
+ *  }
+ *  @endcode
+ *
+ *  Command line: `--samples=N --min-time-ms=N --warmup-ms=N --filter=SUBSTR --json=PATH`.
+ *  load_reports() reads the JSON back.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_expected.hpp"
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_utils.hpp"
+
+
+namespace tec {
+
+namespace bench {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Helpers
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Keeps the compiler from optimizing `value` away.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+    const volatile void* p = &value;
+    (void)p;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+
+//! Summary of samples, in ns/op.
+struct Stats {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double p90;
+    double max;
+};
+
+
+inline Stats stats_of(std::vector<double> v) {
+    if( v.empty() ) {
+        return {};
+    }
+    std::sort(v.begin(), v.end());
+    const auto at = [&v](double q) {
+        const double pos = q * static_cast<double>(v.size() - 1);
+        const size_t lo = static_cast<size_t>(pos);
+        const size_t hi = std::min(lo + 1, v.size() - 1);
+        return v[lo] + (v[hi] - v[lo]) * (pos - static_cast<double>(lo));
+    };
+    const double mean = std::accumulate(v.begin(), v.end(), 0.0) / static_cast<double>(v.size());
+    double var{0};
+    for( double x: v ) {
+        var += (x - mean) * (x - mean);
+    }
+    var = v.size() > 1 ? var / static_cast<double>(v.size() - 1) : 0.0;
+    return {v.front(), at(0.5), mean, std::sqrt(var), at(0.9), v.back()};
+}
+
+
+namespace details {
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for( char c: s ) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if( static_cast<unsigned char>(c) < 0x20 ) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "\\u%04x", static_cast<unsigned>(c));
+                out += hex;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                              Suite
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct BenchParams {
+    //! Defaults.
+    static constexpr const size_t kSamples{30};
+    static constexpr const MilliSec kMinSampleTime{10};
+    static constexpr const MilliSec kWarmupTime{100};
+
+    size_t samples;            //!< Number of timed samples.
+    MilliSec min_sample_time;  //!< Minimal duration of a sample.
+    MilliSec warmup_time;      //!< Untimed run before sampling.
+    std::string filter;        //!< Run only benchmarks whose names contain it.
+    std::string json_path;     //!< Write JSON here if not empty.
+
+    BenchParams()
+        : samples(kSamples)
+        , min_sample_time(kMinSampleTime)
+        , warmup_time(kWarmupTime)
+    {}
+
+    //! Parses `--name=value` arguments, unknown ones are errors.
+    Result parse(int argc, char* argv[]) {
+        for( int i = 1; i < argc; ++i ) {
+            const std::string arg{argv[i]};
+            const auto eq = arg.find('=');
+            const std::string key = arg.substr(0, eq);
+            const std::string val = (eq == std::string::npos) ? std::string{} : arg.substr(eq + 1);
+            if( key == "--samples" ) {
+                samples = std::max<size_t>(2, std::strtoul(val.c_str(), nullptr, 10));
+            }
+            else if( key == "--min-time-ms" ) {
+                min_sample_time = MilliSec{std::strtol(val.c_str(), nullptr, 10)};
+            }
+            else if( key == "--warmup-ms" ) {
+                warmup_time = MilliSec{std::strtol(val.c_str(), nullptr, 10)};
+            }
+            else if( key == "--filter" ) {
+                filter = val;
+            }
+            else if( key == "--json" ) {
+                json_path = val;
+            }
+            else {
+                return {format("unknown argument \"{}\"", arg), Result::Kind::Invalid};
+            }
+        }
+        return {};
+    }
+};
+
+
+//! A benchmark outcome.
+struct Report {
+    std::string name;
+    uint64_t iterations;          //!< Operations per sample.
+    std::vector<double> samples;  //!< ns/op of every sample.
+    Stats stats;
+};
+
+
+/**
+ * @class      Suite
+ * @brief      Runs benchmarks and reports them as a table and JSON.
+ */
+class Suite {
+    std::string name_;
+    BenchParams params_;
+    Result status_;
+    std::vector<Report> reports_;
+    bool header_;
+
+    bool selected(const std::string& name) const {
+        return params_.filter.empty() || name.find(params_.filter) != std::string::npos;
+    }
+
+public:
+    Suite(const std::string& name, const BenchParams& params)
+        : name_{name}
+        , params_{params}
+        , header_{false}
+    {}
+
+    //! Takes parameters from the command line.
+    Suite(const std::string& name, int argc, char* argv[])
+        : name_{name}
+        , header_{false}
+    {
+        status_ = params_.parse(argc, argv);
+    }
+
+    const BenchParams& params() const { return params_; }
+    const std::vector<Report>& reports() const { return reports_; }
+
+    /**
+     * @brief      Benchmarks a batch operation.
+     *
+     * @param      name Benchmark name.
+     * @param      fn Callable `void(uint64_t n)` performing `n` operations.
+     */
+    template <typename F>
+    void run_batch(const std::string& name, F&& fn) {
+        if( !status_ || !selected(name) ) {
+            return;
+        }
+        using Clock = MonoClock;
+        const uint64_t min_ns = static_cast<uint64_t>(NanoSec{params_.min_sample_time}.count());
+        const uint64_t warmup_ns = static_cast<uint64_t>(NanoSec{params_.warmup_time}.count());
+
+        // Warm up and find the iteration count.
+        uint64_t iters{1};
+        const uint64_t t_begin = Clock::ticks();
+        for( ;; ) {
+            const uint64_t t0 = Clock::ticks();
+            fn(iters);
+            const uint64_t dt = Clock::ticks() - t0;
+            if( dt >= min_ns && Clock::ticks() - t_begin >= warmup_ns ) {
+                break;
+            }
+            if( dt < min_ns ) {
+                iters = (dt == 0) ? iters * 10
+                    : std::max(iters + 1, static_cast<uint64_t>(static_cast<double>(iters) * 1.2 * min_ns / dt));
+            }
+        }
+
+        Report rep{name, iters, {}, {}};
+        rep.samples.reserve(params_.samples);
+        for( size_t i = 0; i < params_.samples; ++i ) {
+            const uint64_t t0 = Clock::ticks();
+            fn(iters);
+            const uint64_t dt = Clock::ticks() - t0;
+            rep.samples.push_back(static_cast<double>(dt) / static_cast<double>(iters));
+        }
+        rep.stats = stats_of(rep.samples);
+        if( !header_ ) {
+            header_ = true;
+            std::cout << "*** " << name_ << " ***\n";
+            print_header(std::cout);
+        }
+        print_row(std::cout, rep);
+        reports_.push_back(std::move(rep));
+    }
+
+    /**
+     * @brief      Benchmarks a single operation.
+     *
+     * @param      name Benchmark name.
+     * @param      fn Callable `void()`, one operation.
+     */
+    template <typename F>
+    void run(const std::string& name, F&& fn) {
+        run_batch(name, [&fn](uint64_t n) {
+            for( uint64_t i = 0; i < n; ++i ) {
+                fn();
+            }
+        });
+    }
+
+    static void print_header(std::ostream& out) {
+        out << std::left << std::setw(40) << "benchmark" << std::right
+            << std::setw(12) << "median" << std::setw(12) << "mean"
+            << std::setw(10) << "stddev" << std::setw(12) << "p90"
+            << std::setw(12) << "iters" << "  (ns/op)\n";
+    }
+
+    static void print_row(std::ostream& out, const Report& r) {
+        const auto flags = out.flags();
+        out << std::left << std::setw(40) << r.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << r.stats.median << std::setw(12) << r.stats.mean
+            << std::setw(10) << r.stats.stddev << std::setw(12) << r.stats.p90
+            << std::setw(12) << r.iterations << "\n";
+        out.flags(flags);
+    }
+
+    void write_json(std::ostream& out) const {
+        const auto flags = out.flags();
+        out << std::setprecision(6)
+            << "{\n  \"suite\": \"" << details::json_escape(name_) << "\",\n"
+            << "  \"compiler\": \"" << __TEC_COMPILER_NAME__ << "\",\n"
+            << "  \"timestamp\": " << std::time(nullptr) << ",\n"
+            << "  \"unit\": \"ns/op\",\n"
+            << "  \"benchmarks\": [";
+        for( size_t i = 0; i < reports_.size(); ++i ) {
+            const Report& r = reports_[i];
+            out << (i ? ",\n" : "\n")
+                << "    {\"name\": \"" << details::json_escape(r.name) << "\""
+                << ", \"iterations\": " << r.iterations
+                << ", \"min\": " << r.stats.min
+                << ", \"median\": " << r.stats.median
+                << ", \"mean\": " << r.stats.mean
+                << ", \"stddev\": " << r.stats.stddev
+                << ", \"p90\": " << r.stats.p90
+                << ", \"max\": " << r.stats.max
+                << ", \"samples\": [";
+            for( size_t k = 0; k < r.samples.size(); ++k ) {
+                out << (k ? ", " : "") << r.samples[k];
+            }
+            out << "]}";
+        }
+        out << "\n  ]\n}\n";
+        out.flags(flags);
+    }
+
+    //! Writes JSON if requested. Returns the process exit code.
+    int finish() const {
+        if( !status_ ) {
+            std::cerr << name_ << ": " << status_ << "\n";
+            return 2;
+        }
+        if( !params_.json_path.empty() ) {
+            std::ofstream out(params_.json_path);
+            write_json(out);
+            if( !out ) {
+                std::cerr << name_ << ": cannot write " << params_.json_path << "\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Reading JSON back
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+//! Just enough JSON to read Suite::write_json() output.
+struct json_reader {
+    const std::string& text;
+    size_t pos;
+    std::string error;
+
+    explicit json_reader(const std::string& t): text{t}, pos{0} {}
+
+    void ws() {
+        while( pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])) ) ++pos;
+    }
+
+    bool fail(const std::string& what) {
+        if( error.empty() ) {
+            error = format("{} at offset {}", what, pos);
+        }
+        return false;
+    }
+
+    bool peek(char c) {
+        ws();
+        return pos < text.size() && text[pos] == c;
+    }
+
+    bool expect(char c) {
+        if( peek(c) ) {
+            ++pos;
+            return true;
+        }
+        return fail(format("expected '{}'", std::string(1, c)));
+    }
+
+    bool string(std::string& out) {
+        if( !expect('"') ) return false;
+        out.clear();
+        while( pos < text.size() && text[pos] != '"' ) {
+            char c = text[pos++];
+            if( c == '\\' && pos < text.size() ) {
+                c = text[pos++];
+                switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                    out += static_cast<char>(std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16));
+                    pos += 4;
+                    break;
+                default: out += c;
+                }
+            }
+            else {
+                out += c;
+            }
+        }
+        return expect('"');
+    }
+
+    bool number(double& out) {
+        ws();
+        const char* begin = text.c_str() + pos;
+        char* end{nullptr};
+        out = std::strtod(begin, &end);
+        if( end == begin ) return fail("expected a number");
+        pos += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    //! Calls `on_key(key)` for every member; it must consume the value.
+    template <typename F>
+    bool object(F&& on_key) {
+        if( !expect('{') ) return false;
+        if( peek('}') ) return expect('}');
+        do {
+            std::string key;
+            if( !string(key) || !expect(':') || !on_key(key) ) return false;
+        } while( peek(',') && expect(',') );
+        return expect('}');
+    }
+
+    //! Calls `on_item()` for every element; it must consume the value.
+    template <typename F>
+    bool array(F&& on_item) {
+        if( !expect('[') ) return false;
+        if( peek(']') ) return expect(']');
+        do {
+            if( !on_item() ) return false;
+        } while( peek(',') && expect(',') );
+        return expect(']');
+    }
+
+    //! Skips any value.
+    bool skip() {
+        ws();
+        if( pos >= text.size() ) return fail("unexpected end");
+        const char c = text[pos];
+        if( c == '"' ) {
+            std::string tmp;
+            return string(tmp);
+        }
+        if( c == '{' ) {
+            return object([this](const std::string&) { return skip(); });
+        }
+        if( c == '[' ) {
+            return array([this] { return skip(); });
+        }
+        if( std::isalpha(static_cast<unsigned char>(c)) ) {
+            // true, false, null
+            while( pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos])) ) ++pos;
+            return true;
+        }
+        double tmp;
+        return number(tmp);
+    }
+};
+
+} // ::details
+
+
+/**
+ * @brief      Loads reports written by Suite::write_json().
+ *
+ * @param      path JSON file.
+ * @return     Expected<std::vector<Report>> Reports with raw samples, stats recomputed.
+ */
+inline Expected<std::vector<Report>> load_reports(const std::string& path) {
+    std::ifstream in(path);
+    if( !in ) {
+        return Result{format("cannot open \"{}\"", path), Result::Kind::IOErr};
+    }
+    std::ostringstream buf;
+    buf << in.rdbuf();
+    const std::string text = buf.str();
+
+    std::vector<Report> reports;
+    details::json_reader js(text);
+    const bool ok = js.object([&](const std::string& key) {
+        if( key != "benchmarks" ) {
+            return js.skip();
+        }
+        return js.array([&] {
+            Report rep{{}, 0, {}, {}};
+            const bool ok_rep = js.object([&](const std::string& field) {
+                double v;
+                if( field == "name" ) {
+                    return js.string(rep.name);
+                }
+                if( field == "iterations" ) {
+                    if( !js.number(v) ) return false;
+                    rep.iterations = static_cast<uint64_t>(v);
+                    return true;
+                }
+                if( field == "samples" ) {
+                    return js.array([&] {
+                        if( !js.number(v) ) return false;
+                        rep.samples.push_back(v);
+                        return true;
+                    });
+                }
+                return js.skip();
+            });
+            if( ok_rep ) {
+                rep.stats = stats_of(rep.samples);
+                reports.push_back(std::move(rep));
+            }
+            return ok_rep;
+        });
+    });
+    if( !ok ) {
+        return Result{format("{}: {}", path, js.error), Result::Kind::Invalid};
+    }
+    return reports;
+}
+
+
+} // ::bench
+
+} // ::tec
@@ -0,0 +1,211 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   \file tec_grpc_buffer.hpp
+ *   \brief tec::Buffer conversions for gRPC and protobuf.
+ *
+ *  - to_byte_buffer() and from_byte_buffer() convert between
+ *    tec::Buffer and grpc::ByteBuffer by sharing slices, no bytes are
+ *    copied either way.
+ *  - BufferInputStream and BufferOutputStream let protobuf parse from
+ *    and serialize to a tec::Buffer without flattening it.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/slice.h>
+
+#include "tec/tec_buffer.hpp"
+
+namespace tec {
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         gRPC ByteBuffer
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! A ByteBuffer whose slices refer to the blocks of `buf`.
+inline grpc::ByteBuffer to_byte_buffer(const Buffer& buf) {
+    std::vector<grpc::Slice> slices;
+    slices.reserve(buf.segments());
+    for( size_t i = 0; i < buf.segments(); ++i ) {
+        const Buffer::Segment& seg = buf.segment(i);
+        details::buffer_retain(seg.block);
+        slices.emplace_back(const_cast<unsigned char*>(seg.data), seg.size,
+                            [](void* block) { details::buffer_release(static_cast<details::BufferBlock*>(block)); },
+                            seg.block);
+    }
+    return grpc::ByteBuffer(slices.data(), slices.size());
+}
+
+
+//! A Buffer sharing the slices of `bb`; empty if `bb` cannot be read.
+inline Buffer from_byte_buffer(const grpc::ByteBuffer& bb) {
+    std::vector<grpc::Slice> slices;
+    Buffer out;
+    if( !bb.Dump(&slices).ok() ) {
+        return out;
+    }
+    for( auto& slice: slices ) {
+        // Small slices are stored inside grpc::Slice: keep it in place.
+        auto holder = std::make_unique<grpc::Slice>(std::move(slice));
+        const void* data = holder->begin();
+        const size_t size = holder->size();
+        out.append(Buffer::adopt(data, size, [h = std::move(holder)] {}));
+    }
+    return out;
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Protobuf streams
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Reads a Buffer in place: `msg.ParseFromZeroCopyStream(&in)`.
+//! The Buffer must outlive the stream.
+class BufferInputStream: public google::protobuf::io::ZeroCopyInputStream {
+    const Buffer& buf_;
+    size_t seg_;
+    size_t offset_;
+    int64_t count_;
+
+public:
+    explicit BufferInputStream(const Buffer& buf)
+        : buf_{buf}
+        , seg_{0}
+        , offset_{0}
+        , count_{0}
+    {}
+
+    bool Next(const void** data, int* size) override {
+        while( seg_ < buf_.segments() && offset_ == buf_.segment(seg_).size ) {
+            ++seg_;
+            offset_ = 0;
+        }
+        if( seg_ >= buf_.segments() ) {
+            return false;
+        }
+        const Buffer::Segment& seg = buf_.segment(seg_);
+        const size_t len = std::min(seg.size - offset_, static_cast<size_t>(INT_MAX));
+        *data = seg.data + offset_;
+        *size = static_cast<int>(len);
+        offset_ += len;
+        count_ += static_cast<int64_t>(len);
+        return true;
+    }
+
+    //! Only into the chunk returned by the last Next().
+    void BackUp(int count) override {
+        offset_ -= static_cast<size_t>(count);
+        count_ -= count;
+    }
+
+    bool Skip(int count) override {
+        const void* data;
+        int size;
+        while( count > 0 && Next(&data, &size) ) {
+            if( size > count ) {
+                BackUp(size - count);
+                return true;
+            }
+            count -= size;
+        }
+        return count == 0;
+    }
+
+    int64_t ByteCount() const override { return count_; }
+};
+
+
+//! Serializes into a Buffer: `msg.SerializeToZeroCopyStream(&out)`,
+//! then take the result with release().
+class BufferOutputStream: public google::protobuf::io::ZeroCopyOutputStream {
+public:
+    static constexpr size_t kDefaultBlockSize{4096};
+
+private:
+    Buffer out_;
+    //! The block handed out by the last Next().
+    Buffer block_;
+    size_t used_;
+    size_t block_size_;
+    int64_t count_;
+
+    void flush() {
+        if( used_ > 0 ) {
+            out_.append(block_.slice(0, used_));
+        }
+        block_.clear();
+        used_ = 0;
+    }
+
+public:
+    explicit BufferOutputStream(size_t block_size = kDefaultBlockSize)
+        : used_{0}
+        , block_size_{std::min(std::max<size_t>(block_size, 64), static_cast<size_t>(INT_MAX))}
+        , count_{0}
+    {}
+
+    bool Next(void** data, int* size) override {
+        flush();
+        unsigned char* p;
+        block_ = Buffer::allocate(block_size_, &p);
+        used_ = block_size_;
+        *data = p;
+        *size = static_cast<int>(block_size_);
+        count_ += static_cast<int64_t>(block_size_);
+        return true;
+    }
+
+    void BackUp(int count) override {
+        used_ -= static_cast<size_t>(count);
+        count_ -= count;
+    }
+
+    int64_t ByteCount() const override { return count_; }
+
+    //! The bytes written so far; the stream starts over.
+    Buffer release() {
+        flush();
+        count_ = 0;
+        return std::move(out_);
+    }
+};
+
+
+} // ::tec
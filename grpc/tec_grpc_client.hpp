@@ -34,6 +34,9 @@ SOFTWARE.
 
 #include "tec/tec_trace.hpp"
 #include "tec/grpc/tec_grpc.hpp" // IWYU pragma: keep
+#include "tec/tec_expected.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_stopwatch.hpp"
 #include "tec/tec_utils.hpp"
 
 namespace tec {
@@ -93,6 +96,12 @@ protected:
     std::shared_ptr<TChannel> channel_;
     TArguments arguments_;
 
+    //! Standard metrics, labelled with `addr_uri'.
+    std::shared_ptr<metrics::Counter> m_connects_;
+    std::shared_ptr<metrics::Counter> m_connect_failures_;
+    std::shared_ptr<metrics::Histogram> m_connect_latency_;
+    std::shared_ptr<metrics::Histogram> m_rpc_latency_;
+
 protected:
 
     // Sets grpc::ChannelArgiments before creating a channel. Can be overwritten.
@@ -122,22 +131,66 @@ public:
                const std::shared_ptr<TCredentials>& credentials
         )
         : params_{params}
-        , channel_builder_{channel_builder}
         , credentials_{credentials}
+        , channel_builder_{channel_builder}
+        , m_connects_{metrics::registry().instance<metrics::Counter>(
+                "tec_grpc_client_connects_total", "gRPC client connect attempts.",
+                metrics::label("addr", params_.addr_uri))}
+        , m_connect_failures_{metrics::registry().instance<metrics::Counter>(
+                "tec_grpc_client_connect_failures_total", "gRPC client connect failures.",
+                metrics::label("addr", params_.addr_uri))}
+        , m_connect_latency_{metrics::registry().instance<metrics::Histogram>(
+                "tec_grpc_client_connect_latency_ns", "gRPC client connect latency.",
+                metrics::label("addr", params_.addr_uri))}
+        , m_rpc_latency_{metrics::registry().instance<metrics::Histogram>(
+                "tec_grpc_client_rpc_latency_ns", "gRPC client call latency.",
+                metrics::label("addr", params_.addr_uri))}
     {}
 
+    //! RPC latency histogram to be fed by client calls, e.g. with tec::BasicScopedLap.
+    metrics::Histogram& rpc_latency() { return *m_rpc_latency_; }
+
     virtual ~GrpcClient() = default;
 
+protected:
+
+    /**
+     *  @brief Creates a gRPC channel and waits for it is connected.
+     *
+     *  Uses `addr_uri' and `connect_timeout' provided in `params_'.
+     *  Can be overwritten.
+     *
+     *  @return tec::Expected<std::shared_ptr<TChannel>>
+     */
+    virtual Expected<std::shared_ptr<TChannel>> open_channel() {
+        TEC_ENTER("GrpcClient::open_channel");
+
+        // Create a channel.
+        // If failed, a lame channel (one on which all operations fail) is created.
+        auto channel = channel_builder_.fptr(params_.addr_uri, credentials_, arguments_);
+
+        // Connect to the server with timeout.
+        auto deadline = std::chrono::system_clock::now() + params_.connect_timeout;
+        if (!channel->WaitForConnected(deadline)) {
+            std::string msg{format(
+                    "It took too long (> {} ms) to reach out the server on \"{}\"",
+                    MilliSec{params_.connect_timeout}.count(), params_.addr_uri)};
+            TEC_TRACE("!!! Error: {}.", msg);
+            return Result{msg, Result::Kind::GrpcErr};
+        }
+        return channel;
+    }
+
+public:
 
     /**
      *  @brief Connect to a gRPC server.
      *
      *  1) Sets gRPC channel arguments as specified in params_.
      *
-     *  2) Creates the gRPC channel.
+     *  2) Creates the gRPC channel and connects to a server, see open_channel().
      *
-     *  3) Connects to a server using `addr_uri' and `connect_timeout'
-     *  provided in `params_'.
+     *  3) Creates the stub.
      *
      *  @return tec::Result
      */
@@ -147,19 +200,15 @@ public:
         // Set channel arguments. Can be overwritten.
         set_channel_arguments();
 
-        // Create a channel.
-        // If failed, a lame channel (one on which all operations fail) is created.
-        channel_ = channel_builder_.fptr(params_.addr_uri, credentials_, arguments_);
-
-        // Connect to the server with timeout.
-        auto deadline = std::chrono::system_clock::now() + params_.connect_timeout;
-        if (!channel_->WaitForConnected(deadline)) {
-            std::string msg{format(
-                    "It took too long (> % ms) to reach out the server on \"{}\"",
-                    MilliSec{params_.connect_timeout}.count(), params_.addr_uri)};
-            TEC_TRACE("!!! Error: {}.", msg);
-            return {msg, Result::Kind::GrpcErr};
+        m_connects_->inc();
+        BasicStopwatch<MonoClock> sw;
+        auto channel = open_channel();
+        m_connect_latency_->record(sw.elapsed());
+        if( !channel ) {
+            m_connect_failures_->inc();
+            return std::move(channel).error();
         }
+        channel_ = std::move(channel).value();
 
         // Create a stub.
         stub_ = TService::NewStub(channel_);
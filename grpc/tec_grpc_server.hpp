@@ -35,6 +35,8 @@ SOFTWARE.
 #include "tec/tec_trace.hpp"
 #include "tec/tec_server.hpp" // IWYU pragma: keep
 #include "tec/grpc/tec_grpc.hpp" // IWYU pragma: keep
+#include "tec/tec_expected.hpp"
+#include "tec/tec_metrics.hpp"
 #include "tec/tec_utils.hpp"
 
 
@@ -90,6 +92,11 @@ protected:
     std::unique_ptr<TServer> server_;
     std::shared_ptr<TCredentials> credentials_;
 
+    //! Standard metrics, labelled with `addr_uri'.
+    std::shared_ptr<metrics::Counter> m_starts_;
+    std::shared_ptr<metrics::Counter> m_start_failures_;
+    std::shared_ptr<metrics::Histogram> m_rpc_latency_;
+
 protected:
 
     /**
@@ -146,13 +153,63 @@ protected:
         TEC_TRACE("CompressionLevel is set to {}.", params_.compression_level);
     }
 
+
+    /**
+     * @brief      Registers the service, builds and starts the server.
+     *
+     * @details    Called from start(). Can be overwritten.
+     *
+     * @param      service The service to register, must outlive the server.
+     * @return     tec::Expected<std::unique_ptr<TServer>>
+     */
+    virtual Expected<std::unique_ptr<TServer>> build(TService& service) {
+        TEC_ENTER("GrpcServer::build");
+
+        // Set builder plugins.
+        set_plugins();
+
+        TBuilder builder;
+
+        // Listen on the given address with given authentication mechanism.
+        builder.AddListeningPort(params_.addr_uri, credentials_);
+
+        // Set builder options.
+        set_builder_options(builder);
+
+        // Register a "service" as the instance through which we'll communicate with
+        // clients. In this case it corresponds to a *synchronous* service.
+        builder.RegisterService(&service);
+
+        // Finally assemble the server.
+        TEC_TRACE("starting gRPC server on {} ...", params_.addr_uri);
+        std::unique_ptr<TServer> server = builder.BuildAndStart();
+        if( !server ) {
+            auto errmsg = format("gRPC Server cannot start on \"{}\"", params_.addr_uri);
+            TEC_TRACE("!!! Error: {}.", errmsg);
+            return Result{errmsg, Result::Kind::GrpcErr};
+        }
+        return server;
+    }
+
 public:
 
     GrpcServer(const TParams& params, const std::shared_ptr<TCredentials>& credentials)
         : params_(params)
         , credentials_(credentials)
+        , m_starts_{metrics::registry().instance<metrics::Counter>(
+                "tec_grpc_server_starts_total", "gRPC server start attempts.",
+                metrics::label("addr", params_.addr_uri))}
+        , m_start_failures_{metrics::registry().instance<metrics::Counter>(
+                "tec_grpc_server_start_failures_total", "gRPC server start failures.",
+                metrics::label("addr", params_.addr_uri))}
+        , m_rpc_latency_{metrics::registry().instance<metrics::Histogram>(
+                "tec_grpc_server_rpc_latency_ns", "RPC handler latency.",
+                metrics::label("addr", params_.addr_uri))}
     {}
 
+    //! RPC latency histogram to be fed by service handlers, e.g. with tec::BasicScopedLap.
+    metrics::Histogram& rpc_latency() { return *m_rpc_latency_; }
+
 
     virtual ~GrpcServer() = default;
 
@@ -176,33 +233,16 @@ public:
 
         // Build the server and the service.
         TService service;
-
-        // Set builder plugins.
-        set_plugins();
-
-        TBuilder builder;
-
-        // Listen on the given address with given authentication mechanism.
-        builder.AddListeningPort(params_.addr_uri, credentials_);
-
-        // Set builder options.
-        set_builder_options(builder);
-
-        // Register a "service" as the instance through which we'll communicate with
-        // clients. In this case it corresponds to a *synchronous* service.
-        builder.RegisterService(&service);
-
-        // Finally assemble the server.
-        TEC_TRACE("starting gRPC server on {} ...", params_.addr_uri);
-        server_ = builder.BuildAndStart();
-        if( !server_ ) {
-            auto errmsg = format("gRPC Server cannot start on \"{}\"", params_.addr_uri);
-            TEC_TRACE("!!! Error: %.", errmsg);
-            result = {errmsg, Result::Kind::GrpcErr};
+        m_starts_->inc();
+        auto server = build(service);
+        if( !server ) {
+            m_start_failures_->inc();
+            result = std::move(server).error();
             // Signal that the server started, set error result.
             sig_started.set();
             return;
         }
+        server_ = std::move(server).value();
 
         TEC_TRACE("server listening on \"{}\".", params_.addr_uri);
 
@@ -312,7 +312,7 @@ protected:
         if( !result.ok() ) {
             daemon_->terminate();
             daemon_.reset(nullptr);
-            SetError(ERROR_CAN_NOT_COMPLETE, result.code());
+            SetError(ERROR_CAN_NOT_COMPLETE, result.code.value_or(tec::Result::ErrCode::Unspecified));
             return;
         }
 
@@ -324,7 +324,7 @@ protected:
         if( daemon_ ) {
             auto result = daemon_->terminate();
             if( !result.ok() ) {
-                SetError(WAIT_TIMEOUT, result.code());
+                SetError(WAIT_TIMEOUT, result.code.value_or(tec::Result::ErrCode::Unspecified));
                 return;
             }
         }
@@ -0,0 +1,154 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+#include <chrono>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_coro.hpp"
+#include "tec/tec_semaphore.hpp"
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/tec_worker.hpp"
+
+using namespace std::chrono_literals;
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                   A message carrying its reply
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct Msg {
+    using cmd_t = tec::Message::cmd_t;
+
+    static constexpr const cmd_t CMD_SQUARE{1};
+    static constexpr const cmd_t CMD_FLOW{2};
+
+    cmd_t command;
+    int arg;
+    tec::Completion<int> reply;
+
+    bool quit() const { return command == tec::Message::QUIT; }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*              A plain worker replying after a while
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct SquareParams: public tec::WorkerParams {};
+
+class Square: public tec::Worker<SquareParams, Msg> {
+public:
+    explicit Square(const SquareParams& params): tec::Worker<SquareParams, Msg>(params) {}
+
+protected:
+    void process(const Msg& msg) override {
+        std::this_thread::sleep_for(20ms);
+        msg.reply.complete(msg.arg * msg.arg);
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*            A multi-step flow written as a coroutine
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct FlowParams: public tec::WorkerParams {};
+
+class Flow: public tec::CoWorker<FlowParams, Msg> {
+    Square& square_;
+    const AsyncSignal& go_;
+
+public:
+    AsyncSignal done;
+
+    Flow(const FlowParams& params, Square& square, const AsyncSignal& go)
+        : tec::CoWorker<FlowParams, Msg>(params)
+        , square_{square}
+        , go_{go}
+    {}
+
+protected:
+    // Asks the other worker, gives up after `timeout`.
+    tec::Task<int> ask(int arg, tec::MilliSec timeout) {
+        Msg req{Msg::CMD_SQUARE, arg, {}};
+        square_.send(req);
+        auto value = co_await req.reply.wait_for(timeout);
+        co_return value.value_or(-1);
+    }
+
+    tec::Task<> handle(Msg msg) override {
+        if( msg.command != Msg::CMD_FLOW ) {
+            co_return;
+        }
+        tec::BasicStopwatch<tec::MonoClock> sw;
+        const auto ms = [&sw] { return sw.elapsed() / 1000000; };
+
+        tec::println("[{} ms] flow started, waiting for `go' ...", ms());
+        co_await tec::wait(go_);
+        tec::println("[{} ms] got `go'", ms());
+
+        co_await tec::sleep_for(50ms);
+        tec::println("[{} ms] slept 50 ms", ms());
+
+        const int a = co_await ask(msg.arg, tec::MilliSec{500});
+        tec::println("[{} ms] {}^2 = {}", ms(), msg.arg, a);
+
+        const int b = co_await ask(a, tec::MilliSec{5});
+        tec::println("[{} ms] {}^2 = {} (timed out)", ms(), a, b);
+
+        const bool late = co_await tec::wait_for(done, 10ms);
+        tec::println("[{} ms] `done' not set: {}", ms(), !late);
+
+        done.set();
+    }
+};
+
+
+int main() {
+    AsyncSignal go;
+
+    Square square{SquareParams{}};
+    Flow flow{FlowParams{}, square, go};
+    square.run();
+    flow.run();
+
+    flow.send({Msg::CMD_FLOW, 7, {}});
+
+    // The flow is suspended: the worker thread is free meanwhile.
+    std::this_thread::sleep_for(100ms);
+    go.set();
+
+    flow.done.wait();
+    flow.terminate();
+    square.terminate();
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_prometheus.hpp"
+#include "tec/tec_server.hpp"
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_trace.hpp"
+#include "tec/tec_utils.hpp"
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                    Test Prometheus exporter
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+using Exporter = tec::ServerWorker<tec::PrometheusParams, tec::PrometheusServer>;
+
+
+// Minimal HTTP client: sends `GET path` and returns the whole response.
+std::string scrape(int port, const std::string& path) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(static_cast<uint16_t>(port));
+    ::inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if( ::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0 ) {
+        ::close(fd);
+        return {};
+    }
+    const std::string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    [[maybe_unused]] auto n = ::send(fd, req.data(), req.size(), 0);
+    std::string resp;
+    char buf[4096];
+    ssize_t len;
+    while( (len = ::recv(fd, buf, sizeof(buf), 0)) > 0 ) {
+        resp.append(buf, static_cast<size_t>(len));
+    }
+    ::close(fd);
+    return resp;
+}
+
+
+int main() {
+    // Some application metrics.
+    auto requests = tec::metrics::registry().counter(
+        "app_requests_total", "Requests handled.", tec::metrics::label("handler", "echo"));
+    auto latency = tec::metrics::registry().histogram(
+        "app_request_duration_ns", "Request duration.", tec::metrics::label("handler", "echo"));
+    for( int i = 0; i < 1000; ++i ) {
+        tec::BasicScopedLap<tec::metrics::Histogram> lap(*latency);
+        requests->inc();
+    }
+
+    // Pick a free port and refresh often for the demo.
+    tec::PrometheusParams params;
+    params.port = 0;
+    params.refresh_interval = tec::MilliSec{100};
+    auto server = std::make_unique<tec::PrometheusServer>(params);
+    auto exporter_server = server.get();
+    Exporter exporter(params, std::move(server));
+
+    auto result = exporter.run();
+    if( !result ) {
+        tec::println("Exporter failed: {}", result);
+        return result.code.value_or(tec::Result::ErrCode::Unspecified);
+    }
+    tec::println("Exporter listens on 127.0.0.1:{}", exporter_server->port());
+
+    // Wait for at least one refresh so server metrics show up.
+    std::this_thread::sleep_for(tec::MilliSec{250});
+    tec::println("\n*** GET /metrics\n{}", scrape(exporter_server->port(), "/metrics"));
+    tec::println("*** GET /\n{}", scrape(exporter_server->port(), "/"));
+
+    result = exporter.terminate();
+    tec::println("Exited with {}", result);
+    return result.code.value_or(0);
+}
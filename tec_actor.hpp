@@ -0,0 +1,645 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_actor.hpp
+ *   @brief Lightweight actors multiplexed over a thread pool.
+ *
+ *  An Actor has the init()/process()/finalize() callbacks of a Worker
+ *  but no thread of its own: an ActorSystem runs many actors on a few
+ *  pool threads. An actor with pending messages is scheduled once; a
+ *  pool thread then processes up to `quantum` messages in a row and
+ *  reschedules it if more are pending. process() runs to completion
+ *  and never runs concurrently for the same actor.
+ *
+ *  @code
+ *  class Counter: public tec::Actor<> {
+ *      void process(const tec::Message& msg) override { ... }
+ *  };
+ *
+ *  tec::ActorSystem system{tec::ActorSystemParams{}};
+ *  auto* counter = system.spawn<Counter>();
+ *  system.run();
+ *  counter->send({CMD_INC});
+ *  ...
+ *  system.terminate();
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_queue.hpp"
+#include "tec/tec_trace.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+class ActorSystem;
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Mailbox
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+/**
+ * @class      MpscMailbox
+ * @brief      Unbounded multi-producer single-consumer queue.
+ *
+ * @details    Dmitry Vyukov's intrusive MPSC queue: push() is one
+ * atomic exchange and never blocks, pop() is wait-free for the
+ * single consumer. An empty mailbox holds only the stub node.
+ * pop() may return nullptr while a push() is halfway done; the
+ * element shows up once the producer links it.
+ */
+template <typename TMessage>
+class MpscMailbox {
+    struct Node {
+        std::atomic<Node*> next;
+        TMessage msg;
+    };
+
+    std::atomic<Node*> head_;  //!< Last pushed, producers.
+    Node* tail_;               //!< Next to pop, consumer.
+    Node stub_;
+
+    void push_node(Node* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head_.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+public:
+    MpscMailbox()
+        : head_{&stub_}
+        , tail_{&stub_}
+        , stub_{}
+    {
+        stub_.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    MpscMailbox(const MpscMailbox&) = delete;
+    MpscMailbox& operator=(const MpscMailbox&) = delete;
+
+    ~MpscMailbox() {
+        TMessage msg;
+        while( pop(msg) ) {}
+    }
+
+    //! Any thread.
+    void push(const TMessage& msg) {
+        push_node(new Node{{nullptr}, msg});
+    }
+
+    //! Consumer only. Returns false if empty or a push is in progress.
+    bool pop(TMessage& msg) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if( tail == &stub_ ) {
+            if( !next ) {
+                return false;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if( !next ) {
+            if( tail != head_.load(std::memory_order_acquire) ) {
+                // A producer has swapped head_ but not linked yet.
+                return false;
+            }
+            push_node(&stub_);
+            next = tail->next.load(std::memory_order_acquire);
+            if( !next ) {
+                return false;
+            }
+        }
+        tail_ = next;
+        msg = std::move(tail->msg);
+        delete tail;
+        return true;
+    }
+
+    //! Consumer only. Taken after pop() has failed, see pushed_since().
+    const void* mark() const { return tail_; }
+
+    //! Any thread. True if a push has started since mark() was taken.
+    bool pushed_since(const void* mark) const {
+        return head_.load(std::memory_order_seq_cst) != mark;
+    }
+};
+
+
+//! Schedulable part of an actor, seen by ActorSystem.
+class ActorCell {
+public:
+    //! Result of one scheduling turn.
+    enum class Turn {
+        Empty,  //!< Mailbox drained.
+        More,   //!< Quantum used up, messages pending.
+        Done,   //!< Finalized, never scheduled again.
+    };
+
+    ActorCell() = default;
+    ActorCell(const ActorCell&) = delete;
+    ActorCell(ActorCell&&) = delete;
+    virtual ~ActorCell() = default;
+
+protected:
+    friend class tec::ActorSystem;
+
+    static constexpr uint8_t kIdle{0};
+    static constexpr uint8_t kScheduled{1};
+
+    //! A new actor is scheduled by spawn() to call init().
+    std::atomic<uint8_t> state_{kScheduled};
+    std::atomic<bool> done_{false};
+    //! Pool threads inside idle(): one of them may still read the
+    //! cell after another thread has finalized it.
+    std::atomic<uint16_t> idling_{0};
+    ActorSystem* system_{nullptr};
+
+    //! Processes up to `quantum` messages, adds their number to `processed`.
+    virtual Turn turn(size_t quantum, size_t& processed) = 0;
+    //! After Turn::Empty: marks the actor idle. Returns true if it has
+    //! to be rescheduled because a message arrived meanwhile.
+    virtual bool idle() = 0;
+    //! Sends the quit message.
+    virtual void quit() = 0;
+
+    //! Called by send(): schedules the actor if it was idle.
+    inline void notify();
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Actor system
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! NOTE: thread attributes (cpus, sched_policy, ...) apply to every pool thread.
+struct ActorSystemParams: public WorkerParams {
+    //! Pool threads, 0 means std::thread::hardware_concurrency().
+    static constexpr const size_t kThreads{0};
+    //! Messages an actor may process per scheduling turn.
+    static constexpr const size_t kQuantum{64};
+
+    size_t threads;
+    size_t quantum;
+
+    ActorSystemParams()
+        : threads{kThreads}
+        , quantum{kQuantum}
+    {
+        name = "actors";
+    }
+};
+
+
+/**
+ * @class      ActorSystem
+ * @brief      Owns actors and runs them on a fixed thread pool.
+ *
+ * @details    Scheduled actors wait in one run queue (a SafeQueue
+ * exported as `tec_queue_depth{queue=<name>}`). Actors are owned by
+ * the system and freed when it is destroyed, so a pointer returned
+ * by spawn() stays valid for the lifetime of the system. Finalized
+ * actors are kept as well, unless reap() frees them: a long-running
+ * system that keeps spawning and finalizing actors must call reap(),
+ * otherwise its memory grows with every actor ever spawned.
+ *
+ * Exports `tec_actor_messages_total`, `tec_actor_turns_total` and
+ * `tec_actor_live`, labelled `system`.
+ */
+class ActorSystem: public Daemon {
+    using Cell = details::ActorCell;
+    using Lock = std::lock_guard<std::mutex>;
+
+    ActorSystemParams params_;
+    size_t quantum_;
+    SafeQueue<Cell*> runq_;
+    std::vector<std::thread> threads_;
+
+    //! All spawned actors.
+    std::vector<std::unique_ptr<Cell>> cells_;
+    //! Finalized actors not freed yet, see reap().
+    std::vector<Cell*> retired_;
+    //! No more spawn(), set by terminate().
+    bool flag_closed_;
+    std::mutex mtx_cells_;
+
+    //! Actors spawned and not finalized yet.
+    size_t live_;
+    std::mutex mtx_live_;
+    std::condition_variable cv_live_;
+
+    //! Pool threads that have applied their attributes, see run().
+    std::vector<Result> started_;
+    std::mutex mtx_started_;
+    std::condition_variable cv_started_;
+
+    bool flag_running_;
+    bool flag_terminated_;
+    std::mutex mtx_state_;
+
+    std::shared_ptr<metrics::Counter> m_messages_;
+    std::shared_ptr<metrics::Counter> m_turns_;
+    std::shared_ptr<metrics::Gauge> m_live_;
+
+    friend class details::ActorCell;
+
+    void schedule(Cell* cell) {
+        runq_.enqueue(cell);
+    }
+
+    //! Called by the pool thread once it is done with `cell`.
+    void retire(Cell* cell) {
+        {
+            Lock lk{mtx_cells_};
+            retired_.push_back(cell);
+        }
+        m_live_->sub();
+        std::lock_guard<std::mutex> lk(mtx_live_);
+        if( --live_ == 0 ) {
+            cv_live_.notify_all();
+        }
+    }
+
+    void execute(Cell* cell) {
+        size_t processed{0};
+        const auto turn = cell->turn(quantum_, processed);
+        m_messages_->inc(processed);
+        m_turns_->inc();
+        switch (turn) {
+        case Cell::Turn::More:
+            // Fairness: back to the end of the run queue.
+            schedule(cell);
+            break;
+        case Cell::Turn::Empty:
+            cell->idling_.fetch_add(1, std::memory_order_relaxed);
+            if( cell->idle() ) {
+                schedule(cell);
+            }
+            cell->idling_.fetch_sub(1, std::memory_order_release);
+            break;
+        case Cell::Turn::Done:
+            retire(cell);
+            break;
+        }
+    }
+
+    static void thread_proc(ActorSystem& system) {
+        const Result result = details::apply_thread_params(system.params_);
+        {
+            Lock lk{system.mtx_started_};
+            system.started_.push_back(result);
+            system.cv_started_.notify_all();
+        }
+        if( !result ) {
+            return;
+        }
+        while( Cell* cell = system.runq_.dequeue() ) {
+            system.execute(cell);
+        }
+    }
+
+    void stop_threads() {
+        for( size_t i = 0; i < threads_.size(); ++i ) {
+            runq_.enqueue(nullptr);
+        }
+        for( auto& t: threads_ ) {
+            t.join();
+        }
+        threads_.clear();
+    }
+
+public:
+    explicit ActorSystem(const ActorSystemParams& params)
+        : params_{params}
+        , quantum_{std::max<size_t>(params.quantum, 1)}
+        , runq_{details::worker_name(params)}
+        , flag_closed_{false}
+        , live_{0}
+        , flag_running_{false}
+        , flag_terminated_{false}
+        , m_messages_{metrics::registry().instance<metrics::Counter>(
+                "tec_actor_messages_total", "Messages processed by actors.",
+                metrics::label("system", details::worker_name(params)))}
+        , m_turns_{metrics::registry().instance<metrics::Counter>(
+                "tec_actor_turns_total", "Actor scheduling turns.",
+                metrics::label("system", details::worker_name(params)))}
+        , m_live_{metrics::registry().instance<metrics::Gauge>(
+                "tec_actor_live", "Actors spawned and not finalized.",
+                metrics::label("system", details::worker_name(params)))}
+    {}
+
+    ActorSystem(const ActorSystem&) = delete;
+    ActorSystem(ActorSystem&&) = delete;
+
+    virtual ~ActorSystem() {
+        terminate();
+    }
+
+    const ActorSystemParams& params() const { return params_; }
+
+    //! Pool threads started by run().
+    size_t threads() const { return threads_.size(); }
+
+    //! Actors spawned and not finalized yet.
+    size_t live() {
+        std::lock_guard<std::mutex> lk(mtx_live_);
+        return live_;
+    }
+
+    /**
+     * @brief      Frees the actors finalized so far.
+     *
+     * @details    Their pointers become invalid: call it only when no
+     * thread may still use a pointer to a done actor, for example when
+     * actors are reached through a directory that drops an entry
+     * before sending quit.
+     *
+     * An actor a pool thread is still leaving (see
+     * ActorCell::idling_) is kept for the next call.
+     *
+     * @return     size_t Actors freed.
+     */
+    size_t reap() {
+        std::vector<std::unique_ptr<Cell>> dead;
+        {
+            Lock lk{mtx_cells_};
+            auto first_free = std::partition(retired_.begin(), retired_.end(), [](const Cell* cell) {
+                return cell->idling_.load(std::memory_order_acquire) != 0;
+            });
+            if( first_free == retired_.end() ) {
+                return 0;
+            }
+            std::sort(first_free, retired_.end());
+            auto first_dead = std::partition(cells_.begin(), cells_.end(), [&](const std::unique_ptr<Cell>& cell) {
+                return !std::binary_search(first_free, retired_.end(), cell.get());
+            });
+            std::move(first_dead, cells_.end(), std::back_inserter(dead));
+            cells_.erase(first_dead, cells_.end());
+            retired_.erase(first_free, retired_.end());
+        }
+        // Destructors run outside the lock.
+        return dead.size();
+    }
+
+    /**
+     * @brief      Creates an actor owned by the system.
+     *
+     * @details    init() is called on a pool thread, after run() if the
+     * system is not running yet. May be called from inside an actor.
+     *
+     * @return     The actor, or nullptr if the system is terminated.
+     */
+    template <typename TActor, typename... Args>
+    TActor* spawn(Args&&... args) {
+        auto actor = std::make_unique<TActor>(std::forward<Args>(args)...);
+        TActor* ptr = actor.get();
+        static_cast<Cell*>(ptr)->system_ = this;
+        {
+            Lock lk{mtx_cells_};
+            if( flag_closed_ ) {
+                return nullptr;
+            }
+            cells_.push_back(std::move(actor));
+            Lock lk_live{mtx_live_};
+            ++live_;
+        }
+        m_live_->add();
+        schedule(ptr);
+        return ptr;
+    }
+
+    //! Starts the pool threads.
+    Result run() override {
+        Lock lk{mtx_state_};
+        TEC_ENTER("ActorSystem::run");
+        if( flag_terminated_ ) {
+            return {"actor system terminated", Result::Kind::RuntimeErr};
+        }
+        if( flag_running_ ) {
+            TEC_TRACE("WARNING: ActorSystem is running already!");
+            return {};
+        }
+
+        size_t count = params_.threads;
+        if( count == 0 ) {
+            count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        started_.clear();
+        for( size_t i = 0; i < count; ++i ) {
+            threads_.emplace_back(thread_proc, std::ref(*this));
+        }
+        std::unique_lock<std::mutex> lk_started(mtx_started_);
+        cv_started_.wait(lk_started, [this, count] { return started_.size() == count; });
+        for( const auto& result: started_ ) {
+            if( !result ) {
+                TEC_TRACE("thread attributes failed: {}.", result);
+                stop_threads();
+                return result;
+            }
+        }
+        flag_running_ = true;
+        TEC_TRACE("{} threads started.", count);
+        return {};
+    }
+
+    /**
+     * @brief      Sends quit to every actor, waits for finalize() and
+     * stops the pool.
+     *
+     * @details    Actors of a system that has never run are freed
+     * without calling init() or finalize().
+     */
+    Result terminate() override {
+        Lock lk{mtx_state_};
+        TEC_ENTER("ActorSystem::terminate");
+        if( flag_terminated_ ) {
+            return {};
+        }
+        flag_terminated_ = true;
+
+        {
+            Lock lk_cells{mtx_cells_};
+            flag_closed_ = true;
+            if( !flag_running_ ) {
+                return {};
+            }
+            for( auto& cell: cells_ ) {
+                cell->quit();
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lk_live(mtx_live_);
+            cv_live_.wait(lk_live, [this] { return live_ == 0; });
+        }
+        TEC_TRACE("all actors finalized.");
+        stop_threads();
+        return {};
+    }
+};
+
+
+void details::ActorCell::notify() {
+    if( state_.exchange(kScheduled, std::memory_order_seq_cst) == kIdle ) {
+        system_->schedule(this);
+    }
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                             Actor
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      Actor
+ * @brief      A Worker without a thread, see ActorSystem.
+ *
+ * @details    An idle Actor<Message> takes about a hundred bytes plus
+ * the members of the derived class; a message in the mailbox costs
+ * one heap node. Sending quit<TMessage>() finalizes the actor,
+ * messages queued behind it are dropped.
+ */
+template <typename TMessage = Message>
+class Actor: public details::ActorCell {
+    details::MpscMailbox<TMessage> mailbox_;
+    Result result_;
+    bool inited_{false};
+
+    void finish(bool call_finalize) {
+        if( call_finalize ) {
+            result_ = finalize();
+        }
+        done_.store(true, std::memory_order_release);
+    }
+
+protected:
+    Turn turn(size_t quantum, size_t& processed) override {
+        if( !inited_ ) {
+            inited_ = true;
+            result_ = init();
+            if( !result_ ) {
+                // As with Worker, finalize() is not called.
+                finish(false);
+                return Turn::Done;
+            }
+        }
+        TMessage msg;
+        for( size_t i = 0; i < quantum; ++i ) {
+            if( !mailbox_.pop(msg) ) {
+                return Turn::Empty;
+            }
+            if( msg.quit() ) {
+                finish(true);
+                return Turn::Done;
+            }
+            process(msg);
+            ++processed;
+        }
+        return Turn::More;
+    }
+
+    bool idle() override {
+        // Once idle, another pool thread may own the mailbox:
+        // only its producer side is read after the store.
+        const void* mark = mailbox_.mark();
+        state_.store(kIdle, std::memory_order_seq_cst);
+        // A sender that saw us scheduled may have pushed after the last pop().
+        return mailbox_.pushed_since(mark) &&
+            state_.exchange(kScheduled, std::memory_order_seq_cst) == kIdle;
+    }
+
+    void quit() override { send(tec::quit<TMessage>()); }
+
+    //! The system running this actor, e.g. to spawn() more actors.
+    ActorSystem& system() { return *system_; }
+
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     *
+     *                        Actor callbacks
+     *
+     *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    //! Called before the first message. If it fails, the actor is done
+    //! and finalize() **will not be called**.
+    virtual Result init() { return {}; }
+
+    //! Called for every message except quit.
+    virtual void process(const TMessage&) {}
+
+    //! Called on quit if init() succeeded.
+    virtual Result finalize() { return {}; }
+
+public:
+    Actor() = default;
+
+    /**
+     * @brief      Queues a message, any thread.
+     * @return     false if the actor is done.
+     */
+    bool send(const TMessage& msg) {
+        if( done_.load(std::memory_order_acquire) ) {
+            return false;
+        }
+        mailbox_.push(msg);
+        notify();
+        return true;
+    }
+
+    //! The actor has been finalized (or its init() failed).
+    bool done() const { return done_.load(std::memory_order_acquire); }
+
+    //! Result of init(), then of finalize(). Valid once done().
+    const Result& result() const { return result_; }
+};
+
+
+} // ::tec
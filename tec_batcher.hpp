@@ -0,0 +1,368 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_batcher.hpp
+ *   @brief Size- and time-triggered micro-batching.
+ *
+ *  A Batcher collects items and hands them to a handler as one
+ *  std::vector, moved, on whichever comes first:
+ *
+ *  - `max_items` items;
+ *  - `max_bytes` bytes, as measured by a sizer;
+ *  - `max_delay` after the first item of the batch.
+ *
+ *  BatchWorker wires a Batcher to the Worker timers: messages sent to
+ *  it arrive in process_batch() in batches. The same holds for
+ *  client-side RPC batching: send one request per batch from
+ *  process_batch().
+ *
+ *  @code
+ *  class Writer: public tec::BatchWorker<Params, Row> {
+ *      void process_batch(std::vector<Row>&& rows) override { db.insert(rows); }
+ *  };
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Batcher
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct BatcherParams {
+    static constexpr const size_t kMaxItems{256};
+    static constexpr const size_t kMaxBytes{0};
+    static constexpr const MicroSec kMaxDelay{1000};
+
+    //! Batcher name, used to label metrics. Default is "batcher".
+    std::string name;
+    //! Flush at this many items.
+    size_t max_items;
+    //! Flush at this many bytes, 0 for no limit.
+    size_t max_bytes;
+    //! Flush this long after the first item of a batch, 0 for no limit.
+    MicroSec max_delay;
+
+    BatcherParams()
+        : name{"batcher"}
+        , max_items{kMaxItems}
+        , max_bytes{kMaxBytes}
+        , max_delay{kMaxDelay}
+    {}
+};
+
+
+namespace details {
+
+template <typename T, typename = void>
+struct has_size: std::false_type {};
+
+template <typename T>
+struct has_size<T, std::void_t<decltype(std::declval<const T&>().size())>>: std::true_type {};
+
+//! Default sizer: `item.size()` if T has one, otherwise sizeof(T).
+template <typename T>
+size_t item_bytes(const T& item) {
+    if constexpr ( has_size<T>::value ) {
+        return static_cast<size_t>(item.size());
+    }
+    else {
+        return sizeof(item);
+    }
+}
+
+} // ::details
+
+
+/**
+ * @class      Batcher
+ * @brief      Accumulates items and flushes them in batches.
+ *
+ * @details    Not thread-safe: use it from one thread, e.g. a worker.
+ * The time trigger needs a timer: `arm(delay, fn)` must call `fn` on
+ * the same thread after `delay` (see BatchWorker). Without one, the
+ * deadline is checked by add() and poll() only.
+ *
+ * A batch that has been flushed early leaves its timer behind; a
+ * generation number makes such a timer a no-op.
+ *
+ * Exports `tec_batcher_batches_total{reason=items|bytes|time|flush}`
+ * and `tec_batcher_items_total`, labelled `batcher`.
+ */
+template <typename T>
+class Batcher {
+public:
+    using Batch = std::vector<T>;
+    using Handler = std::function<void(Batch&&)>;
+    using Sizer = std::function<size_t(const T&)>;
+    using Clock = std::chrono::steady_clock;
+    using Arm = std::function<void(MicroSec, std::function<void()>)>;
+
+private:
+    BatcherParams params_;
+    Handler handler_;
+    Sizer sizer_;
+    Arm arm_;
+
+    Batch batch_;
+    size_t bytes_;
+    Clock::time_point deadline_;
+    uint64_t generation_;
+
+    std::shared_ptr<metrics::Counter> m_by_items_;
+    std::shared_ptr<metrics::Counter> m_by_bytes_;
+    std::shared_ptr<metrics::Counter> m_by_time_;
+    std::shared_ptr<metrics::Counter> m_by_flush_;
+    std::shared_ptr<metrics::Counter> m_items_;
+
+    static std::shared_ptr<metrics::Counter> batches(const std::string& name, const char* reason) {
+        return metrics::registry().instance<metrics::Counter>(
+            "tec_batcher_batches_total", "Batches handed off, by trigger.",
+            metrics::label("batcher", name) + "," + metrics::label("reason", reason));
+    }
+
+    void hand_off(metrics::Counter& reason) {
+        reason.inc();
+        m_items_->inc(batch_.size());
+        ++generation_;
+        bytes_ = 0;
+        Batch batch;
+        batch.reserve(params_.max_items);
+        batch.swap(batch_);
+        handler_(std::move(batch));
+    }
+
+public:
+    Batcher(const BatcherParams& params, Handler handler, Sizer sizer = {}, Arm arm = {})
+        : params_{params}
+        , handler_{std::move(handler)}
+        , sizer_{std::move(sizer)}
+        , arm_{std::move(arm)}
+        , bytes_{0}
+        , generation_{0}
+        , m_by_items_{batches(params.name, "items")}
+        , m_by_bytes_{batches(params.name, "bytes")}
+        , m_by_time_{batches(params.name, "time")}
+        , m_by_flush_{batches(params.name, "flush")}
+        , m_items_{metrics::registry().instance<metrics::Counter>(
+                "tec_batcher_items_total", "Items handed off in batches.",
+                metrics::label("batcher", params.name))}
+    {
+        if( params_.max_items == 0 ) {
+            params_.max_items = 1;
+        }
+        batch_.reserve(params_.max_items);
+    }
+
+    Batcher(const Batcher&) = delete;
+    Batcher& operator=(const Batcher&) = delete;
+
+    const BatcherParams& params() const { return params_; }
+
+    //! Items in the current batch.
+    size_t size() const { return batch_.size(); }
+
+    //! Bytes in the current batch, 0 if there is no byte limit.
+    size_t bytes() const { return bytes_; }
+
+    //! Adds an item, handing off the batch if a limit is reached.
+    void add(T item) {
+        if( batch_.empty() && params_.max_delay.count() > 0 ) {
+            deadline_ = Clock::now() + params_.max_delay;
+            if( arm_ ) {
+                arm_(params_.max_delay, [this, gen = generation_] {
+                    if( gen == generation_ && !batch_.empty() ) {
+                        hand_off(*m_by_time_);
+                    }
+                });
+            }
+        }
+        else if( !arm_ && params_.max_delay.count() > 0 && Clock::now() >= deadline_ ) {
+            hand_off(*m_by_time_);
+            add(std::move(item));
+            return;
+        }
+
+        if( params_.max_bytes > 0 ) {
+            bytes_ += sizer_ ? sizer_(item) : details::item_bytes(item);
+        }
+        batch_.push_back(std::move(item));
+
+        if( batch_.size() >= params_.max_items ) {
+            hand_off(*m_by_items_);
+        }
+        else if( params_.max_bytes > 0 && bytes_ >= params_.max_bytes ) {
+            hand_off(*m_by_bytes_);
+        }
+    }
+
+    //! Hands off the current batch if its deadline has passed.
+    //! Returns true if it did.
+    bool poll() {
+        if( !batch_.empty() && params_.max_delay.count() > 0 && Clock::now() >= deadline_ ) {
+            hand_off(*m_by_time_);
+            return true;
+        }
+        return false;
+    }
+
+    //! Hands off the current batch, if any.
+    void flush() {
+        if( !batch_.empty() ) {
+            hand_off(*m_by_flush_);
+        }
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Batch Worker
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+//! BatchWorker without process(): owns the batcher and the worker thread.
+template <typename TWorkerParams, typename TMessage, typename TItem,
+          typename Duration, typename TStats>
+class BatchWorkerCore: public Worker<TWorkerParams, TMessage, Duration, TStats> {
+    using Base = Worker<TWorkerParams, TMessage, Duration, TStats>;
+
+protected:
+    Batcher<TItem> batcher_;
+
+private:
+    //! Set by ~BatchWorkerCore(): batches have nowhere to go.
+    std::atomic<bool> orphaned_;
+
+public:
+    BatchWorkerCore(const TWorkerParams& params, const BatcherParams& batch,
+                    typename Batcher<TItem>::Sizer sizer = {}, Launch launch = Launch::Eager)
+        : Base(params, launch)
+        , batcher_{batch,
+                   [this](std::vector<TItem>&& items) {
+                       if( !orphaned_.load(std::memory_order_acquire) ) {
+                           process_batch(std::move(items));
+                       }
+                   },
+                   std::move(sizer),
+                   [this](MicroSec delay, std::function<void()> fn) {
+                       Base::start_timer(delay, std::move(fn));
+                   }}
+        , orphaned_{false}
+    {}
+
+    virtual ~BatchWorkerCore() {
+        // Stop the loop while batcher_ still exists.
+        if( this->thread_.joinable() ) {
+            orphaned_.store(true, std::memory_order_release);
+            this->terminate();
+        }
+    }
+
+protected:
+    //! Called on the worker thread with a batch.
+    virtual void process_batch(std::vector<TItem>&& batch) = 0;
+
+    Result finalize() override {
+        batcher_.flush();
+        return {};
+    }
+};
+
+//! Adds every message to the batch as a TItem.
+template <typename TCore, typename TMessage, typename TItem,
+          bool = std::is_constructible_v<TItem, const TMessage&>>
+class BatchProcess: public TCore {
+public:
+    using TCore::TCore;
+
+protected:
+    void process(const TMessage& msg) override {
+        this->batcher_.add(TItem(msg));
+    }
+};
+
+//! A TItem can't be built from a TMessage: the derived class has to
+//! convert messages in its own process().
+template <typename TCore, typename TMessage, typename TItem>
+class BatchProcess<TCore, TMessage, TItem, false>: public TCore {
+public:
+    using TCore::TCore;
+
+protected:
+    void process(const TMessage& msg) override = 0;
+};
+
+} // ::details
+
+
+/**
+ * @class      BatchWorker
+ * @brief      A Worker that processes its messages in batches.
+ *
+ * @details    By default every message is added to the batch as a
+ * TItem. Override process() to convert or filter messages, adding
+ * them with `batcher_.add()`; if a TItem can't be built from a
+ * TMessage, process() is pure and must be overridden. The last batch
+ * is handed off by finalize(); call BatchWorker::finalize() if you
+ * override it.
+ *
+ * @note A derived class must call terminate() in its own destructor:
+ * ~BatchWorker() stops the thread too, but by then process_batch()
+ * of the derived class is gone and the last batch is dropped.
+ */
+template <typename TWorkerParams, typename TMessage = Message, typename TItem = TMessage,
+          typename Duration = MilliSec, typename TStats = NoStats>
+class BatchWorker: public details::BatchProcess<
+    details::BatchWorkerCore<TWorkerParams, TMessage, TItem, Duration, TStats>, TMessage, TItem> {
+public:
+    using details::BatchProcess<
+        details::BatchWorkerCore<TWorkerParams, TMessage, TItem, Duration, TStats>, TMessage, TItem>::BatchProcess;
+};
+
+} // ::tec
@@ -0,0 +1,467 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_buffer.hpp
+ *   @brief Ref-counted zero-copy byte buffers.
+ *
+ *  tec::Buffer is a rope: a sequence of slices of ref-counted blocks.
+ *  Copying, slicing and concatenating a Buffer shares the blocks and
+ *  never copies bytes, so a large payload can pass from a gRPC handler
+ *  through Workers to a file writer unchanged. Blocks are allocated by
+ *  the Buffer, or adopted from memory owned by someone else.
+ *
+ *  @code
+ *  tec::Buffer header = tec::Buffer::copy(&hdr, sizeof(hdr));
+ *  tec::Buffer body = tec::Buffer::adopt(std::move(bytes));   // std::string, no copy
+ *  tec::Buffer frame = header + body.slice(0, 4096);
+ *
+ *  std::vector<iovec> iov = frame.iovecs();
+ *  ::writev(fd, iov.data(), static_cast<int>(iov.size()));
+ *  @endcode
+ *
+ *  A Buffer is 40 bytes and fits inline in a tec::SmallMessage.
+ *  See grpc/tec_grpc_buffer.hpp for gRPC and protobuf conversions.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+
+
+namespace tec {
+
+namespace details {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Shared blocks
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Storage shared by Buffer slices.
+struct BufferBlock {
+    std::atomic<uint32_t> refs;
+    void (*destroy)(BufferBlock*);
+};
+
+inline void buffer_retain(BufferBlock* block) {
+    block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void buffer_release(BufferBlock* block) {
+    if( block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+        block->destroy(block);
+    }
+}
+
+//! A block whose bytes follow the header.
+inline BufferBlock* buffer_alloc(size_t size, unsigned char** data) {
+    void* p = ::operator new(sizeof(BufferBlock) + size);
+    auto* block = new (p) BufferBlock{{1}, [](BufferBlock* b) {
+        b->~BufferBlock();
+        ::operator delete(b);
+    }};
+    *data = reinterpret_cast<unsigned char*>(block + 1);
+    return block;
+}
+
+//! A block that keeps `owner` alive.
+template <typename TOwner>
+struct AdoptedBlock: BufferBlock {
+    TOwner owner;
+
+    explicit AdoptedBlock(TOwner&& o)
+        : BufferBlock{{1}, [](BufferBlock* b) { delete static_cast<AdoptedBlock*>(b); }}
+        , owner{std::move(o)}
+    {}
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                             Buffer
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      Buffer
+ * @brief      An immutable rope of ref-counted byte slices.
+ *
+ * @details    The bytes are never modified once shared. A Buffer object
+ * is not thread-safe, but copies may be used on different threads.
+ * The first slice is held inline, so a single-slice Buffer does not
+ * allocate beyond its block.
+ */
+class Buffer {
+public:
+    //! A slice of a block.
+    struct Segment {
+        details::BufferBlock* block;
+        const unsigned char* data;
+        size_t size;
+    };
+
+private:
+    Segment first_;
+    std::unique_ptr<std::vector<Segment>> rest_;
+    size_t size_;
+
+    size_t count() const {
+        return first_.size == 0 ? 0 : 1 + (rest_ ? rest_->size() : 0);
+    }
+
+    Segment& at(size_t i) { return i == 0 ? first_ : (*rest_)[i - 1]; }
+    const Segment& at(size_t i) const { return i == 0 ? first_ : (*rest_)[i - 1]; }
+
+    //! Appends a segment whose reference is transferred to the buffer.
+    void push(const Segment& seg) {
+        if( seg.size == 0 ) {
+            details::buffer_release(seg.block);
+            return;
+        }
+        if( first_.size == 0 ) {
+            first_ = seg;
+        }
+        else {
+            Segment& last = at(count() - 1);
+            if( last.block == seg.block && last.data + last.size == seg.data ) {
+                // Adjacent slices of one block, e.g. re-joined halves.
+                last.size += seg.size;
+                details::buffer_release(seg.block);
+            }
+            else {
+                if( !rest_ ) {
+                    rest_ = std::make_unique<std::vector<Segment>>();
+                }
+                rest_->push_back(seg);
+            }
+        }
+        size_ += seg.size;
+    }
+
+    explicit Buffer(details::BufferBlock* block, const unsigned char* data, size_t size)
+        : Buffer()
+    {
+        push({block, data, size});
+    }
+
+public:
+    Buffer(): first_{nullptr, nullptr, 0}, size_{0} {}
+
+    Buffer(const Buffer& other): Buffer() {
+        append(other);
+    }
+
+    Buffer(Buffer&& other) noexcept
+        : first_{other.first_}
+        , rest_{std::move(other.rest_)}
+        , size_{other.size_}
+    {
+        other.first_ = {nullptr, nullptr, 0};
+        other.size_ = 0;
+    }
+
+    Buffer& operator=(const Buffer& other) {
+        if( this != &other ) {
+            Buffer tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    Buffer& operator=(Buffer&& other) noexcept {
+        if( this != &other ) {
+            clear();
+            first_ = other.first_;
+            rest_ = std::move(other.rest_);
+            size_ = other.size_;
+            other.first_ = {nullptr, nullptr, 0};
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~Buffer() { clear(); }
+
+    //! A new block holding a copy of `size` bytes.
+    static Buffer copy(const void* data, size_t size) {
+        if( size == 0 ) {
+            return {};
+        }
+        unsigned char* p;
+        auto* block = details::buffer_alloc(size, &p);
+        std::memcpy(p, data, size);
+        return Buffer(block, p, size);
+    }
+
+    static Buffer copy(const std::string& s) {
+        return copy(s.data(), s.size());
+    }
+
+    //! A new block of `size` bytes, `*data` receives them.
+    //! Fill it before the buffer is shared.
+    static Buffer allocate(size_t size, unsigned char** data) {
+        if( size == 0 ) {
+            *data = nullptr;
+            return {};
+        }
+        auto* block = details::buffer_alloc(size, data);
+        return Buffer(block, *data, size);
+    }
+
+    //! Adopts a container of bytes (std::string, std::vector<char>, ...) without copying.
+    template <typename TContainer,
+              typename = std::enable_if_t<!std::is_lvalue_reference_v<TContainer>
+                                          && sizeof(typename TContainer::value_type) == 1>>
+    static Buffer adopt(TContainer&& bytes) {
+        if( bytes.empty() ) {
+            return {};
+        }
+        auto* block = new details::AdoptedBlock<TContainer>(std::move(bytes));
+        const auto* data = reinterpret_cast<const unsigned char*>(block->owner.data());
+        return Buffer(block, data, block->owner.size());
+    }
+
+    /**
+     * @brief      Adopts `size` bytes at `data` owned by someone else.
+     *
+     * @param      release Called once, on the thread dropping the last
+     * slice, when the bytes are no longer referenced.
+     */
+    template <typename TRelease>
+    static Buffer adopt(const void* data, size_t size, TRelease release) {
+        struct Releaser {
+            TRelease fn;
+            bool armed;
+            Releaser(TRelease&& f): fn{std::move(f)}, armed{true} {}
+            Releaser(Releaser&& other): fn{std::move(other.fn)}, armed{other.armed} {
+                other.armed = false;
+            }
+            ~Releaser() {
+                if( armed ) {
+                    fn();
+                }
+            }
+        };
+        auto* block = new details::AdoptedBlock<Releaser>(Releaser(std::move(release)));
+        return Buffer(block, static_cast<const unsigned char*>(data), size);
+    }
+
+    //! Refers to static or otherwise immortal bytes.
+    static Buffer view(const void* data, size_t size) {
+        return adopt(data, size, []{});
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    //! Number of slices.
+    size_t segments() const { return count(); }
+    const Segment& segment(size_t i) const { return at(i); }
+
+    //! Bytes of a single-slice buffer, nullptr if empty or fragmented.
+    const unsigned char* contiguous() const {
+        return count() == 1 ? first_.data : nullptr;
+    }
+
+    void clear() {
+        const size_t n = count();
+        for( size_t i = 0; i < n; ++i ) {
+            details::buffer_release(at(i).block);
+        }
+        first_ = {nullptr, nullptr, 0};
+        rest_.reset();
+        size_ = 0;
+    }
+
+    //! Appends the slices of `other`, sharing them.
+    Buffer& append(const Buffer& other) {
+        const size_t n = other.count();
+        for( size_t i = 0; i < n; ++i ) {
+            const Segment& seg = other.at(i);
+            details::buffer_retain(seg.block);
+            push(seg);
+        }
+        return *this;
+    }
+
+    //! Appends the slices of `other`, taking them.
+    Buffer& append(Buffer&& other) {
+        if( empty() ) {
+            return *this = std::move(other);
+        }
+        const size_t n = other.count();
+        for( size_t i = 0; i < n; ++i ) {
+            push(other.at(i));
+        }
+        other.first_ = {nullptr, nullptr, 0};
+        other.rest_.reset();
+        other.size_ = 0;
+        return *this;
+    }
+
+    Buffer& operator+=(const Buffer& other) { return append(other); }
+    Buffer& operator+=(Buffer&& other) { return append(std::move(other)); }
+
+    friend Buffer operator+(Buffer lhs, const Buffer& rhs) {
+        lhs.append(rhs);
+        return lhs;
+    }
+
+    //! Bytes [offset, offset + len) sharing the blocks, clamped to size().
+    Buffer slice(size_t offset, size_t len = SIZE_MAX) const {
+        Buffer out;
+        if( offset >= size_ ) {
+            return out;
+        }
+        len = std::min(len, size_ - offset);
+        const size_t n = count();
+        for( size_t i = 0; i < n && len > 0; ++i ) {
+            const Segment& seg = at(i);
+            if( offset >= seg.size ) {
+                offset -= seg.size;
+                continue;
+            }
+            const size_t take = std::min(seg.size - offset, len);
+            details::buffer_retain(seg.block);
+            out.push({seg.block, seg.data + offset, take});
+            offset = 0;
+            len -= take;
+        }
+        return out;
+    }
+
+    //! Drops the first `n` bytes, e.g. after a partial writev().
+    void consume(size_t n) {
+        if( n >= size_ ) {
+            clear();
+            return;
+        }
+        *this = slice(n);
+    }
+
+    //! Slices as iovecs for writev() or io_uring.
+    std::vector<iovec> iovecs() const {
+        std::vector<iovec> out;
+        const size_t n = count();
+        out.reserve(n);
+        for( size_t i = 0; i < n; ++i ) {
+            const Segment& seg = at(i);
+            out.push_back({const_cast<unsigned char*>(seg.data), seg.size});
+        }
+        return out;
+    }
+
+    //! Fills up to `max` iovecs, returns how many.
+    size_t iovecs(iovec* out, size_t max) const {
+        const size_t n = std::min(count(), max);
+        for( size_t i = 0; i < n; ++i ) {
+            const Segment& seg = at(i);
+            out[i] = {const_cast<unsigned char*>(seg.data), seg.size};
+        }
+        return n;
+    }
+
+    //! Copies up to `len` bytes from `offset` to `dst`, returns the number copied.
+    size_t copy_to(void* dst, size_t offset = 0, size_t len = SIZE_MAX) const {
+        auto* out = static_cast<unsigned char*>(dst);
+        size_t copied{0};
+        const size_t n = count();
+        for( size_t i = 0; i < n && len > 0; ++i ) {
+            const Segment& seg = at(i);
+            if( offset >= seg.size ) {
+                offset -= seg.size;
+                continue;
+            }
+            const size_t take = std::min(seg.size - offset, len);
+            std::memcpy(out + copied, seg.data + offset, take);
+            copied += take;
+            len -= take;
+            offset = 0;
+        }
+        return copied;
+    }
+
+    //! The bytes as one string, a copy.
+    std::string to_string() const {
+        std::string s(size_, '\0');
+        copy_to(s.data());
+        return s;
+    }
+
+    //! A single-slice buffer; shares the block if already contiguous.
+    Buffer flatten() const {
+        if( count() <= 1 ) {
+            return *this;
+        }
+        unsigned char* p;
+        Buffer out = allocate(size_, &p);
+        copy_to(p);
+        return out;
+    }
+
+    friend bool operator==(const Buffer& a, const Buffer& b) {
+        if( a.size_ != b.size_ ) {
+            return false;
+        }
+        size_t ia{0}, ib{0}, oa{0}, ob{0};
+        const size_t na = a.count(), nb = b.count();
+        while( ia < na && ib < nb ) {
+            const Segment& sa = a.at(ia);
+            const Segment& sb = b.at(ib);
+            const size_t take = std::min(sa.size - oa, sb.size - ob);
+            if( std::memcmp(sa.data + oa, sb.data + ob, take) != 0 ) {
+                return false;
+            }
+            oa += take;
+            ob += take;
+            if( oa == sa.size ) { ++ia; oa = 0; }
+            if( ob == sb.size ) { ++ib; ob = 0; }
+        }
+        return true;
+    }
+
+    friend bool operator!=(const Buffer& a, const Buffer& b) { return !(a == b); }
+};
+
+
+} // ::tec
@@ -0,0 +1,732 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_coro.hpp
+ *   @brief C++20 coroutines running on a Worker thread.
+ *
+ *  A CoWorker turns every message into a Task that runs on the worker
+ *  thread and may suspend without blocking it:
+ *
+ *  - `co_await task()` runs another Task and returns its value;
+ *  - `co_await tec::sleep_for(100ms)` resumes after a timer;
+ *  - `co_await tec::wait(signal)` resumes once an AsyncSignal is set,
+ *    `tec::wait_for(signal, timeout)` gives up after `timeout`;
+ *  - `co_await completion` resumes once another thread (a worker
+ *    replying, an RPC callback) calls Completion::complete().
+ *
+ *  Coroutines always resume on their worker thread. Frames come from
+ *  a per-worker pool.
+ *
+ *  @code
+ *  class Client: public tec::CoWorker<Params, Msg> {
+ *      tec::Task<> handle(Msg msg) override {
+ *          tec::Completion<int> reply;
+ *          server.send({CMD_GET, reply});
+ *          if( auto value = co_await reply.wait_for(1s) ) { ... }
+ *      }
+ *  };
+ *  @endcode
+ *
+ *  Requires C++20.
+ *
+*/
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || __cplusplus < 202002L
+#error "tec_coro.hpp requires C++20 coroutines, compile with -std=c++20"
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_semaphore.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+template <typename T = void>
+class Task;
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                      Coroutine context
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+/**
+ * @class      FramePool
+ * @brief      Free lists of coroutine frames in 64-byte size classes.
+ *
+ * @details    Used by one worker thread only. Frames over 2 KiB go
+ * to the heap. Freed frames are kept for reuse until the pool dies.
+ */
+class FramePool {
+    static constexpr size_t kGranule{64};
+    static constexpr size_t kClasses{32};
+
+    struct Block {
+        Block* next;
+    };
+
+    std::array<Block*, kClasses> free_{};
+
+    static size_t class_of(size_t size) { return (size + kGranule - 1) / kGranule - 1; }
+
+public:
+    FramePool() = default;
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    ~FramePool() {
+        for( Block* block: free_ ) {
+            while( block ) {
+                Block* next = block->next;
+                ::operator delete(block);
+                block = next;
+            }
+        }
+    }
+
+    void* allocate(size_t size) {
+        const size_t cls = class_of(size);
+        if( cls >= kClasses ) {
+            return ::operator new(size);
+        }
+        if( Block* block = free_[cls] ) {
+            free_[cls] = block->next;
+            return block;
+        }
+        return ::operator new((cls + 1) * kGranule);
+    }
+
+    void deallocate(void* ptr, size_t size) {
+        const size_t cls = class_of(size);
+        if( cls >= kClasses ) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto* block = static_cast<Block*>(ptr);
+        block->next = free_[cls];
+        free_[cls] = block;
+    }
+};
+
+
+/**
+ * @class      CoScheduler
+ * @brief      Resumes coroutines woken by other threads on the worker thread.
+ *
+ * @details    post() queues a handle and wakes the worker with one
+ * message per batch. Shared with awaiters by weak_ptr: once the worker
+ * has closed it, late wake-ups are dropped.
+ */
+class CoScheduler {
+    std::mutex mtx_;
+    std::vector<std::coroutine_handle<>> ready_;
+    bool wake_pending_{false};
+    bool open_{true};
+    std::function<void()> wake_;
+
+public:
+    explicit CoScheduler(std::function<void()> wake)
+        : wake_{std::move(wake)}
+    {}
+
+    //! Any thread.
+    void post(std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if( !open_ ) {
+            return;
+        }
+        ready_.push_back(h);
+        if( !wake_pending_ ) {
+            wake_pending_ = true;
+            wake_();
+        }
+    }
+
+    //! Worker thread: handles to resume.
+    std::vector<std::coroutine_handle<>> take() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        wake_pending_ = false;
+        return std::exchange(ready_, {});
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        open_ = false;
+        ready_.clear();
+    }
+};
+
+
+//! What awaiters need from the CoWorker running the coroutine.
+class CoContext {
+public:
+    using Timer = std::pair<std::chrono::steady_clock::time_point, uint64_t>;
+
+    virtual ~CoContext() = default;
+
+    virtual FramePool& frame_pool() = 0;
+    virtual const std::shared_ptr<CoScheduler>& scheduler() = 0;
+    virtual Timer arm_timer(std::chrono::nanoseconds delay, std::function<void()> fn) = 0;
+    virtual void disarm_timer(const Timer& timer) = 0;
+    //! A detached task has finished.
+    virtual void task_done(std::coroutine_handle<> h) = 0;
+};
+
+//! The CoWorker of the calling thread, if any.
+inline thread_local CoContext* co_context{nullptr};
+
+inline CoContext& current_context() {
+    if( !co_context ) {
+        // Awaited outside of a CoWorker thread.
+        std::terminate();
+    }
+    return *co_context;
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Task promise
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct PromiseBase {
+    //! Frames start with a pointer to their pool, nullptr for the heap.
+    static constexpr size_t kFrameHeader{alignof(std::max_align_t)};
+
+    //! The awaiting coroutine.
+    std::coroutine_handle<> continuation{};
+    //! Set for detached tasks, see CoWorker::spawn().
+    CoContext* owner{nullptr};
+
+    static void* operator new(size_t size) {
+        FramePool* pool = co_context ? &co_context->frame_pool() : nullptr;
+        void* raw = pool ? pool->allocate(size + kFrameHeader) : ::operator new(size + kFrameHeader);
+        *static_cast<FramePool**>(raw) = pool;
+        return static_cast<std::byte*>(raw) + kFrameHeader;
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        void* raw = static_cast<std::byte*>(ptr) - kFrameHeader;
+        if( FramePool* pool = *static_cast<FramePool**>(raw) ) {
+            pool->deallocate(raw, size + kFrameHeader);
+        }
+        else {
+            ::operator delete(raw);
+        }
+    }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename TPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> h) noexcept {
+            PromiseBase& promise = h.promise();
+            if( promise.continuation ) {
+                return promise.continuation;
+            }
+            if( promise.owner ) {
+                // Destroys the frame.
+                promise.owner->task_done(h);
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    //! The library does not use exceptions.
+    void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+
+template <typename T>
+struct Promise: PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+};
+
+
+template <>
+struct Promise<void>: PromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                              Task
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      Task
+ * @brief      A lazily started coroutine returning T.
+ *
+ * @details    Starts when awaited (`co_await task()`) or spawned on a
+ * CoWorker. Move-only; destroying an unstarted or suspended Task
+ * destroys its frame.
+ */
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = details::Promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept
+        : h_{std::exchange(other.h_, {})}
+    {}
+
+    Task& operator=(Task&& other) noexcept {
+        if( this != &other ) {
+            reset();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+
+    ~Task() { reset(); }
+
+    //! Runs the task, resuming the caller when it is done.
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type h;
+
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                h.promise().continuation = caller;
+                return h;
+            }
+
+            T await_resume() {
+                if constexpr ( !std::is_void_v<T> ) {
+                    return std::move(*h.promise().value);
+                }
+            }
+        };
+        return Awaiter{h_};
+    }
+
+    //! Takes the coroutine out, see CoWorker::spawn().
+    handle_type release() noexcept { return std::exchange(h_, {}); }
+
+private:
+    friend struct details::Promise<T>;
+
+    explicit Task(handle_type h) noexcept
+        : h_{h}
+    {}
+
+    void reset() {
+        if( h_ ) {
+            h_.destroy();
+            h_ = {};
+        }
+    }
+
+    handle_type h_;
+};
+
+
+namespace details {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+}
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Awaitables
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+//! The first of {event, timeout} resumes the coroutine.
+struct Race {
+    std::atomic<bool> fired{false};
+    bool timed_out{false};
+    bool timed{false};
+    std::coroutine_handle<> h;
+    std::weak_ptr<CoScheduler> scheduler;
+    CoContext::Timer timer;
+
+    //! Any thread.
+    void fire() {
+        if( !fired.exchange(true) ) {
+            if( auto sched = scheduler.lock() ) {
+                sched->post(h);
+            }
+        }
+    }
+
+    //! Worker thread, from the timer.
+    void expire() {
+        if( !fired.exchange(true) ) {
+            timed_out = true;
+            h.resume();
+        }
+    }
+
+    //! Worker thread, on resumption.
+    void arm(std::coroutine_handle<> handle, std::optional<std::chrono::nanoseconds> timeout,
+             const std::shared_ptr<Race>& self) {
+        CoContext& ctx = current_context();
+        h = handle;
+        scheduler = ctx.scheduler();
+        if( timeout ) {
+            timed = true;
+            timer = ctx.arm_timer(*timeout, [self] { self->expire(); });
+        }
+    }
+
+    //! Worker thread: true if the event won.
+    bool settle() {
+        if( timed && !timed_out ) {
+            current_context().disarm_timer(timer);
+        }
+        return !timed_out;
+    }
+};
+
+
+struct SleepAwaiter {
+    std::chrono::nanoseconds delay;
+
+    bool await_ready() const noexcept { return delay.count() <= 0; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        current_context().arm_timer(delay, [h] { h.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+};
+
+
+template <typename TSemaphore>
+class SemaphoreAwaiter {
+    const TSemaphore& sem_;
+    std::optional<std::chrono::nanoseconds> timeout_;
+    std::shared_ptr<Race> race_;
+    typename TSemaphore::Token token_{0};
+
+public:
+    SemaphoreAwaiter(const TSemaphore& sem, std::optional<std::chrono::nanoseconds> timeout)
+        : sem_{sem}
+        , timeout_{timeout}
+    {}
+
+    bool await_ready() const { return sem_.wait_for(std::chrono::nanoseconds{0}); }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        race_ = std::make_shared<Race>();
+        race_->arm(h, timeout_, race_);
+        token_ = sem_.notify_when([race = race_] { race->fire(); });
+    }
+
+    //! false on timeout.
+    bool await_resume() {
+        if( !race_ || race_->settle() ) {
+            return true;
+        }
+        // Timed out: the callback would keep the Race alive till the next set.
+        sem_.cancel(token_);
+        return false;
+    }
+};
+
+} // ::details
+
+
+//! `co_await tec::sleep_for(delay)`: resumes after `delay`.
+template <typename Rep, typename Period>
+details::SleepAwaiter sleep_for(std::chrono::duration<Rep, Period> delay) {
+    return {std::chrono::duration_cast<std::chrono::nanoseconds>(delay)};
+}
+
+
+//! `co_await tec::wait(signal)`: resumes once the signal is set.
+template <typename Value, typename TPredicate>
+auto wait(const AsyncSemaphore<Value, TPredicate>& sem) {
+    return details::SemaphoreAwaiter<AsyncSemaphore<Value, TPredicate>>{sem, std::nullopt};
+}
+
+
+//! `co_await tec::wait_for(signal, timeout)`: false on timeout.
+template <typename Value, typename TPredicate, typename Rep, typename Period>
+auto wait_for(const AsyncSemaphore<Value, TPredicate>& sem, std::chrono::duration<Rep, Period> timeout) {
+    return details::SemaphoreAwaiter<AsyncSemaphore<Value, TPredicate>>{
+        sem, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout)};
+}
+
+
+/**
+ * @class      Completion
+ * @brief      A value delivered once by any thread to one awaiting coroutine.
+ *
+ * @details    Copies share the same state, so a Completion can travel
+ * inside a message to the worker that replies, or be captured by an
+ * RPC callback. Use `co_await completion` to get the value, or
+ * `co_await completion.wait_for(timeout)` to get std::nullopt on
+ * timeout.
+ */
+template <typename T = Result>
+class Completion {
+    struct State {
+        std::mutex mtx;
+        std::optional<T> value;
+        std::shared_ptr<details::Race> race;
+    };
+
+    std::shared_ptr<State> state_;
+
+    template <bool kTimed>
+    class Awaiter {
+        std::shared_ptr<State> state_;
+        std::optional<std::chrono::nanoseconds> timeout_;
+        std::shared_ptr<details::Race> race_;
+
+    public:
+        Awaiter(std::shared_ptr<State> state, std::optional<std::chrono::nanoseconds> timeout)
+            : state_{std::move(state)}
+            , timeout_{timeout}
+        {}
+
+        bool await_ready() const {
+            std::lock_guard<std::mutex> lk(state_->mtx);
+            return state_->value.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            race_ = std::make_shared<details::Race>();
+            race_->arm(h, timeout_, race_);
+            std::lock_guard<std::mutex> lk(state_->mtx);
+            if( state_->value ) {
+                // Completed meanwhile: don't suspend.
+                race_->fired = true;
+                return false;
+            }
+            state_->race = race_;
+            return true;
+        }
+
+        auto await_resume() {
+            const bool completed = race_ ? race_->settle() : true;
+            if constexpr ( kTimed ) {
+                std::optional<T> result;
+                std::lock_guard<std::mutex> lk(state_->mtx);
+                if( completed ) {
+                    result = std::move(state_->value);
+                }
+                else if( state_->race == race_ ) {
+                    state_->race.reset();
+                }
+                return result;
+            }
+            else {
+                std::lock_guard<std::mutex> lk(state_->mtx);
+                return std::move(*state_->value);
+            }
+        }
+    };
+
+public:
+    Completion()
+        : state_{std::make_shared<State>()}
+    {}
+
+    //! Any thread. Only the first call delivers, later ones return false.
+    bool complete(T value) const {
+        std::shared_ptr<details::Race> race;
+        {
+            std::lock_guard<std::mutex> lk(state_->mtx);
+            if( state_->value ) {
+                return false;
+            }
+            state_->value.emplace(std::move(value));
+            race = std::move(state_->race);
+        }
+        if( race ) {
+            race->fire();
+        }
+        return true;
+    }
+
+    bool ready() const {
+        std::lock_guard<std::mutex> lk(state_->mtx);
+        return state_->value.has_value();
+    }
+
+    Awaiter<false> operator co_await() const { return {state_, std::nullopt}; }
+
+    template <typename Rep, typename Period>
+    Awaiter<true> wait_for(std::chrono::duration<Rep, Period> timeout) const {
+        return {state_, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout)};
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           CoWorker
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      CoWorker
+ * @brief      A Worker whose messages are handled by coroutines.
+ *
+ * @details    Override handle() instead of process(). Each message
+ * starts a Task on the worker thread; while it is suspended the
+ * worker goes on with the next message. Tasks still suspended when
+ * the worker is destroyed are destroyed without being resumed.
+ */
+template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec,
+          typename TStats = NoStats>
+class CoWorker: public Worker<TWorkerParams, TMessage, Duration, TStats>, private details::CoContext {
+    using Base = Worker<TWorkerParams, TMessage, Duration, TStats>;
+
+    details::FramePool pool_;
+    std::shared_ptr<details::CoScheduler> sched_;
+    //! Detached tasks not finished yet.
+    std::unordered_set<void*> roots_;
+
+public:
+    //! Reserved command: resume coroutines woken by other threads.
+    static constexpr Message::cmd_t CMD_RESUME{std::numeric_limits<Message::cmd_t>::max()};
+
+    explicit CoWorker(const TWorkerParams& params, Launch launch = Launch::Eager)
+        : Base(params, launch)
+        , sched_{std::make_shared<details::CoScheduler>([this] {
+                TMessage msg;
+                msg.command = CMD_RESUME;
+                this->send(msg);
+            })}
+    {}
+
+    ~CoWorker() override {
+        // Stop the thread while process() is still ours.
+        this->terminate();
+        sched_->close();
+        for( void* addr: roots_ ) {
+            std::coroutine_handle<>::from_address(addr).destroy();
+        }
+        roots_.clear();
+    }
+
+protected:
+    /**
+     *  @brief Handles a message on the worker thread.
+     *
+     *  The message is taken by value: it lives in the coroutine frame.
+     */
+    virtual Task<> handle(TMessage) { co_return; }
+
+    //! Starts a detached task. Worker thread only.
+    void spawn(Task<> task) {
+        auto h = task.release();
+        if( !h ) {
+            return;
+        }
+        h.promise().owner = this;
+        roots_.insert(h.address());
+        h.resume();
+    }
+
+    void process(const TMessage& msg) final {
+        details::co_context = this;
+        if( msg.command == CMD_RESUME ) {
+            for( auto h: sched_->take() ) {
+                h.resume();
+            }
+            return;
+        }
+        spawn(handle(msg));
+    }
+
+private:
+    details::FramePool& frame_pool() override { return pool_; }
+
+    const std::shared_ptr<details::CoScheduler>& scheduler() override { return sched_; }
+
+    Timer arm_timer(std::chrono::nanoseconds delay, std::function<void()> fn) override {
+        return Base::start_timer(delay, [this, fn = std::move(fn)] {
+            details::co_context = this;
+            fn();
+        });
+    }
+
+    void disarm_timer(const Timer& timer) override { Base::cancel_timer(timer); }
+
+    void task_done(std::coroutine_handle<> h) override {
+        roots_.erase(h.address());
+        h.destroy();
+    }
+};
+
+
+} // ::tec
@@ -0,0 +1,403 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_eventbus.hpp
+ *   @brief Topic-based publish/subscribe between threads.
+ *
+ *  An EventBus stores a published event once, as a
+ *  `std::shared_ptr<const TEvent>`, and delivers that pointer to
+ *  every mailbox subscribed to the topic:
+ *
+ *  - QueueMailbox: unbounded, nothing is lost;
+ *  - RingMailbox: bounded and lossy; when full, the oldest event is
+ *    dropped, so a slow subscriber never blocks the publisher;
+ *  - a Worker: each event is turned into a message and send().
+ *
+ *  @code
+ *  tec::EventBus<Quote> bus;
+ *  auto ring = std::make_shared<tec::RingMailbox<Quote>>(1024, "ui");
+ *  bus.subscribe("EURUSD", ring);
+ *  bus.subscribe("EURUSD", worker, [](const auto& quote) { return Msg{CMD_QUOTE, quote}; });
+ *  bus.publish("EURUSD", Quote{...});
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Mailboxes
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+template <typename TEvent>
+class Mailbox {
+public:
+    //! Events are shared by all subscribers and never modified.
+    using Event = std::shared_ptr<const TEvent>;
+
+    Mailbox() = default;
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+    virtual ~Mailbox() = default;
+
+    //! Called on the publisher thread, must not block for long.
+    //! Returns false if an event has been lost.
+    virtual bool deliver(const Event& event) = 0;
+};
+
+
+//! Unbounded mailbox, a subscriber thread reads it with pop().
+template <typename TEvent>
+class QueueMailbox: public Mailbox<TEvent> {
+public:
+    using Event = typename Mailbox<TEvent>::Event;
+
+private:
+    std::deque<Event> q_;
+    mutable std::mutex m_;
+    std::condition_variable c_;
+
+public:
+    bool deliver(const Event& event) override {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            q_.push_back(event);
+        }
+        c_.notify_one();
+        return true;
+    }
+
+    //! Waits for an event.
+    Event pop() {
+        std::unique_lock<std::mutex> lk(m_);
+        c_.wait(lk, [this]{ return !q_.empty(); });
+        Event event = std::move(q_.front());
+        q_.pop_front();
+        return event;
+    }
+
+    //! Returns false if empty.
+    bool try_pop(Event& event) {
+        std::lock_guard<std::mutex> lk(m_);
+        if( q_.empty() ) {
+            return false;
+        }
+        event = std::move(q_.front());
+        q_.pop_front();
+        return true;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return q_.size();
+    }
+};
+
+
+/**
+ * @class      RingMailbox
+ * @brief      Bounded lossy mailbox: when full, the oldest event is dropped.
+ *
+ * @details    deliver() never waits for the subscriber. Lost events
+ * are counted by dropped() and `tec_mailbox_dropped_total{mailbox=name}`.
+ */
+template <typename TEvent>
+class RingMailbox: public Mailbox<TEvent> {
+public:
+    using Event = typename Mailbox<TEvent>::Event;
+
+private:
+    std::vector<Event> ring_;
+    size_t head_;
+    size_t size_;
+    uint64_t dropped_;
+    mutable std::mutex m_;
+    std::condition_variable c_;
+
+    std::shared_ptr<metrics::Counter> m_dropped_;
+
+    Event take() {
+        Event event = std::move(ring_[head_]);
+        head_ = (head_ + 1) % ring_.size();
+        --size_;
+        return event;
+    }
+
+public:
+    //! A capacity of 0 is taken as 1.
+    explicit RingMailbox(size_t capacity, const std::string& name = "ring")
+        : ring_(capacity > 0 ? capacity : 1)
+        , head_{0}
+        , size_{0}
+        , dropped_{0}
+        , m_dropped_{metrics::registry().instance<metrics::Counter>(
+                "tec_mailbox_dropped_total", "Events dropped by a lossy mailbox.",
+                metrics::label("mailbox", name))}
+    {}
+
+    bool deliver(const Event& event) override {
+        Event oldest;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if( size_ == ring_.size() ) {
+                // Overwrite the oldest, released outside of the lock.
+                oldest = std::move(ring_[head_]);
+                ring_[head_] = event;
+                head_ = (head_ + 1) % ring_.size();
+                ++dropped_;
+            }
+            else {
+                ring_[(head_ + size_) % ring_.size()] = event;
+                ++size_;
+            }
+        }
+        c_.notify_one();
+        if( oldest ) {
+            m_dropped_->inc();
+            return false;
+        }
+        return true;
+    }
+
+    //! Waits for an event.
+    Event pop() {
+        std::unique_lock<std::mutex> lk(m_);
+        c_.wait(lk, [this]{ return size_ > 0; });
+        return take();
+    }
+
+    //! Returns false if empty.
+    bool try_pop(Event& event) {
+        std::lock_guard<std::mutex> lk(m_);
+        if( size_ == 0 ) {
+            return false;
+        }
+        event = take();
+        return true;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return size_;
+    }
+
+    size_t capacity() const { return ring_.size(); }
+
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return dropped_;
+    }
+};
+
+
+//! Delivers events to a Worker as messages made by `make(event)`.
+//! The worker must outlive the subscription.
+template <typename TEvent, typename TWorker, typename TMake>
+class WorkerMailbox: public Mailbox<TEvent> {
+public:
+    using Event = typename Mailbox<TEvent>::Event;
+
+private:
+    TWorker& worker_;
+    TMake make_;
+
+public:
+    WorkerMailbox(TWorker& worker, TMake make)
+        : worker_{worker}
+        , make_{std::move(make)}
+    {}
+
+    bool deliver(const Event& event) override {
+        return worker_.send(make_(event));
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Event bus
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      EventBus
+ * @brief      Delivers each published event to the subscribers of its topic.
+ *
+ * @details    The subscriber table is copy-on-write: publish() takes
+ * a snapshot with std::atomic_load() and never waits for a table to
+ * be rebuilt by subscribe() or unsubscribe(). The load is not lock-free:
+ * libstdc++ guards it with a spinlock from a small shared pool, held
+ * only to copy the pointer and bump its reference count. A mailbox
+ * subscribed to kAllTopics receives every event once, also when the
+ * event is published to kAllTopics.
+ *
+ * Exports `tec_eventbus_published_total`, `tec_eventbus_delivered_total`
+ * and `tec_eventbus_lost_total`, labelled `bus`.
+ */
+template <typename TEvent>
+class EventBus {
+public:
+    using Event = std::shared_ptr<const TEvent>;
+    using MailboxPtr = std::shared_ptr<Mailbox<TEvent>>;
+    using SubscriptionId = uint64_t;
+
+    //! Subscribe to this topic to receive all events.
+    static constexpr const char* kAllTopics{"*"};
+
+private:
+    struct Subscriber {
+        SubscriptionId id;
+        MailboxPtr mailbox;
+    };
+
+    using Table = std::unordered_map<std::string, std::vector<Subscriber>>;
+
+    std::shared_ptr<const Table> table_;
+    //! Serializes writers of `table_`.
+    std::mutex mtx_;
+    SubscriptionId next_id_;
+
+    std::shared_ptr<metrics::Counter> m_published_;
+    std::shared_ptr<metrics::Counter> m_delivered_;
+    std::shared_ptr<metrics::Counter> m_lost_;
+
+    size_t deliver(const std::vector<Subscriber>& subscribers, const Event& event) {
+        size_t lost{0};
+        for( const auto& s: subscribers ) {
+            if( !s.mailbox->deliver(event) ) {
+                ++lost;
+            }
+        }
+        m_delivered_->inc(subscribers.size() - lost);
+        if( lost ) {
+            m_lost_->inc(lost);
+        }
+        return subscribers.size() - lost;
+    }
+
+public:
+    explicit EventBus(const std::string& name = "eventbus")
+        : table_{std::make_shared<const Table>()}
+        , next_id_{0}
+        , m_published_{metrics::registry().instance<metrics::Counter>(
+                "tec_eventbus_published_total", "Events published.", metrics::label("bus", name))}
+        , m_delivered_{metrics::registry().instance<metrics::Counter>(
+                "tec_eventbus_delivered_total", "Events delivered to mailboxes.", metrics::label("bus", name))}
+        , m_lost_{metrics::registry().instance<metrics::Counter>(
+                "tec_eventbus_lost_total", "Deliveries that lost an event.", metrics::label("bus", name))}
+    {}
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    SubscriptionId subscribe(const std::string& topic, MailboxPtr mailbox) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto table = std::make_shared<Table>(*std::atomic_load(&table_));
+        const SubscriptionId id = ++next_id_;
+        (*table)[topic].push_back({id, std::move(mailbox)});
+        std::atomic_store(&table_, std::shared_ptr<const Table>(std::move(table)));
+        return id;
+    }
+
+    //! Subscribes a worker: every event is sent as `make(event)`.
+    template <typename TWorker, typename TMake>
+    SubscriptionId subscribe(const std::string& topic, TWorker& worker, TMake make) {
+        return subscribe(topic, std::make_shared<WorkerMailbox<TEvent, TWorker, TMake>>(
+                             worker, std::move(make)));
+    }
+
+    //! Returns false if there is no such subscription.
+    bool unsubscribe(SubscriptionId id) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto table = std::make_shared<Table>(*std::atomic_load(&table_));
+        for( auto it = table->begin(); it != table->end(); ++it ) {
+            auto& subs = it->second;
+            for( auto sub = subs.begin(); sub != subs.end(); ++sub ) {
+                if( sub->id == id ) {
+                    subs.erase(sub);
+                    if( subs.empty() ) {
+                        table->erase(it);
+                    }
+                    std::atomic_store(&table_, std::shared_ptr<const Table>(std::move(table)));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    //! Delivers to the subscribers of `topic`.
+    //! Returns the number of mailboxes that took it without loss.
+    size_t publish(const std::string& topic, const Event& event) {
+        const auto table = std::atomic_load(&table_);
+        m_published_->inc();
+        size_t delivered{0};
+        if( auto it = table->find(topic); it != table->end() ) {
+            delivered += deliver(it->second, event);
+        }
+        if( topic == kAllTopics ) {
+            return delivered;
+        }
+        if( auto it = table->find(kAllTopics); it != table->end() ) {
+            delivered += deliver(it->second, event);
+        }
+        return delivered;
+    }
+
+    //! Stores `event` once and delivers it.
+    size_t publish(const std::string& topic, TEvent event) {
+        return publish(topic, std::make_shared<const TEvent>(std::move(event)));
+    }
+
+    //! Mailboxes subscribed to exactly `topic`.
+    size_t subscribers(const std::string& topic) const {
+        const auto table = std::atomic_load(&table_);
+        auto it = table->find(topic);
+        return it == table->end() ? 0 : it->second.size();
+    }
+};
+
+
+} // ::tec
@@ -0,0 +1,237 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_expected.hpp
+ *   @brief A value or a Result.
+ *
+ *  Expected<T> holds either a value of type `T` or an error tec::Result,
+ *  so a function can return its data by move (RVO) instead of filling
+ *  an out-parameter:
+ *
+ *  @code
+ *  tec::Expected<Channel> open(const std::string& uri);
+ *
+ *  auto stub = open(uri)
+ *      .and_then([](Channel ch) { return handshake(std::move(ch)); })
+ *      .transform([](Channel ch) { return Stub{std::move(ch)}; });
+ *  if( !stub ) {
+ *      return stub.error();
+ *  }
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Expected<T>
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+template <typename T, typename TResult = Result>
+class Expected;
+
+
+namespace details {
+
+template <typename>
+struct is_expected: std::false_type {};
+
+template <typename T, typename TResult>
+struct is_expected<Expected<T, TResult>>: std::true_type {};
+
+} // ::details
+
+
+/**
+ * @class      Expected
+ * @brief      Holds either a value or an error Result.
+ *
+ * @details    No heap allocation besides what `T` and the Result
+ * description may need. Constructing from an OK Result is a logic error
+ * and yields Result::Kind::Invalid.
+ */
+template <typename T, typename TResult>
+class Expected {
+    static_assert(!std::is_same_v<std::decay_t<T>, TResult>, "Expected<Result> makes no sense, use Result");
+    static_assert(!std::is_reference_v<T>, "Expected<T&> is not supported");
+
+    std::variant<T, TResult> v_;
+
+    static TResult check_error(TResult&& err) {
+        if( err.ok() ) {
+            return {"Expected: no value and no error", TResult::Kind::Invalid};
+        }
+        return std::move(err);
+    }
+
+public:
+    using value_type = T;
+    using error_type = TResult;
+
+    //! Constructs a value from anything `T` is constructible from.
+    template <typename U = T,
+              typename = std::enable_if_t<
+                  std::is_constructible_v<T, U&&>
+                  && !std::is_same_v<std::decay_t<U>, TResult>
+                  && !std::is_same_v<std::decay_t<U>, Expected>
+                  && !std::is_same_v<std::decay_t<U>, std::in_place_t>>>
+    Expected(U&& value)
+        : v_{std::in_place_index<0>, std::forward<U>(value)}
+    {}
+
+    //! Constructs a value in place.
+    template <typename... Args>
+    explicit Expected(std::in_place_t, Args&&... args)
+        : v_{std::in_place_index<0>, std::forward<Args>(args)...}
+    {}
+
+    //! Constructs an error.
+    Expected(const TResult& err)
+        : v_{std::in_place_index<1>, check_error(TResult{err})}
+    {}
+
+    //! Constructs an error.
+    Expected(TResult&& err)
+        : v_{std::in_place_index<1>, check_error(std::move(err))}
+    {}
+
+    //! Does it hold a value?
+    bool has_value() const { return v_.index() == 0; }
+    //! Operator: Does it hold a value?
+    explicit operator bool() const { return has_value(); }
+
+    //@{ Value access, undefined if there is no value.
+    T& value() & { return *std::get_if<0>(&v_); }
+    const T& value() const& { return *std::get_if<0>(&v_); }
+    T&& value() && { return std::move(*std::get_if<0>(&v_)); }
+
+    T& operator * () & { return value(); }
+    const T& operator * () const& { return value(); }
+    T&& operator * () && { return std::move(*this).value(); }
+
+    T* operator -> () { return std::get_if<0>(&v_); }
+    const T* operator -> () const { return std::get_if<0>(&v_); }
+    //@}
+
+    //! Returns the value or `def` if there is an error.
+    template <typename U>
+    T value_or(U&& def) const& {
+        return has_value() ? value() : static_cast<T>(std::forward<U>(def));
+    }
+
+    template <typename U>
+    T value_or(U&& def) && {
+        return has_value() ? std::move(*this).value() : static_cast<T>(std::forward<U>(def));
+    }
+
+    //! The error, valid only if there is no value.
+    const TResult& error() const& { return *std::get_if<1>(&v_); }
+    TResult&& error() && { return std::move(*std::get_if<1>(&v_)); }
+
+    //! The error or an OK Result if there is a value.
+    TResult result() const {
+        return has_value() ? TResult{} : error();
+    }
+
+    /**
+     * @brief      Chains an operation that may fail.
+     *
+     * @param      f Callable `T -> Expected<U>`, called only if there is a value.
+     * @return     Expected<U> The result of `f` or the error propagated.
+     */
+    template <typename F>
+    auto and_then(F&& f) & { return and_then_impl(*this, std::forward<F>(f)); }
+    template <typename F>
+    auto and_then(F&& f) const& { return and_then_impl(*this, std::forward<F>(f)); }
+    template <typename F>
+    auto and_then(F&& f) && { return and_then_impl(std::move(*this), std::forward<F>(f)); }
+
+    /**
+     * @brief      Transforms the value.
+     *
+     * @param      f Callable `T -> U`, called only if there is a value.
+     * @return     Expected<U> The transformed value or the error propagated.
+     */
+    template <typename F>
+    auto transform(F&& f) & { return transform_impl(*this, std::forward<F>(f)); }
+    template <typename F>
+    auto transform(F&& f) const& { return transform_impl(*this, std::forward<F>(f)); }
+    template <typename F>
+    auto transform(F&& f) && { return transform_impl(std::move(*this), std::forward<F>(f)); }
+
+    /**
+     * @brief      Recovers from an error.
+     *
+     * @param      f Callable `Result -> Expected<T>`, called only if there is an error.
+     * @return     Expected<T> This or the result of `f`.
+     */
+    template <typename F>
+    Expected or_else(F&& f) const& {
+        if( has_value() ) return *this;
+        return std::forward<F>(f)(error());
+    }
+
+    template <typename F>
+    Expected or_else(F&& f) && {
+        if( has_value() ) return std::move(*this);
+        return std::forward<F>(f)(std::move(*this).error());
+    }
+
+private:
+    template <typename Self, typename F>
+    static auto and_then_impl(Self&& self, F&& f) {
+        using R = std::decay_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).value())>>;
+        static_assert(details::is_expected<R>::value, "and_then() requires a callable returning Expected<U>");
+        if( self.has_value() ) {
+            return std::forward<F>(f)(std::forward<Self>(self).value());
+        }
+        return R{std::forward<Self>(self).error()};
+    }
+
+    template <typename Self, typename F>
+    static auto transform_impl(Self&& self, F&& f) {
+        using U = std::decay_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).value())>>;
+        using R = Expected<U, TResult>;
+        if( self.has_value() ) {
+            return R{std::in_place, std::forward<F>(f)(std::forward<Self>(self).value())};
+        }
+        return R{std::forward<Self>(self).error()};
+    }
+};
+
+
+} // ::tec
@@ -0,0 +1,246 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_histogram.hpp
+ *   @brief HDR-style latency histogram.
+ *
+ *  Log-linear buckets: every power of two is split into 32 linear
+ *  sub-buckets, so a recorded value is off by less than 3.2%.
+ *  Values are unsigned 64-bit integers, usually nanoseconds;
+ *  anything above 2^40 (~18 minutes in ns) goes to the last bucket.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+
+#if defined(__TEC_WINDOWS__)
+#include <intrin.h>
+#endif
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                       Bucket arithmetic
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+struct log_linear {
+    //! Sub-bucket bits: 2^5 linear sub-buckets per power of two.
+    static constexpr const unsigned kSubBits{5};
+    static constexpr const uint64_t kSubCount{uint64_t{1} << kSubBits};
+    //! Values above 2^kMaxBits are clamped.
+    static constexpr const unsigned kMaxBits{40};
+    static constexpr const uint64_t kMaxValue{(uint64_t{1} << kMaxBits) - 1};
+    //! Total number of buckets.
+    static constexpr const size_t kBuckets{(kMaxBits - kSubBits + 1) * kSubCount};
+
+    static unsigned msb(uint64_t v) {
+#if defined(__TEC_WINDOWS__)
+        unsigned long idx;
+        _BitScanReverse64(&idx, v);
+        return static_cast<unsigned>(idx);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+    }
+
+    //! Bucket index of value `v`.
+    static size_t index(uint64_t v) {
+        if( v < kSubCount ) {
+            return static_cast<size_t>(v);
+        }
+        v = std::min(v, kMaxValue);
+        const unsigned m = msb(v);
+        const unsigned shift = m - kSubBits;
+        return static_cast<size_t>(((shift + 1) << kSubBits) + ((v >> shift) - kSubCount));
+    }
+
+    //! The lowest value of bucket `idx`.
+    static uint64_t lower(size_t idx) {
+        if( idx < kSubCount ) {
+            return idx;
+        }
+        const uint64_t shift = (idx >> kSubBits) - 1;
+        return (kSubCount + (idx & (kSubCount - 1))) << shift;
+    }
+
+    //! The highest value of bucket `idx`.
+    static uint64_t upper(size_t idx) {
+        if( idx < kSubCount ) {
+            return idx;
+        }
+        const uint64_t shift = (idx >> kSubBits) - 1;
+        return lower(idx) + (uint64_t{1} << shift) - 1;
+    }
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Histogram
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Percentile summary of a Histogram.
+struct HistogramSummary {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+
+    friend std::ostream& operator << (std::ostream& out, const HistogramSummary& s) {
+        out << "count=" << s.count
+            << " min=" << s.min
+            << " p50=" << s.p50
+            << " p90=" << s.p90
+            << " p99=" << s.p99
+            << " p999=" << s.p999
+            << " max=" << s.max
+            << " mean=" << s.mean;
+        return out;
+    }
+};
+
+
+/**
+ * @class      Histogram
+ * @brief      Single-threaded log-linear histogram.
+ *
+ * @details    record() is a couple of arithmetic operations and
+ * an increment, no allocation. Use merge() to aggregate histograms
+ * collected by different threads.
+ */
+class Histogram {
+public:
+    using Buckets = std::array<uint64_t, details::log_linear::kBuckets>;
+
+private:
+    Buckets buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+
+public:
+    Histogram() {
+        reset();
+    }
+
+    //! Records a single value.
+    void record(uint64_t v) {
+        ++buckets_[details::log_linear::index(v)];
+        ++count_;
+        sum_ += v;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    //! Adds up another histogram.
+    void merge(const Histogram& other) {
+        for( size_t i = 0; i < buckets_.size(); ++i ) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    //! Adds up raw bucket counts, see metrics.
+    void merge(const Buckets& buckets, uint64_t sum, uint64_t min, uint64_t max) {
+        for( size_t i = 0; i < buckets_.size(); ++i ) {
+            buckets_[i] += buckets[i];
+            count_ += buckets[i];
+        }
+        sum_ += sum;
+        min_ = std::min(min_, min);
+        max_ = std::max(max_, max);
+    }
+
+    void reset() {
+        buckets_.fill(0);
+        count_ = 0;
+        sum_ = 0;
+        min_ = std::numeric_limits<uint64_t>::max();
+        max_ = 0;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+    const Buckets& buckets() const { return buckets_; }
+
+    /**
+     * @brief      Returns the value at quantile `q`.
+     *
+     * @param      q Quantile in [0, 1], e.g. 0.99 for p99.
+     * @return     uint64_t The upper bound of the bucket holding the quantile,
+     * clamped to [min, max].
+     */
+    uint64_t percentile(double q) const {
+        if( count_ == 0 ) {
+            return 0;
+        }
+        q = std::clamp(q, 0.0, 1.0);
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count_);
+        uint64_t seen = 0;
+        for( size_t i = 0; i < buckets_.size(); ++i ) {
+            seen += buckets_[i];
+            if( seen >= rank ) {
+                return std::clamp(details::log_linear::upper(i), min(), max_);
+            }
+        }
+        return max_;
+    }
+
+    HistogramSummary summary() const {
+        return {count_, min(), max_, mean(),
+                percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999)};
+    }
+};
+
+
+} // ::tec
@@ -0,0 +1,801 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_io.hpp
+ *   @brief Asynchronous file I/O worker on io_uring.
+ *
+ *  IoWorker takes read, write and fsync requests as messages, so a
+ *  Worker writing checkpoints or logs no longer blocks in `write()`.
+ *  Requests arriving together are submitted with one `io_uring_enter()`;
+ *  buffers and files listed in IoParams are registered with the ring.
+ *  Completions are delivered to a callback, or to a std::future.
+ *
+ *  When io_uring is not available (old kernel, seccomp), IoWorker falls
+ *  back to a pool of threads calling pread()/pwrite()/fsync().
+ *
+ *  @code
+ *  tec::IoWorker io(params);
+ *  io.run();
+ *  io.write(fd, data, size, offset, [&worker](const tec::IoCompletion& c) {
+ *      worker.send({CMD_WRITTEN});
+ *  });
+ *  auto synced = io.fsync(fd);
+ *  ...
+ *  synced.get();
+ *  @endcode
+ *
+ *  Linux only, uses raw system calls, no liburing.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_queue.hpp"
+#include "tec/tec_reactor.hpp"
+#include "tec/tec_thread.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Requests and results
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! I/O implementation used by IoWorker.
+enum class IoBackend {
+    Auto,     //!< io_uring if available, otherwise Threads.
+    Uring,    //!< io_uring, init() fails if not available.
+    Threads,  //!< A thread pool doing blocking calls.
+};
+
+
+struct IoCompletion {
+    Result result;  //!< Kind::System with errno on failure.
+    size_t bytes;   //!< Bytes transferred, may be short.
+};
+
+//! Called on an I/O thread, must not block.
+using IoCallback = std::function<void(const IoCompletion&)>;
+
+
+struct IoMessage {
+    typedef Message::cmd_t cmd_t;
+
+    static constexpr const cmd_t QUIT{Message::QUIT};
+    static constexpr const cmd_t READ{1};
+    static constexpr const cmd_t WRITE{2};
+    static constexpr const cmd_t FSYNC{3};
+
+    cmd_t command{QUIT};
+    //! A descriptor, or an index into IoParams::files if `fixed_file`.
+    int fd{-1};
+    bool fixed_file{false};
+    //! An index into IoParams::buffers that contains `buf`, -1 if none.
+    int buf_index{-1};
+    //! Owned by the caller until completion.
+    void* buf{nullptr};
+    size_t len{0};
+    uint64_t offset{0};
+    //! Start after all preceding requests complete, later ones wait for it.
+    bool barrier{false};
+    IoCallback done;
+
+    inline bool quit() const { return (command == QUIT); }
+};
+
+
+struct IoParams: WorkerParams {
+    static constexpr IoBackend kDefaultBackend{IoBackend::Auto};
+    static constexpr unsigned kDefaultEntries{256};
+    static constexpr unsigned kDefaultThreads{4};
+
+    IoBackend backend;
+    //! Submission queue size of io_uring.
+    unsigned entries;
+    //! Threads of the fallback pool.
+    unsigned threads;
+    //! Registered with io_uring, see IoMessage::buf_index.
+    std::vector<iovec> buffers;
+    //! Registered with io_uring, see IoMessage::fixed_file.
+    std::vector<int> files;
+
+    IoParams()
+        : backend{kDefaultBackend}
+        , entries{kDefaultEntries}
+        , threads{kDefaultThreads}
+    {
+        name = "io";
+    }
+};
+
+
+namespace details {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                    io_uring on raw system calls
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+class Uring {
+    int fd_;
+    void* sq_ptr_;
+    size_t sq_size_;
+    void* cq_ptr_;
+    size_t cq_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_array_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    io_uring_cqe* cqes_;
+    unsigned cq_mask_;
+    unsigned cq_entries_;
+
+    //! Local SQ tail and SQEs not yet passed to the kernel.
+    unsigned tail_;
+    unsigned pending_;
+
+    void release() {
+        if( sqes_ ) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if( cq_ptr_ && cq_ptr_ != sq_ptr_ ) {
+            ::munmap(cq_ptr_, cq_size_);
+        }
+        if( sq_ptr_ ) {
+            ::munmap(sq_ptr_, sq_size_);
+        }
+        if( fd_ >= 0 ) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+        sq_ptr_ = cq_ptr_ = nullptr;
+        sqes_ = nullptr;
+    }
+
+    static void* map(size_t size, int fd, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    template <typename T>
+    static T* at(void* base, unsigned offset) {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+public:
+    Uring()
+        : fd_{-1}, sq_ptr_{nullptr}, sq_size_{0}, cq_ptr_{nullptr}, cq_size_{0}
+        , sqes_{nullptr}, sqes_size_{0}
+        , sq_head_{nullptr}, sq_tail_{nullptr}, sq_array_{nullptr}, sq_mask_{0}, sq_entries_{0}
+        , cq_head_{nullptr}, cq_tail_{nullptr}, cqes_{nullptr}, cq_mask_{0}, cq_entries_{0}
+        , tail_{0}, pending_{0}
+    {}
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    ~Uring() { release(); }
+
+    Result init(unsigned entries) {
+        io_uring_params p{};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if( fd_ < 0 ) {
+            fd_ = -1;
+            return errno_result("io_uring_setup()");
+        }
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if( single ) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ptr_ = map(sq_size_, fd_, IORING_OFF_SQ_RING);
+        if( !sq_ptr_ ) {
+            auto err = errno_result("mmap(SQ ring)");
+            release();
+            return err;
+        }
+        cq_ptr_ = single ? sq_ptr_ : map(cq_size_, fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, fd_, IORING_OFF_SQES));
+        if( !cq_ptr_ || !sqes_ ) {
+            auto err = errno_result("mmap(io_uring)");
+            release();
+            return err;
+        }
+        sq_head_ = at<unsigned>(sq_ptr_, p.sq_off.head);
+        sq_tail_ = at<unsigned>(sq_ptr_, p.sq_off.tail);
+        sq_array_ = at<unsigned>(sq_ptr_, p.sq_off.array);
+        sq_mask_ = *at<unsigned>(sq_ptr_, p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        cq_head_ = at<unsigned>(cq_ptr_, p.cq_off.head);
+        cq_tail_ = at<unsigned>(cq_ptr_, p.cq_off.tail);
+        cqes_ = at<io_uring_cqe>(cq_ptr_, p.cq_off.cqes);
+        cq_mask_ = *at<unsigned>(cq_ptr_, p.cq_off.ring_mask);
+        cq_entries_ = p.cq_entries;
+        tail_ = *sq_tail_;
+        return {};
+    }
+
+    //! Max requests in flight so that completions never overflow.
+    unsigned capacity() const { return cq_entries_; }
+
+    Result register_buffers(const std::vector<iovec>& buffers) {
+        if( buffers.empty() ) {
+            return {};
+        }
+        if( ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                      buffers.data(), static_cast<unsigned>(buffers.size())) < 0 ) {
+            return errno_result("io_uring_register(BUFFERS)");
+        }
+        return {};
+    }
+
+    Result register_files(const std::vector<int>& files) {
+        if( files.empty() ) {
+            return {};
+        }
+        if( ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES,
+                      files.data(), static_cast<unsigned>(files.size())) < 0 ) {
+            return errno_result("io_uring_register(FILES)");
+        }
+        return {};
+    }
+
+    //! Fails unless the kernel supports every opcode in `ops`. Kernels
+    //! without IORING_REGISTER_PROBE (< 5.6) lack IORING_OP_READ/WRITE too.
+    Result probe(std::initializer_list<unsigned> ops) {
+        constexpr unsigned kOps{256};
+        std::vector<unsigned char> buf(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op), 0);
+        auto* p = reinterpret_cast<io_uring_probe*>(buf.data());
+        if( ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, p, kOps) < 0 ) {
+            return errno_result("io_uring_register(PROBE)");
+        }
+        for( unsigned op: ops ) {
+            if( op > p->last_op || (p->ops[op].flags & IO_URING_OP_SUPPORTED) == 0 ) {
+                return {format("io_uring opcode {} is not supported", op), Result::Kind::System};
+            }
+        }
+        return {};
+    }
+
+    //! The kernel signals `evfd` on every completion.
+    Result register_eventfd(int evfd) {
+        if( ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_EVENTFD, &evfd, 1) < 0 ) {
+            return errno_result("io_uring_register(EVENTFD)");
+        }
+        return {};
+    }
+
+    //! A zeroed SQE, nullptr if the submission queue is full.
+    io_uring_sqe* get_sqe() {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if( tail_ - head >= sq_entries_ ) {
+            return nullptr;
+        }
+        const unsigned index = tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        ++tail_;
+        ++pending_;
+        return sqe;
+    }
+
+    unsigned pending() const { return pending_; }
+
+    //! Passes pending SQEs to the kernel and waits for `wait_nr` completions.
+    //! Returns the number of SQEs consumed, or -errno.
+    int submit(unsigned wait_nr = 0) {
+        __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+        for(;;) {
+            const long n = ::syscall(__NR_io_uring_enter, fd_, pending_, wait_nr,
+                                     wait_nr ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if( n >= 0 ) {
+                pending_ -= static_cast<unsigned>(n);
+                return static_cast<int>(n);
+            }
+            if( errno != EINTR ) {
+                return -errno;
+            }
+        }
+    }
+
+    //! Calls `fn(user_data, res)` for each completion.
+    template <typename TFunc>
+    unsigned reap(TFunc&& fn) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count{0};
+        while( head != tail ) {
+            const io_uring_cqe cqe = cqes_[head & cq_mask_];
+            ++head;
+            // Free the slot before the callback.
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            fn(cqe.user_data, cqe.res);
+            ++count;
+        }
+        return count;
+    }
+};
+
+
+//! Blocking equivalent of `msg`, used by the thread pool.
+inline IoCompletion io_execute(const IoMessage& msg, int fd) {
+    ssize_t n{0};
+    switch( msg.command ) {
+    case IoMessage::READ:
+        n = ::pread(fd, msg.buf, msg.len, static_cast<off_t>(msg.offset));
+        break;
+    case IoMessage::WRITE:
+        n = ::pwrite(fd, msg.buf, msg.len, static_cast<off_t>(msg.offset));
+        break;
+    case IoMessage::FSYNC:
+        n = ::fsync(fd);
+        break;
+    default:
+        return {{format("unknown I/O command {}", msg.command), Result::Kind::Invalid}, 0};
+    }
+    if( n < 0 ) {
+        return {errno_result("I/O"), 0};
+    }
+    return {{}, static_cast<size_t>(n)};
+}
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                             I/O Worker
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      IoWorker
+ * @brief      Executes IoMessage requests asynchronously.
+ *
+ * @details    With io_uring, requests received while the worker is
+ * busy are submitted together just before it sleeps, completions
+ * wake it through an eventfd watched by ReactorWorker and callbacks
+ * run on the worker thread. With the thread pool, callbacks run on
+ * a pool thread and a barrier request waits for the pool to drain.
+ * Requests in flight complete before terminate() returns.
+ *
+ * Exports `tec_io_requests_total`, `tec_io_submits_total` and
+ * `tec_io_errors_total`, labelled `worker`.
+ */
+class IoWorker: public ReactorWorker<IoParams, IoMessage> {
+public:
+    using Base = ReactorWorker<IoParams, IoMessage>;
+
+private:
+    IoBackend backend_;
+
+    // io_uring.
+    std::unique_ptr<details::Uring> ring_;
+    int cq_evfd_;
+    //! Callbacks of requests in flight, indexed by user_data.
+    std::vector<IoCallback> slots_;
+    std::vector<uint32_t> free_;
+
+    // Thread pool.
+    SafeQueue<IoMessage> jobs_;
+    std::vector<std::thread> pool_;
+    size_t running_;
+    std::mutex mtx_running_;
+    std::condition_variable cv_running_;
+
+    std::shared_ptr<metrics::Counter> m_requests_;
+    std::shared_ptr<metrics::Counter> m_submits_;
+    std::shared_ptr<metrics::Counter> m_errors_;
+
+    static IoCompletion completion(int res) {
+        if( res < 0 ) {
+            return {details::errno_result("I/O", -res), 0};
+        }
+        return {{}, static_cast<size_t>(res)};
+    }
+
+    void complete(const IoCallback& done, const IoCompletion& c) {
+        if( !c.result ) {
+            m_errors_->inc();
+        }
+        if( done ) {
+            done(c);
+        }
+    }
+
+    size_t inflight() const { return slots_.size() - free_.size(); }
+
+    void reap() {
+        ring_->reap([this](uint64_t user_data, int res) {
+            const auto slot = static_cast<uint32_t>(user_data);
+            IoCallback done = std::move(slots_[slot]);
+            slots_[slot] = nullptr;
+            free_.push_back(slot);
+            complete(done, completion(res));
+        });
+    }
+
+    //! Submits pending SQEs, waiting for `wait_nr` completions.
+    Result flush(unsigned wait_nr = 0) {
+        TEC_ENTER("IoWorker::flush");
+        if( ring_->pending() == 0 && wait_nr == 0 ) {
+            return {};
+        }
+        m_submits_->inc();
+        Result result;
+        if( int n = ring_->submit(wait_nr); n < 0 ) {
+            TEC_TRACE("io_uring_enter() failed: {}", -n);
+            result = details::errno_result("io_uring_enter()", -n);
+        }
+        reap();
+        return result;
+    }
+
+    //! Completes every request in flight with `result`.
+    void abandon(const Result& result) {
+        std::vector<bool> idle(slots_.size(), false);
+        for( uint32_t slot: free_ ) {
+            idle[slot] = true;
+        }
+        for( uint32_t slot = 0; slot < slots_.size(); ++slot ) {
+            if( !idle[slot] ) {
+                IoCallback done = std::move(slots_[slot]);
+                slots_[slot] = nullptr;
+                free_.push_back(slot);
+                complete(done, {result, 0});
+            }
+        }
+    }
+
+    void submit_uring(const IoMessage& msg) {
+        Result busy{"io_uring submission queue is full", Result::Kind::RuntimeErr};
+        if( free_.empty() ) {
+            // As many in flight as the completion queue holds.
+            if( auto result = flush(1); !result ) {
+                busy = result;
+            }
+        }
+        io_uring_sqe* sqe = free_.empty() ? nullptr : ring_->get_sqe();
+        if( !sqe && !free_.empty() ) {
+            if( auto result = flush(); !result ) {
+                busy = result;
+            }
+            sqe = ring_->get_sqe();
+        }
+        if( !sqe ) {
+            complete(msg.done, {busy, 0});
+            return;
+        }
+        const bool fixed_buf = msg.buf_index >= 0;
+        switch( msg.command ) {
+        case IoMessage::READ:
+            sqe->opcode = fixed_buf ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            break;
+        case IoMessage::WRITE:
+            sqe->opcode = fixed_buf ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            break;
+        case IoMessage::FSYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        default:
+            sqe->opcode = IORING_OP_NOP;
+            break;
+        }
+        sqe->fd = msg.fd;
+        sqe->flags = (msg.fixed_file ? IOSQE_FIXED_FILE : 0) | (msg.barrier ? IOSQE_IO_DRAIN : 0);
+        if( msg.command != IoMessage::FSYNC ) {
+            sqe->addr = reinterpret_cast<uint64_t>(msg.buf);
+            sqe->len = static_cast<uint32_t>(msg.len);
+            sqe->off = msg.offset;
+            if( fixed_buf ) {
+                sqe->buf_index = static_cast<uint16_t>(msg.buf_index);
+            }
+        }
+        const uint32_t slot = free_.back();
+        free_.pop_back();
+        slots_[slot] = msg.done;
+        sqe->user_data = slot;
+    }
+
+    int pool_fd(const IoMessage& msg) const {
+        if( !msg.fixed_file ) {
+            return msg.fd;
+        }
+        return (msg.fd >= 0 && static_cast<size_t>(msg.fd) < params_.files.size())
+            ? params_.files[static_cast<size_t>(msg.fd)] : -1;
+    }
+
+    void pool_done() {
+        std::lock_guard<std::mutex> lk(mtx_running_);
+        if( --running_ == 0 ) {
+            cv_running_.notify_all();
+        }
+    }
+
+    void pool_drain() {
+        std::unique_lock<std::mutex> lk(mtx_running_);
+        cv_running_.wait(lk, [this]{ return running_ == 0; });
+    }
+
+    void pool_proc() {
+        for(;;) {
+            IoMessage msg = jobs_.dequeue();
+            if( msg.quit() ) {
+                break;
+            }
+            complete(msg.done, details::io_execute(msg, pool_fd(msg)));
+            pool_done();
+        }
+    }
+
+    void submit_pool(const IoMessage& msg) {
+        if( msg.barrier ) {
+            // Run it here once the pool is idle; later requests wait.
+            pool_drain();
+            complete(msg.done, details::io_execute(msg, pool_fd(msg)));
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mtx_running_);
+            ++running_;
+        }
+        jobs_.enqueue(msg);
+    }
+
+    Result init_uring() {
+        auto ring = std::make_unique<details::Uring>();
+        if( auto result = ring->init(params_.entries); !result ) {
+            return result;
+        }
+        if( auto result = ring->probe({IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC}); !result ) {
+            return result;
+        }
+        if( auto result = ring->register_buffers(params_.buffers); !result ) {
+            return result;
+        }
+        if( auto result = ring->register_files(params_.files); !result ) {
+            return result;
+        }
+        cq_evfd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if( cq_evfd_ < 0 ) {
+            return details::errno_result("eventfd()");
+        }
+        if( auto result = ring->register_eventfd(cq_evfd_); !result ) {
+            return result;
+        }
+        if( auto result = watch(cq_evfd_, true); !result ) {
+            return result;
+        }
+        slots_.resize(ring->capacity());
+        free_.reserve(slots_.size());
+        for( uint32_t i = static_cast<uint32_t>(slots_.size()); i > 0; --i ) {
+            free_.push_back(i - 1);
+        }
+        ring_ = std::move(ring);
+        return {};
+    }
+
+public:
+    explicit IoWorker(const IoParams& params, Launch launch = Launch::Eager)
+        : Base(params, launch)
+        , backend_{params.backend}
+        , cq_evfd_{-1}
+        , running_{0}
+        , m_requests_{metrics::registry().instance<metrics::Counter>(
+                "tec_io_requests_total", "I/O requests received.",
+                metrics::label("worker", name_))}
+        , m_submits_{metrics::registry().instance<metrics::Counter>(
+                "tec_io_submits_total", "io_uring_enter() calls submitting requests.",
+                metrics::label("worker", name_))}
+        , m_errors_{metrics::registry().instance<metrics::Counter>(
+                "tec_io_errors_total", "I/O requests that failed.",
+                metrics::label("worker", name_))}
+    {}
+
+    virtual ~IoWorker() {
+        if( thread_.joinable() ) {
+            terminate();
+        }
+        if( cq_evfd_ >= 0 ) {
+            ::close(cq_evfd_);
+        }
+    }
+
+    //! Backend in use, Auto until init() has chosen one.
+    IoBackend backend() const { return backend_; }
+
+    bool read(int fd, void* buf, size_t len, uint64_t offset, IoCallback done) {
+        IoMessage msg;
+        msg.command = IoMessage::READ;
+        msg.fd = fd;
+        msg.buf = buf;
+        msg.len = len;
+        msg.offset = offset;
+        msg.done = std::move(done);
+        return send(msg);
+    }
+
+    bool write(int fd, const void* buf, size_t len, uint64_t offset, IoCallback done) {
+        IoMessage msg;
+        msg.command = IoMessage::WRITE;
+        msg.fd = fd;
+        msg.buf = const_cast<void*>(buf);
+        msg.len = len;
+        msg.offset = offset;
+        msg.done = std::move(done);
+        return send(msg);
+    }
+
+    //! Flushes `fd` after all the preceding requests have completed.
+    bool fsync(int fd, IoCallback done) {
+        IoMessage msg;
+        msg.command = IoMessage::FSYNC;
+        msg.fd = fd;
+        msg.barrier = true;
+        msg.done = std::move(done);
+        return send(msg);
+    }
+
+    std::future<IoCompletion> read(int fd, void* buf, size_t len, uint64_t offset) {
+        return with_future([&](IoCallback done) { return read(fd, buf, len, offset, std::move(done)); });
+    }
+
+    std::future<IoCompletion> write(int fd, const void* buf, size_t len, uint64_t offset) {
+        return with_future([&](IoCallback done) { return write(fd, buf, len, offset, std::move(done)); });
+    }
+
+    std::future<IoCompletion> fsync(int fd) {
+        return with_future([&](IoCallback done) { return fsync(fd, std::move(done)); });
+    }
+
+private:
+    template <typename TSubmit>
+    static std::future<IoCompletion> with_future(TSubmit submit) {
+        auto promise = std::make_shared<std::promise<IoCompletion>>();
+        auto future = promise->get_future();
+        if( !submit([promise](const IoCompletion& c) { promise->set_value(c); }) ) {
+            promise->set_value({{"worker is not running", Result::Kind::RuntimeErr}, 0});
+        }
+        return future;
+    }
+
+protected:
+    Result init() override {
+        TEC_ENTER("IoWorker::init");
+        if( params_.backend != IoBackend::Threads ) {
+            auto result = init_uring();
+            if( result ) {
+                backend_ = IoBackend::Uring;
+                return {};
+            }
+            if( params_.backend == IoBackend::Uring ) {
+                return result;
+            }
+            TEC_TRACE("io_uring is not available: {}", result);
+        }
+        backend_ = IoBackend::Threads;
+        const unsigned threads = params_.threads > 0 ? params_.threads : 1;
+        for( unsigned i = 0; i < threads; ++i ) {
+            pool_.emplace_back([this] { pool_proc(); });
+        }
+        return {};
+    }
+
+    void process(const IoMessage& msg) final {
+        m_requests_->inc();
+        if( ring_ ) {
+            submit_uring(msg);
+        }
+        else {
+            submit_pool(msg);
+        }
+    }
+
+    Result finalize() override {
+        if( ring_ ) {
+            Result result = flush();
+            while( result && inflight() > 0 ) {
+                result = flush(1);
+            }
+            if( !result ) {
+                // The kernel cancels what is left when the ring is closed.
+                abandon(result);
+            }
+            unwatch(cq_evfd_);
+            ring_.reset();
+        }
+        else {
+            for( size_t i = 0; i < pool_.size(); ++i ) {
+                jobs_.enqueue(quit<IoMessage>());
+            }
+            for( auto& t: pool_ ) {
+                t.join();
+            }
+            pool_.clear();
+        }
+        return {};
+    }
+
+    void on_readable(int fd) final {
+        if( fd == cq_evfd_ && ring_ ) {
+            uint64_t count;
+            [[maybe_unused]] auto n = ::read(cq_evfd_, &count, sizeof(count));
+            reap();
+        }
+    }
+
+    //! Submits the batch collected while busy before going to sleep.
+    bool next_message(Envelope& env, TimerClock::time_point deadline) override {
+        if( mq_.try_dequeue(env) ) {
+            return true;
+        }
+        if( ring_ ) {
+            flush();
+        }
+        return Base::next_message(env, deadline);
+    }
+
+}; // ::IoWorker
+
+
+} // ::tec
@@ -0,0 +1,283 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_message.hpp
+ *   @brief A Message carrying a typed payload without heap allocation.
+ *
+ *  PayloadMessage<N> is a tec::Message with room for one value of any
+ *  type. Values up to N bytes (16-byte aligned, nothrow movable) live
+ *  inside the message; larger ones spill to the sending thread's
+ *  SlabPool, see tec_pool.hpp. Control and small-data messages never
+ *  touch the heap. SmallMessage is 64 bytes, one cache line.
+ *
+ *  @code
+ *  using Msg = tec::SmallMessage;
+ *  struct Fill { uint64_t order; double price; uint32_t qty; };
+ *
+ *  worker.send(Msg{CMD_FILL, Fill{42, 101.5, 100}});
+ *  ...
+ *  void process(const Msg& msg) override {
+ *      if( const Fill* fill = msg.get<Fill>() ) {
+ *          ...
+ *      }
+ *  }
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_pool.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Payload message
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      PayloadMessage
+ * @brief      A Message with an inline buffer of N bytes for its payload.
+ *
+ * @details    Copies of an inline payload are independent; copies of a
+ * spilled one share the object, like the copy made by Worker::send().
+ * Spilled values larger than 4 KiB use std::shared_ptr, as do smaller
+ * ones when the thread's pool is out of memory.
+ */
+template <size_t N = 48>
+class PayloadMessage {
+    static_assert(N >= sizeof(std::shared_ptr<int>), "the buffer must hold a spilled payload");
+
+public:
+    typedef Message::cmd_t cmd_t;
+
+    //! Quit message loop command.
+    static constexpr const cmd_t QUIT{Message::QUIT};
+
+    //! Bytes available inline.
+    static constexpr size_t kInline{N};
+
+    cmd_t command; //!< A command.
+
+private:
+    //! Type-erased operations of the stored value.
+    struct Ops {
+        void (*copy)(const void* src, void* dst);
+        void (*move)(void* src, void* dst);  //!< Also destroys `src`.
+        void (*destroy)(void* p);
+        bool spilled;
+    };
+
+    template <typename T>
+    static constexpr bool fits_inline() {
+        return sizeof(T) <= N && alignof(T) <= 16 && std::is_nothrow_move_constructible_v<T>;
+    }
+
+    //! How a spilled T is held inside the buffer.
+    template <typename T>
+    using Spill = std::conditional_t<
+        (alignof(T) <= 16 && details::pool_size_class(sizeof(details::PoolHeader) + sizeof(T)) <= 4096),
+        PoolPtr<T>, std::shared_ptr<T>>;
+
+    //! What the buffer holds for a T.
+    template <typename T>
+    using Stored = std::conditional_t<fits_inline<T>(), T, Spill<T>>;
+
+    template <typename S>
+    static constexpr Ops make_ops(bool spilled) {
+        return {
+            [](const void* src, void* dst) { new (dst) S(*static_cast<const S*>(src)); },
+            [](void* src, void* dst) {
+                new (dst) S(std::move(*static_cast<S*>(src)));
+                static_cast<S*>(src)->~S();
+            },
+            [](void* p) { static_cast<S*>(p)->~S(); },
+            spilled
+        };
+    }
+
+    //! One instance per type: its address identifies the type.
+    template <typename T>
+    static inline constexpr Ops ops_of = make_ops<Stored<T>>(!fits_inline<T>());
+
+    //! A pooled T spilled to std::shared_ptr when the pool has failed.
+    template <typename T>
+    static inline constexpr Ops ops_fallback_of = make_ops<std::shared_ptr<T>>(true);
+
+    template <typename T>
+    static constexpr bool pooled() {
+        return !fits_inline<T>() && std::is_same_v<Spill<T>, PoolPtr<T>>;
+    }
+
+    const Ops* ops_;
+    alignas(16) unsigned char buf_[N];
+
+public:
+    PayloadMessage(): command{QUIT}, ops_{nullptr} {}
+
+    PayloadMessage(cmd_t cmd): command{cmd}, ops_{nullptr} {}
+
+    template <typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, PayloadMessage>>>
+    PayloadMessage(cmd_t cmd, T&& value): command{cmd}, ops_{nullptr} {
+        emplace<std::decay_t<T>>(std::forward<T>(value));
+    }
+
+    PayloadMessage(const PayloadMessage& other): command{other.command}, ops_{other.ops_} {
+        if( ops_ ) {
+            ops_->copy(other.buf_, buf_);
+        }
+    }
+
+    PayloadMessage(PayloadMessage&& other) noexcept: command{other.command}, ops_{other.ops_} {
+        if( ops_ ) {
+            ops_->move(other.buf_, buf_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    PayloadMessage& operator=(const PayloadMessage& other) {
+        if( this != &other ) {
+            PayloadMessage tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    PayloadMessage& operator=(PayloadMessage&& other) noexcept {
+        if( this != &other ) {
+            reset();
+            command = other.command;
+            ops_ = other.ops_;
+            if( ops_ ) {
+                ops_->move(other.buf_, buf_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    ~PayloadMessage() { reset(); }
+
+    //! Indicates that message loop should be terminated.
+    inline bool quit() const { return (command == QUIT); }
+
+    //! Stores a T made of `args`, replacing the payload.
+    template <typename T, typename... Args>
+    T& emplace(Args&&... args) {
+        reset();
+        if constexpr ( fits_inline<T>() ) {
+            T* p = new (buf_) T(std::forward<Args>(args)...);
+            ops_ = &ops_of<T>;
+            return *p;
+        }
+        else {
+            T value(std::forward<Args>(args)...);
+            if constexpr ( pooled<T>() ) {
+                if( auto pooled = make_pooled<T>(std::move(value)) ) {
+                    auto* p = new (buf_) PoolPtr<T>(std::move(pooled));
+                    ops_ = &ops_of<T>;
+                    return **p;
+                }
+                // make_pooled() has not moved from `value`.
+                auto* p = new (buf_) std::shared_ptr<T>(std::make_shared<T>(std::move(value)));
+                ops_ = &ops_fallback_of<T>;
+                return **p;
+            }
+            else {
+                auto* p = new (buf_) Spill<T>(std::make_shared<T>(std::move(value)));
+                ops_ = &ops_of<T>;
+                return **p;
+            }
+        }
+    }
+
+    //! Destroys the payload.
+    void reset() {
+        if( ops_ ) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
+    }
+
+    bool has_payload() const { return ops_ != nullptr; }
+
+    //! False for no payload or a payload held inline.
+    bool spilled() const { return ops_ && ops_->spilled; }
+
+    template <typename T>
+    bool holds() const {
+        if constexpr ( pooled<T>() ) {
+            return ops_ == &ops_of<T> || ops_ == &ops_fallback_of<T>;
+        }
+        else {
+            return ops_ == &ops_of<T>;
+        }
+    }
+
+    //! The payload if it is a T, otherwise nullptr.
+    template <typename T>
+    T* get() {
+        if( !holds<T>() ) {
+            return nullptr;
+        }
+        if constexpr ( fits_inline<T>() ) {
+            return std::launder(reinterpret_cast<T*>(buf_));
+        }
+        else {
+            if constexpr ( pooled<T>() ) {
+                if( ops_ == &ops_fallback_of<T> ) {
+                    return std::launder(reinterpret_cast<std::shared_ptr<T>*>(buf_))->get();
+                }
+            }
+            return std::launder(reinterpret_cast<Spill<T>*>(buf_))->get();
+        }
+    }
+
+    template <typename T>
+    const T* get() const {
+        return const_cast<PayloadMessage*>(this)->template get<T>();
+    }
+};
+
+
+//! 64 bytes: a command, a type tag and 48 bytes of payload.
+using SmallMessage = PayloadMessage<48>;
+
+static_assert(sizeof(SmallMessage) == 64, "SmallMessage must fit a cache line");
+
+
+} // ::tec
@@ -0,0 +1,476 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_metrics.hpp
+ *   @brief Lock-free metrics: counters, gauges and histograms.
+ *
+ *  Counters and histograms are sharded per thread, every shard sits on
+ *  its own cache line, so concurrent updates never contend; reading
+ *  a metric sums up the shards. The registry is locked only when
+ *  a metric is created or enumerated.
+ *
+ *  @code
+ *  auto sent = tec::metrics::registry().counter(
+ *      "app_requests_total", "Requests handled.", tec::metrics::label("handler", "login"));
+ *  sent->inc();
+ *  @endcode
+ *
+ *  The registry keeps weak references: a metric disappears when its
+ *  last owner releases it. A Probe computes its value only when the
+ *  registry is read, so the owner's hot path pays nothing for it.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_histogram.hpp"
+
+
+namespace tec {
+
+namespace metrics {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Sharding
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Number of per-thread shards (a power of two).
+constexpr const size_t kShards{16};
+
+//! Cache line size used for padding.
+constexpr const size_t kCacheLine{64};
+
+namespace details {
+
+//! Threads get shards round-robin.
+struct shard {
+    static size_t index() {
+        static std::atomic<size_t> __next{0};
+        thread_local const size_t __idx = __next.fetch_add(1, std::memory_order_relaxed) & (kShards - 1);
+        return __idx;
+    }
+};
+
+template <typename T>
+struct alignas(kCacheLine) padded {
+    std::atomic<T> value{0};
+};
+
+inline void atomic_min(std::atomic<uint64_t>& a, uint64_t v) {
+    uint64_t cur = a.load(std::memory_order_relaxed);
+    while( v < cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed) ) {}
+}
+
+inline void atomic_max(std::atomic<uint64_t>& a, uint64_t v) {
+    uint64_t cur = a.load(std::memory_order_relaxed);
+    while( v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed) ) {}
+}
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Metrics
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+enum class Type { Counter, Gauge, Histogram };
+
+//! Metric type as string (Prometheus notation).
+constexpr const char* type_as_string(Type t) {
+    switch (t) {
+        case Type::Counter: return "counter";
+        case Type::Gauge: return "gauge";
+        case Type::Histogram: return "histogram";
+        default: return "untyped";
+    }
+}
+
+
+//! Common metric attributes.
+class Metric {
+    Type type_;
+    std::string name_;
+    std::string help_;
+    std::string labels_;
+
+public:
+    Metric(Type type, const std::string& name, const std::string& help, const std::string& labels)
+        : type_{type}
+        , name_{name}
+        , help_{help}
+        , labels_{labels}
+    {}
+
+    Metric(const Metric&) = delete;
+    Metric(Metric&&) = delete;
+    virtual ~Metric() = default;
+
+    Type type() const { return type_; }
+    //! Family name, e.g. "tec_worker_messages_sent_total".
+    const std::string& name() const { return name_; }
+    const std::string& help() const { return help_; }
+    //! Labels in Prometheus notation w/o braces, e.g. `worker="w1"`; may be empty.
+    const std::string& labels() const { return labels_; }
+};
+
+
+//! Monotonic counter, sharded per thread.
+class Counter: public Metric {
+    std::array<details::padded<uint64_t>, kShards> shards_;
+
+public:
+    Counter(const std::string& name, const std::string& help, const std::string& labels)
+        : Metric(Type::Counter, name, help, labels)
+    {}
+
+    void inc(uint64_t n = 1) {
+        shards_[details::shard::index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t sum{0};
+        for( const auto& s: shards_ ) {
+            sum += s.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+};
+
+
+//! A value that goes up and down.
+class Gauge: public Metric {
+    alignas(kCacheLine) std::atomic<int64_t> value_;
+
+public:
+    Gauge(const std::string& name, const std::string& help, const std::string& labels)
+        : Metric(Type::Gauge, name, help, labels)
+        , value_{0}
+    {}
+
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1) { value_.fetch_sub(n, std::memory_order_relaxed); }
+
+    //! Sets the gauge to `v` if it is greater than the current value.
+    void set_max(int64_t v) {
+        int64_t cur = value_.load(std::memory_order_relaxed);
+        while( v > cur && !value_.compare_exchange_weak(cur, v, std::memory_order_relaxed) ) {}
+    }
+
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+
+/**
+ * @class      Probe
+ * @brief      A counter or gauge read from a callback at scrape time.
+ *
+ * @details    Costs nothing until the metric is read, which suits values
+ * the owner already keeps, such as a queue length. The owner must
+ * call detach() before the state read by the callback goes away;
+ * a detached probe reads 0.
+ */
+class Probe: public Metric {
+    mutable std::mutex mtx_;
+    std::function<int64_t()> fn_;
+
+public:
+    Probe(const std::string& name, const std::string& help, const std::string& labels,
+          Type type, std::function<int64_t()> fn)
+        : Metric(type, name, help, labels)
+        , fn_{std::move(fn)}
+    {}
+
+    int64_t value() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return fn_ ? fn_() : 0;
+    }
+
+    //! Drops the callback, waiting for a running read to complete.
+    void detach() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        fn_ = nullptr;
+    }
+};
+
+
+/**
+ * @class      Histogram
+ * @brief      Log-linear histogram (see tec::Histogram), sharded per thread.
+ *
+ * @details    A shard (~9 Kb) is allocated on the first record() from
+ * a thread mapped to it.
+ */
+class Histogram: public Metric {
+    struct alignas(kCacheLine) Shard {
+        std::array<std::atomic<uint64_t>, tec::details::log_linear::kBuckets> buckets;
+        alignas(kCacheLine) std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> min;
+        std::atomic<uint64_t> max;
+
+        Shard()
+            : sum{0}
+            , min{std::numeric_limits<uint64_t>::max()}
+            , max{0}
+        {
+            for( auto& b: buckets ) {
+                b.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::array<std::atomic<Shard*>, kShards> shards_;
+
+    Shard* shard() {
+        auto& slot = shards_[details::shard::index()];
+        Shard* s = slot.load(std::memory_order_acquire);
+        if( s == nullptr ) {
+            Shard* fresh = new Shard;
+            if( slot.compare_exchange_strong(s, fresh, std::memory_order_acq_rel) ) {
+                s = fresh;
+            }
+            else {
+                delete fresh;
+            }
+        }
+        return s;
+    }
+
+public:
+    Histogram(const std::string& name, const std::string& help, const std::string& labels)
+        : Metric(Type::Histogram, name, help, labels)
+    {
+        for( auto& s: shards_ ) {
+            s.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~Histogram() {
+        for( auto& s: shards_ ) {
+            delete s.load(std::memory_order_acquire);
+        }
+    }
+
+    //! Records a single value, usually nanoseconds.
+    void record(uint64_t v) {
+        Shard* s = shard();
+        s->buckets[tec::details::log_linear::index(v)].fetch_add(1, std::memory_order_relaxed);
+        s->sum.fetch_add(v, std::memory_order_relaxed);
+        details::atomic_min(s->min, v);
+        details::atomic_max(s->max, v);
+    }
+
+    //! Aggregates all shards.
+    tec::Histogram snapshot() const {
+        tec::Histogram result;
+        tec::Histogram::Buckets buckets;
+        for( const auto& slot: shards_ ) {
+            const Shard* s = slot.load(std::memory_order_acquire);
+            if( s == nullptr ) {
+                continue;
+            }
+            for( size_t i = 0; i < buckets.size(); ++i ) {
+                buckets[i] = s->buckets[i].load(std::memory_order_relaxed);
+            }
+            result.merge(buckets,
+                         s->sum.load(std::memory_order_relaxed),
+                         s->min.load(std::memory_order_relaxed),
+                         s->max.load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Registry
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Formats a label pair, escaping the value: `key="value"`.
+inline std::string label(const std::string& key, const std::string& value) {
+    std::string out;
+    out.reserve(key.size() + value.size() + 3);
+    out.append(key).append("=\"");
+    for( char c: value ) {
+        switch (c) {
+            case '\\': out.append("\\\\"); break;
+            case '"': out.append("\\\""); break;
+            case '\n': out.append("\\n"); break;
+            default: out.push_back(c);
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+
+/**
+ * @class      Registry
+ * @brief      Named metrics.
+ *
+ * @details    counter(), gauge() and histogram() return an existing
+ * metric with the same name and labels or create a new one. Keep the
+ * returned pointer: look-ups take a lock and are not meant for hot paths.
+ */
+class Registry {
+    using Lock = std::lock_guard<std::mutex>;
+
+    mutable std::mutex mtx_;
+    std::map<std::string, std::weak_ptr<Metric>> metrics_;
+    //! The next `instance` label per name and labels, see instance().
+    std::unordered_map<std::string, size_t> instances_;
+
+    static std::string series_key(const std::string& name, const std::string& labels) {
+        return labels.empty() ? name : name + "{" + labels + "}";
+    }
+
+    template <typename T>
+    std::shared_ptr<T> get_or_create(const std::string& name, const std::string& help, const std::string& labels) {
+        const std::string key = series_key(name, labels);
+        Lock lk(mtx_);
+        auto& slot = metrics_[key];
+        if( auto existing = slot.lock() ) {
+            if( auto typed = std::dynamic_pointer_cast<T>(existing) ) {
+                return typed;
+            }
+            // Same name, different type: hand out a detached metric.
+            return std::make_shared<T>(name, help, labels);
+        }
+        auto fresh = std::make_shared<T>(name, help, labels);
+        slot = fresh;
+        return fresh;
+    }
+
+public:
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry(Registry&&) = delete;
+
+    //! The process-wide registry.
+    static Registry& global() {
+        static Registry __registry;
+        return __registry;
+    }
+
+    std::shared_ptr<Counter> counter(const std::string& name, const std::string& help, const std::string& labels = {}) {
+        return get_or_create<Counter>(name, help, labels);
+    }
+
+    std::shared_ptr<Gauge> gauge(const std::string& name, const std::string& help, const std::string& labels = {}) {
+        return get_or_create<Gauge>(name, help, labels);
+    }
+
+    std::shared_ptr<Histogram> histogram(const std::string& name, const std::string& help, const std::string& labels = {}) {
+        return get_or_create<Histogram>(name, help, labels);
+    }
+
+    /**
+     * @brief      Creates a metric owned by the caller, never shared.
+     *
+     * @details    If a live metric already has the same name and labels,
+     * an `instance="N"` label is added to keep the series apart. N counts
+     * up per name and labels and is not reused, so creation stays O(1)
+     * however many instances share a name.
+     * Extra arguments are passed to the T constructor.
+     */
+    template <typename T, typename... Args>
+    std::shared_ptr<T> instance(const std::string& name, const std::string& help,
+                                const std::string& labels, Args&&... args) {
+        const std::string key = series_key(name, labels);
+        Lock lk(mtx_);
+        std::string unique{labels};
+        auto* slot = &metrics_[key];
+        if( !slot->expired() ) {
+            size_t& next = instances_[key];
+            // Loops only if `labels` was given an `instance` label by hand.
+            do {
+                unique = labels.empty() ? std::string{} : labels + ",";
+                unique.append(label("instance", std::to_string(++next)));
+                slot = &metrics_[series_key(name, unique)];
+            } while( !slot->expired() );
+        }
+        auto fresh = std::make_shared<T>(name, help, unique, std::forward<Args>(args)...);
+        *slot = fresh;
+        return fresh;
+    }
+
+    //! A Probe owned by the caller, see instance().
+    std::shared_ptr<Probe> probe(Type type, const std::string& name, const std::string& help,
+                                 const std::string& labels, std::function<int64_t()> fn) {
+        return instance<Probe>(name, help, labels, type, std::move(fn));
+    }
+
+    //! Calls `fn` for every live metric, ordered by name and labels.
+    //! Expired entries are removed.
+    void for_each(const std::function<void(const Metric&)>& fn) {
+        std::vector<std::shared_ptr<Metric>> live;
+        {
+            Lock lk(mtx_);
+            live.reserve(metrics_.size());
+            for( auto it = metrics_.begin(); it != metrics_.end(); ) {
+                if( auto m = it->second.lock() ) {
+                    live.push_back(std::move(m));
+                    ++it;
+                }
+                else {
+                    it = metrics_.erase(it);
+                }
+            }
+        }
+        for( const auto& m: live ) {
+            fn(*m);
+        }
+    }
+};
+
+
+//! The process-wide registry.
+inline Registry& registry() { return Registry::global(); }
+
+
+} // ::metrics
+
+} // ::tec
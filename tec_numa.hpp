@@ -0,0 +1,431 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_numa.hpp
+ *   @brief NUMA topology, worker placement and node-local arenas.
+ *
+ *  @code
+ *  auto topo = tec::NumaTopology::discover();
+ *  auto places = tec::place_workers(topo, 8, tec::Placement::Spread);
+ *  for( size_t i = 0; i < places.size(); ++i ) {
+ *      MyParams params;
+ *      tec::apply_placement(params, places[i]);
+ *      workers.push_back(std::make_unique<MyWorker>(params));
+ *  }
+ *  ...
+ *  // In MyWorker::init(), i.e. on the pinned thread:
+ *  arena_ = std::make_unique<tec::NumaArena>(64 << 20, tec::current_numa_node());
+ *  @endcode
+ *
+ *  No libnuma needed: topology comes from `/sys/devices/system/node`
+ *  and memory is bound with the mbind(2) syscall. Where binding is
+ *  unavailable the arena falls back to first touch, which places pages
+ *  on the node of the thread that creates the arena.
+ *
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_thread.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/tec_worker.hpp"
+
+#if !defined(__TEC_WINDOWS__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Topology
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct NumaNode {
+    int id;                 //!< Node number as the kernel sees it.
+    std::vector<int> cpus;  //!< CPUs of the node.
+    uint64_t mem_total;     //!< Memory of the node, in bytes; 0 if unknown.
+};
+
+
+namespace details {
+
+//! Parses a kernel CPU list such as "0-3,8-11,16".
+inline std::vector<int> parse_cpulist(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while( std::getline(ss, range, ',') ) {
+        if( range.empty() || range == "\n" ) {
+            continue;
+        }
+        const auto dash = range.find('-');
+        const int lo = std::atoi(range.c_str());
+        const int hi = (dash == std::string::npos) ? lo : std::atoi(range.c_str() + dash + 1);
+        for( int cpu = lo; cpu <= hi; ++cpu ) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline std::string read_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+} // ::details
+
+
+/**
+ * @class      NumaTopology
+ * @brief      NUMA nodes with CPUs.
+ *
+ * @details    Always has at least one node: machines without NUMA
+ * (or non-Linux) report a single node 0 with all CPUs.
+ */
+class NumaTopology {
+    std::vector<NumaNode> nodes_;
+    bool simulated_;
+
+public:
+    NumaTopology()
+        : simulated_{false}
+    {}
+
+    const std::vector<NumaNode>& nodes() const { return nodes_; }
+    size_t size() const { return nodes_.size(); }
+    const NumaNode& operator [] (size_t i) const { return nodes_[i]; }
+
+    //! Was it made by simulate()?
+    bool simulated() const { return simulated_; }
+
+    //! Node of `cpu` or -1.
+    int node_of_cpu(int cpu) const {
+        for( const auto& node: nodes_ ) {
+            if( std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end() ) {
+                return node.id;
+            }
+        }
+        return -1;
+    }
+
+    //! Reads the topology from sysfs.
+    static NumaTopology discover(const std::string& root = "/sys/devices/system/node") {
+        NumaTopology topo;
+        const auto online = details::parse_cpulist(details::read_line(root + "/online"));
+        for( int id: online ) {
+            const std::string dir = root + "/node" + std::to_string(id);
+            NumaNode node{id, details::parse_cpulist(details::read_line(dir + "/cpulist")), 0};
+            // "Node 0 MemTotal:        5340920 kB"
+            std::ifstream meminfo(dir + "/meminfo");
+            std::string line;
+            while( std::getline(meminfo, line) ) {
+                const auto pos = line.find("MemTotal:");
+                if( pos != std::string::npos ) {
+                    node.mem_total = std::strtoull(line.c_str() + pos + 9, nullptr, 10) * 1024;
+                    break;
+                }
+            }
+            if( !node.cpus.empty() ) {
+                topo.nodes_.push_back(std::move(node));
+            }
+        }
+        if( topo.nodes_.empty() ) {
+            NumaNode node{0, get_thread_affinity(), 0};
+            if( node.cpus.empty() ) {
+                const unsigned n = std::max(1u, std::thread::hardware_concurrency());
+                for( unsigned cpu = 0; cpu < n; ++cpu ) {
+                    node.cpus.push_back(static_cast<int>(cpu));
+                }
+            }
+            topo.nodes_.push_back(std::move(node));
+        }
+        return topo;
+    }
+
+    /**
+     * @brief      Splits the CPUs of a real topology into `n` fake nodes.
+     *
+     * @details    For testing placement on single-node machines. If there
+     * are fewer CPUs than nodes, CPUs are shared. Memory is not
+     * actually separated, NumaArena binds to the real node 0.
+     */
+    static NumaTopology simulate(size_t n, const NumaTopology& real = discover()) {
+        std::vector<int> cpus;
+        for( const auto& node: real.nodes() ) {
+            cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+        }
+        NumaTopology topo;
+        topo.simulated_ = true;
+        n = std::max<size_t>(1, n);
+        for( size_t i = 0; i < n; ++i ) {
+            NumaNode node{static_cast<int>(i), {}, 0};
+            const size_t begin = i * cpus.size() / n;
+            const size_t end = std::max(begin + 1, (i + 1) * cpus.size() / n);
+            for( size_t k = begin; k < end; ++k ) {
+                node.cpus.push_back(cpus[k % cpus.size()]);
+            }
+            topo.nodes_.push_back(std::move(node));
+        }
+        return topo;
+    }
+};
+
+
+//! NUMA node the calling thread is running on, 0 if unknown.
+inline int current_numa_node() {
+#if defined(__linux__)
+    unsigned cpu{0};
+    unsigned node{0};
+    if( ::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ) {
+        return static_cast<int>(node);
+    }
+#endif
+    return 0;
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Placement
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+enum class Placement {
+    Compact,  //!< Fill node 0 CPU by CPU, then node 1, etc.: shared caches.
+    Spread,   //!< Round-robin over nodes: memory bandwidth of all nodes.
+};
+
+
+//! Where a worker goes.
+struct WorkerPlacement {
+    int node;               //!< NUMA node id.
+    int cpu;                //!< A CPU of the node, for one worker per CPU.
+    std::vector<int> cpus;  //!< All CPUs of the node.
+};
+
+
+/**
+ * @brief      Places `count` workers of a group onto the topology.
+ *
+ * @details    When there are more workers than CPUs, CPUs are reused
+ * in the same order.
+ */
+inline std::vector<WorkerPlacement> place_workers(const NumaTopology& topo, size_t count, Placement policy) {
+    std::vector<WorkerPlacement> out;
+    out.reserve(count);
+    size_t total_cpus{0};
+    for( const auto& node: topo.nodes() ) {
+        total_cpus += node.cpus.size();
+    }
+    for( size_t i = 0; i < count; ++i ) {
+        size_t n{0};
+        size_t k{0};
+        if( policy == Placement::Spread ) {
+            n = i % topo.size();
+            k = (i / topo.size()) % topo[n].cpus.size();
+        }
+        else {
+            size_t slot = i % total_cpus;
+            while( slot >= topo[n].cpus.size() ) {
+                slot -= topo[n].cpus.size();
+                ++n;
+            }
+            k = slot;
+        }
+        out.push_back({topo[n].id, topo[n].cpus[k], topo[n].cpus});
+    }
+    return out;
+}
+
+
+/**
+ * @brief      Pins worker parameters to a placement.
+ *
+ * @param      params WorkerParams or a descendant.
+ * @param      place The placement.
+ * @param      pin_cpu Pin to the single CPU instead of the whole node.
+ */
+template <typename TParams>
+void apply_placement(TParams& params, const WorkerPlacement& place, bool pin_cpu = false) {
+    static_assert(std::is_base_of_v<WorkerParams, TParams>, "TParams must derive from tec::WorkerParams");
+    params.cpus = pin_cpu ? std::vector<int>{place.cpu} : place.cpus;
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Node-local arena
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      NumaArena
+ * @brief      Bump allocator over memory of one NUMA node.
+ *
+ * @details    The region is mmap()'ed, bound to `node` with mbind() and
+ * pre-faulted by the constructing thread. If mbind() fails (no NUMA,
+ * no permission, not Linux) pages stay where first touch puts them:
+ * on the node of the constructing thread, so create the arena from
+ * the worker's own thread, e.g. in init().
+ * Not thread-safe; deallocation happens all at once with reset().
+ */
+class NumaArena {
+    char* base_;
+    size_t size_;
+    size_t used_;
+    int node_;
+    Result bind_result_;
+
+public:
+    //! Use node -1 for first touch only.
+    NumaArena(size_t bytes, int node)
+        : base_{nullptr}
+        , size_{bytes}
+        , used_{0}
+        , node_{node}
+    {
+#if defined(__TEC_WINDOWS__)
+        base_ = static_cast<char*>(std::malloc(size_));
+        bind_result_ = details::not_supported("mbind()");
+#else
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        base_ = (p == MAP_FAILED) ? nullptr : static_cast<char*>(p);
+        if( base_ == nullptr ) {
+            bind_result_ = details::errno_result("mmap()");
+            size_ = 0;
+            return;
+        }
+#if defined(__linux__)
+        if( node_ >= 0 ) {
+            constexpr size_t kBits = sizeof(unsigned long) * 8;
+            std::vector<unsigned long> mask(static_cast<size_t>(node_) / kBits + 1, 0);
+            mask[static_cast<size_t>(node_) / kBits] = 1ul << (static_cast<size_t>(node_) % kBits);
+            if( ::syscall(SYS_mbind, base_, size_, MPOL_BIND, mask.data(), mask.size() * kBits + 1, 0) != 0 ) {
+                bind_result_ = details::errno_result("mbind()");
+            }
+        }
+#else
+        bind_result_ = details::not_supported("mbind()");
+#endif
+        // Fault the pages in now, on the right node.
+        const long page = ::sysconf(_SC_PAGESIZE);
+        for( size_t off = 0; off < size_; off += static_cast<size_t>(page) ) {
+            base_[off] = 0;
+        }
+#endif
+    }
+
+    NumaArena(const NumaArena&) = delete;
+    NumaArena& operator = (const NumaArena&) = delete;
+
+    ~NumaArena() {
+#if defined(__TEC_WINDOWS__)
+        std::free(base_);
+#else
+        if( base_ ) {
+            ::munmap(base_, size_);
+        }
+#endif
+    }
+
+    //! Node the arena was asked for.
+    int node() const { return node_; }
+    //! OK if the memory is bound to node(), otherwise why it is first-touch only.
+    const Result& bind_result() const { return bind_result_; }
+
+    size_t capacity() const { return size_; }
+    size_t used() const { return used_; }
+
+    //! Returns `nullptr` if the arena is exhausted.
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        const size_t start = (used_ + align - 1) & ~(align - 1);
+        if( base_ == nullptr || start + bytes > size_ ) {
+            return nullptr;
+        }
+        used_ = start + bytes;
+        return base_ + start;
+    }
+
+    //! Frees everything at once.
+    void reset() { used_ = 0; }
+};
+
+
+//! STL allocator over a NumaArena; deallocate() is a no-op.
+template <typename T>
+class ArenaAllocator {
+    template <typename U> friend class ArenaAllocator;
+    NumaArena* arena_;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(NumaArena& arena) noexcept: arena_{&arena} {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept: arena_{other.arena_} {}
+
+    T* allocate(size_t n) {
+        void* p = arena_->allocate(n * sizeof(T), alignof(T));
+        if( p == nullptr ) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    template <typename U>
+    bool operator == (const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena_; }
+    template <typename U>
+    bool operator != (const ArenaAllocator<U>& other) const noexcept { return arena_ != other.arena_; }
+};
+
+
+} // ::tec
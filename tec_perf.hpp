@@ -0,0 +1,488 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_perf.hpp
+ *   @brief Hardware performance counters per message command.
+ *
+ *  PerfStats is a Worker statistics policy (see tec_worker_stats.hpp)
+ *  that reads CPU counters of the worker thread around every process()
+ *  call and sums the deltas by `Message::command`:
+ *
+ *  @code
+ *  using MyWorker = tec::Worker<Params, tec::Message, tec::MilliSec, tec::PerfStats>;
+ *  ...
+ *  tec::println("{}", worker.stats().perf);
+ *  @endcode
+ *
+ *  Counters are opened by the worker thread on the first message,
+ *  user space only. If the kernel refuses (no PMU, `perf_event_paranoid`
+ *  too high, not Linux) the policy still counts messages and
+ *  PerfReport::status tells why there are no counters. Events
+ *  the CPU lacks are skipped individually.
+ *
+*/
+
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_utils.hpp"
+#include "tec/tec_worker_stats.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Perf events
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    L1dMisses,
+    LlcMisses,
+    BranchMisses,
+};
+
+//! Number of PerfEvent values.
+constexpr const size_t kPerfEvents{5};
+
+constexpr const char* perf_event_as_string(PerfEvent e) {
+    switch (e) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::L1dMisses: return "l1d_misses";
+        case PerfEvent::LlcMisses: return "llc_misses";
+        case PerfEvent::BranchMisses: return "branch_misses";
+        default: return "unknown";
+    }
+}
+
+
+//! Counter values, indexed by PerfEvent.
+using PerfValues = std::array<uint64_t, kPerfEvents>;
+
+
+//! How long a group was enabled and actually counting, in ns.
+//! `running` < `enabled` when the kernel multiplexed the counters.
+struct PerfTimes {
+    uint64_t enabled;
+    uint64_t running;
+};
+
+
+/**
+ * @class      PerfCounters
+ * @brief      A group of hardware counters of the calling thread.
+ *
+ * @details    Must be opened, read and closed by the same thread;
+ * the group is read with a single read() call. When there are more
+ * events than hardware counters the kernel time-slices the group:
+ * scale a delta by the enabled/running times (see PerfTimes).
+ */
+class PerfCounters {
+    int leader_;
+    std::array<int, kPerfEvents> fds_;
+    //! Position of every opened event in the group read, -1 if missing.
+    std::array<int, kPerfEvents> slot_;
+    int opened_;
+
+#if defined(__linux__)
+    static void make_attr(PerfEvent e, perf_event_attr& attr) {
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP
+            | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const auto cache = [](uint64_t cache_id) {
+            return cache_id
+                | (uint64_t{PERF_COUNT_HW_CACHE_OP_READ} << 8)
+                | (uint64_t{PERF_COUNT_HW_CACHE_RESULT_MISS} << 16);
+        };
+        switch (e) {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case PerfEvent::LlcMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case PerfEvent::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+    }
+
+    static int open_event(PerfEvent e, int group_fd) {
+        perf_event_attr attr;
+        make_attr(e, attr);
+        attr.disabled = (group_fd == -1) ? 1 : 0;
+        return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+    }
+#endif
+
+public:
+    PerfCounters()
+        : leader_{-1}
+        , opened_{0}
+    {
+        fds_.fill(-1);
+        slot_.fill(-1);
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator = (const PerfCounters&) = delete;
+
+    ~PerfCounters() { close(); }
+
+    //! Is the group open?
+    bool is_open() const { return leader_ >= 0; }
+
+    //! Was `e` opened?
+    bool has(PerfEvent e) const { return slot_[static_cast<size_t>(e)] >= 0; }
+
+    /**
+     * @brief      Opens the counters for the calling thread and enables them.
+     *
+     * @return     Result Kind::System with errno if no event could be opened.
+     */
+    Result open() {
+#if defined(__linux__)
+        if( is_open() ) {
+            return {};
+        }
+        int err{0};
+        for( size_t i = 0; i < kPerfEvents; ++i ) {
+            int fd = open_event(static_cast<PerfEvent>(i), leader_);
+            if( fd < 0 ) {
+                err = errno;
+                continue;
+            }
+            if( leader_ < 0 ) {
+                leader_ = fd;
+            }
+            fds_[i] = fd;
+            slot_[i] = opened_++;
+        }
+        if( !is_open() ) {
+            return {err, format("perf_event_open(): {}", std::strerror(err)), Result::Kind::System};
+        }
+        ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return {};
+#else
+        return {"perf events are not supported on this platform", Result::Kind::System};
+#endif
+    }
+
+    void close() {
+#if defined(__linux__)
+        for( auto& fd: fds_ ) {
+            if( fd >= 0 ) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+#endif
+        leader_ = -1;
+        opened_ = 0;
+        slot_.fill(-1);
+    }
+
+    //! Reads current raw values; missing events read as 0.
+    bool read(PerfValues& values, PerfTimes& times) const {
+        values.fill(0);
+        times = {0, 0};
+#if defined(__linux__)
+        if( !is_open() ) {
+            return false;
+        }
+        // { u64 nr; u64 time_enabled; u64 time_running; u64 values[nr]; }
+        uint64_t buf[3 + kPerfEvents];
+        if( ::read(leader_, buf, sizeof(buf)) < static_cast<ssize_t>(3 * sizeof(uint64_t)) ) {
+            return false;
+        }
+        times = {buf[1], buf[2]};
+        for( size_t i = 0; i < kPerfEvents; ++i ) {
+            if( slot_[i] >= 0 && static_cast<uint64_t>(slot_[i]) < buf[0] ) {
+                values[i] = buf[3 + slot_[i]];
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Per-command report
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Totals for one command.
+struct PerfTotals {
+    //! Messages measured; not counted if the group was never scheduled.
+    uint64_t messages;
+    //! Measured messages whose deltas were scaled up, see PerfTimes.
+    uint64_t multiplexed;
+    PerfValues values;
+};
+
+
+//! Counter totals by command.
+struct PerfReport {
+    //! Why there are no counters, if there are none.
+    Result status;
+    //! Events that were actually counted.
+    std::array<bool, kPerfEvents> counted;
+    std::map<uint64_t, PerfTotals> commands;
+
+    friend std::ostream& operator << (std::ostream& out, const PerfReport& r) {
+        if( !r.status ) {
+            out << "perf counters unavailable: " << r.status << "\n";
+        }
+        out << "command messages multiplexed";
+        for( size_t i = 0; i < kPerfEvents; ++i ) {
+            if( r.counted[i] ) {
+                out << ' ' << perf_event_as_string(static_cast<PerfEvent>(i)) << "/msg";
+            }
+        }
+        if( r.counted[static_cast<size_t>(PerfEvent::Cycles)]
+            && r.counted[static_cast<size_t>(PerfEvent::Instructions)] ) {
+            out << " IPC";
+        }
+        for( const auto& [cmd, t]: r.commands ) {
+            out << '\n' << cmd << ' ' << t.messages << ' ' << t.multiplexed;
+            const double n = t.messages ? static_cast<double>(t.messages) : 1.0;
+            for( size_t i = 0; i < kPerfEvents; ++i ) {
+                if( r.counted[i] ) {
+                    out << ' ' << static_cast<double>(t.values[i]) / n;
+                }
+            }
+            const auto cycles = t.values[static_cast<size_t>(PerfEvent::Cycles)];
+            if( r.counted[static_cast<size_t>(PerfEvent::Cycles)]
+                && r.counted[static_cast<size_t>(PerfEvent::Instructions)] ) {
+                out << ' ' << (cycles
+                               ? static_cast<double>(t.values[static_cast<size_t>(PerfEvent::Instructions)]) / cycles
+                               : 0.0);
+            }
+        }
+        return out;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                      Worker statistics policy
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      BasicPerfStats
+ * @brief      Attributes counter deltas around process() to message commands.
+ *
+ * @details    Stacks on top of another policy, e.g.
+ * `BasicPerfStats<WorkerStats>` records latencies as well.
+ * Totals are also exported as `tec_worker_perf_events_total{worker,command,event}`
+ * and `tec_worker_perf_messages_total{worker,command}`.
+ * Costs two read() syscalls per message when counters are open.
+ * Deltas of a message during which the kernel multiplexed the group
+ * are scaled by enabled/running time; a message during which the
+ * group did not run at all is left out.
+ */
+template <typename TBase = NoStats>
+class BasicPerfStats {
+    using Lock = std::lock_guard<std::mutex>;
+
+    struct Entry {
+        PerfTotals totals;
+        std::shared_ptr<metrics::Counter> m_messages;
+        std::array<std::shared_ptr<metrics::Counter>, kPerfEvents> m_events;
+    };
+
+    TBase base_;
+    std::string name_;
+    //! Touched by the worker thread only.
+    PerfCounters counters_;
+    bool tried_;
+
+    mutable std::mutex mtx_;
+    Result status_;
+    std::array<bool, kPerfEvents> counted_;
+    std::map<uint64_t, Entry> commands_;
+
+    void ensure_open() {
+        if( !tried_ ) {
+            tried_ = true;
+            auto result = counters_.open();
+            Lock lk(mtx_);
+            status_ = result;
+            for( size_t i = 0; i < kPerfEvents; ++i ) {
+                counted_[i] = counters_.has(static_cast<PerfEvent>(i));
+            }
+        }
+    }
+
+    Entry& entry(uint64_t cmd) {
+        auto [it, fresh] = commands_.try_emplace(cmd);
+        Entry& e = it->second;
+        if( fresh ) {
+            e.totals = {0, 0, {}};
+            const auto lbl = metrics::label("worker", name_) + "," + metrics::label("command", std::to_string(cmd));
+            e.m_messages = metrics::registry().instance<metrics::Counter>(
+                "tec_worker_perf_messages_total", "Messages measured with perf counters.", lbl);
+            for( size_t i = 0; i < kPerfEvents; ++i ) {
+                if( counted_[i] ) {
+                    e.m_events[i] = metrics::registry().instance<metrics::Counter>(
+                        "tec_worker_perf_events_total", "Hardware events inside process().",
+                        lbl + "," + metrics::label("event", perf_event_as_string(static_cast<PerfEvent>(i))));
+                }
+            }
+        }
+        return e;
+    }
+
+public:
+    template <typename TMessage>
+    using Envelope = typename TBase::template Envelope<TMessage>;
+
+    struct Mark {
+        typename TBase::Mark base;
+        uint64_t command;
+        PerfValues start;
+        PerfTimes start_times;
+    };
+
+    struct Snapshot {
+        typename TBase::Snapshot base;
+        PerfReport perf;
+    };
+
+    explicit BasicPerfStats(const std::string& name)
+        : base_{name}
+        , name_{name}
+        , tried_{false}
+        , counted_{}
+    {}
+
+    template <typename TMessage>
+    static Envelope<TMessage> wrap(TMessage msg) { return TBase::wrap(std::move(msg)); }
+
+    template <typename TEnvelope>
+    static const auto& message(const TEnvelope& env) { return TBase::message(env); }
+
+    void enqueued(size_t depth) { base_.enqueued(depth); }
+
+    template <typename TEnvelope>
+    Mark dispatched(const TEnvelope& env) {
+        ensure_open();
+        Mark mark{base_.dispatched(env), static_cast<uint64_t>(message(env).command), {}, {}};
+        counters_.read(mark.start, mark.start_times);
+        return mark;
+    }
+
+    void done(const Mark& mark) {
+        PerfValues end;
+        PerfTimes end_times;
+        const bool ok = counters_.read(end, end_times);
+        base_.done(mark.base);
+
+        const uint64_t enabled = end_times.enabled - mark.start_times.enabled;
+        const uint64_t running = end_times.running - mark.start_times.running;
+        if( !ok || running == 0 ) {
+            return;
+        }
+        const bool multiplexed = running < enabled;
+        const double scale = multiplexed ? static_cast<double>(enabled) / static_cast<double>(running) : 1.0;
+
+        Lock lk(mtx_);
+        Entry& e = entry(mark.command);
+        ++e.totals.messages;
+        e.m_messages->inc();
+        if( multiplexed ) {
+            ++e.totals.multiplexed;
+        }
+        for( size_t i = 0; i < kPerfEvents; ++i ) {
+            if( e.m_events[i] ) {
+                uint64_t delta = end[i] - mark.start[i];
+                if( multiplexed ) {
+                    delta = static_cast<uint64_t>(static_cast<double>(delta) * scale);
+                }
+                e.totals.values[i] += delta;
+                e.m_events[i]->inc(delta);
+            }
+        }
+    }
+
+    Snapshot snapshot(size_t depth) const {
+        Snapshot snap{base_.snapshot(depth), {}};
+        Lock lk(mtx_);
+        snap.perf.status = status_;
+        snap.perf.counted = counted_;
+        for( const auto& [cmd, e]: commands_ ) {
+            snap.perf.commands[cmd] = e.totals;
+        }
+        return snap;
+    }
+};
+
+using PerfStats = BasicPerfStats<>;
+
+
+} // ::tec
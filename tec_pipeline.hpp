@@ -0,0 +1,635 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_pipeline.hpp
+ *   @brief Staged dataflow over bounded queues.
+ *
+ *  A Pipeline chains stages, each run by one thread or a pool of N.
+ *  Every stage reads from its own BoundedQueue, so a slow stage blocks
+ *  the stage before it instead of letting queues grow (backpressure).
+ *
+ *  @code
+ *  auto pipeline = tec::Pipeline<std::string>::build(tec::PipelineParams{})
+ *      .stage("parse", [](std::string line) { return parse(line); })
+ *      .stage("enrich", enrich_params, [](Record r) -> std::optional<Record> { ... })
+ *      .sink("write", [&out](Record r) { out << r; });
+ *
+ *  pipeline->run();
+ *  while( std::getline(in, line) ) {
+ *      pipeline->push(line);
+ *  }
+ *  pipeline->terminate(); // drains every stage
+ *  tec::println("{}", pipeline->stats());
+ *  @endcode
+ *
+ *  A stage function returning std::optional drops the items for which
+ *  it returns std::nullopt.
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_queue.hpp"
+#include "tec/tec_trace.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Parameters
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! NOTE: thread attributes (cpus, sched_policy, ...) apply to every stage thread.
+struct PipelineParams: public WorkerParams {
+    //! Default capacity of the queue in front of each stage.
+    static constexpr const size_t kCapacity{1024};
+
+    size_t capacity;
+
+    PipelineParams()
+        : capacity{kCapacity}
+    {
+        name = "pipeline";
+    }
+};
+
+
+struct StageParams {
+    static constexpr const size_t kWorkers{1};
+
+    //! Threads running the stage.
+    size_t workers;
+    //! Emit in input order, see Pipeline. At most `capacity` results
+    //! wait for reordering; workers that run ahead block.
+    bool ordered;
+    //! Input queue capacity, 0 for PipelineParams::capacity.
+    size_t capacity;
+
+    StageParams()
+        : workers{kWorkers}
+        , ordered{false}
+        , capacity{0}
+    {}
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Statistics
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct StageStats {
+    std::string name;
+    size_t workers;
+    uint64_t processed;  //!< Items taken from the input queue.
+    uint64_t emitted;    //!< Items passed on, fewer if the stage filters.
+    uint64_t stall_ns;   //!< Blocked on a full output queue or the reorder window, all workers.
+    uint64_t idle_ns;    //!< Blocked on an empty input queue, all workers.
+    size_t depth;        //!< Items in the input queue.
+    size_t capacity;     //!< Input queue capacity.
+};
+
+
+struct PipelineStats {
+    uint64_t elapsed_ns;  //!< Since run().
+    std::vector<StageStats> stages;
+
+    //! Items per second processed by a stage.
+    double throughput(const StageStats& stage) const {
+        return elapsed_ns ? static_cast<double>(stage.processed) * 1e9 / static_cast<double>(elapsed_ns) : 0.0;
+    }
+
+    //! One line per stage.
+    friend std::ostream& operator << (std::ostream& out, const PipelineStats& stats) {
+        out << std::left << std::setw(16) << "stage" << std::right
+            << std::setw(4) << "N"
+            << std::setw(12) << "processed"
+            << std::setw(12) << "emitted"
+            << std::setw(12) << "items/s"
+            << std::setw(12) << "stall ms"
+            << std::setw(12) << "idle ms"
+            << std::setw(12) << "queue" << "\n";
+        for( const auto& s: stats.stages ) {
+            out << std::left << std::setw(16) << s.name << std::right
+                << std::setw(4) << s.workers
+                << std::setw(12) << s.processed
+                << std::setw(12) << s.emitted
+                << std::setw(12) << static_cast<uint64_t>(stats.throughput(s))
+                << std::setw(12) << s.stall_ns / 1000000
+                << std::setw(12) << s.idle_ns / 1000000
+                << std::setw(12) << format("{}/{}", s.depth, s.capacity) << "\n";
+        }
+        return out;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                             Stage
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+//! An item numbered by the stage before, see Stage::emit().
+template <typename T>
+struct Item {
+    uint64_t seq;
+    T value;
+};
+
+template <typename T>
+struct unwrap_optional {
+    using type = T;
+    static constexpr bool filters{false};
+};
+
+template <typename T>
+struct unwrap_optional<std::optional<T>> {
+    using type = T;
+    static constexpr bool filters{true};
+};
+
+
+class StageBase {
+public:
+    virtual ~StageBase() = default;
+
+    virtual void start(const PipelineParams& params) = 0;
+    //! Waits for all workers to drain the input queue and exit.
+    virtual void join() = 0;
+    virtual StageStats stats() const = 0;
+};
+
+
+//! Where a stage producing T pushes to.
+template <typename T>
+struct StageOutput {
+    BoundedQueue<Item<T>>* out{nullptr};
+};
+
+template <>
+struct StageOutput<void> {};
+
+
+/**
+ * @class      Stage
+ * @brief      Runs `fn` on every input item in `workers` threads.
+ *
+ * @details    Output items are numbered 0, 1, ... in the order they
+ * are passed on. An ordered stage reorders its results by input
+ * number in a resequencer first; filtered items just advance it.
+ * The resequencer window is the input capacity: a worker with an item
+ * that far ahead waits, unless all the others wait already (the item
+ * they need may still be queued behind it).
+ * A sink has `Out` = void.
+ */
+template <typename In, typename Out, typename Fn>
+class Stage: public StageBase, public StageOutput<Out> {
+    static constexpr bool kSink{std::is_void_v<Out>};
+
+    //! What the resequencer holds: results, or inputs of a sink.
+    using Held = std::conditional_t<kSink, In, Out>;
+
+    std::string name_;
+    StageParams params_;
+    Fn fn_;
+    BoundedQueue<Item<In>> in_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> running_;
+    std::atomic<uint64_t> out_seq_;
+
+    //! Resequencer.
+    std::mutex mtx_order_;
+    std::condition_variable cv_order_;
+    std::map<uint64_t, std::optional<Held>> pending_;
+    uint64_t next_seq_;
+    //! Workers waiting for the window, see wait_window().
+    size_t window_waiters_;
+
+    std::shared_ptr<metrics::Counter> m_processed_;
+    std::shared_ptr<metrics::Counter> m_emitted_;
+    std::shared_ptr<metrics::Counter> m_stall_ns_;
+    std::shared_ptr<metrics::Counter> m_idle_ns_;
+
+    //! Passes a result on, or consumes it in a sink.
+    void emit(Held&& value, uint64_t& stall_ns) {
+        if constexpr ( kSink ) {
+            fn_(std::move(value));
+        }
+        else {
+            this->out->push({out_seq_.fetch_add(1, std::memory_order_relaxed), std::move(value)}, stall_ns);
+        }
+        m_emitted_->inc();
+    }
+
+    //! Blocks while `seq` is a window ahead of the resequencer.
+    void wait_window(uint64_t seq, uint64_t& stall_ns) {
+        std::unique_lock<std::mutex> lk(mtx_order_);
+        if( seq < next_seq_ + in_.capacity() ) {
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        // One worker keeps popping: it may hold the item next_seq_ needs.
+        while( seq >= next_seq_ + in_.capacity() && window_waiters_ + 1 < params_.workers ) {
+            ++window_waiters_;
+            cv_order_.wait(lk);
+            --window_waiters_;
+        }
+        stall_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    void emit_ordered(uint64_t seq, std::optional<Held>&& value, uint64_t& stall_ns) {
+        std::lock_guard<std::mutex> lk(mtx_order_);
+        pending_.emplace(seq, std::move(value));
+        const uint64_t first = next_seq_;
+        while( !pending_.empty() && pending_.begin()->first == next_seq_ ) {
+            auto node = pending_.extract(pending_.begin());
+            ++next_seq_;
+            if( node.mapped() ) {
+                // Blocking here holds the other workers back as well.
+                emit(std::move(*node.mapped()), stall_ns);
+            }
+        }
+        if( next_seq_ != first && window_waiters_ > 0 ) {
+            cv_order_.notify_all();
+        }
+    }
+
+    void process(Item<In>&& item, uint64_t& stall_ns) {
+        if( params_.ordered && params_.workers > 1 ) {
+            wait_window(item.seq, stall_ns);
+        }
+        std::optional<Held> result;
+        if constexpr ( kSink ) {
+            if( !params_.ordered ) {
+                fn_(std::move(item.value));
+                m_emitted_->inc();
+                return;
+            }
+            result.emplace(std::move(item.value));
+        }
+        else if constexpr ( unwrap_optional<std::invoke_result_t<Fn&, In&&>>::filters ) {
+            result = fn_(std::move(item.value));
+        }
+        else {
+            result.emplace(fn_(std::move(item.value)));
+        }
+
+        if( params_.ordered ) {
+            emit_ordered(item.seq, std::move(result), stall_ns);
+        }
+        else if( result ) {
+            emit(std::move(*result), stall_ns);
+        }
+    }
+
+    void work() {
+        Item<In> item;
+        uint64_t idle_ns{0};
+        uint64_t stall_ns{0};
+        while( in_.pop(item, idle_ns) ) {
+            m_processed_->inc();
+            process(std::move(item), stall_ns);
+            if( idle_ns ) {
+                m_idle_ns_->inc(std::exchange(idle_ns, 0));
+            }
+            if( stall_ns ) {
+                m_stall_ns_->inc(std::exchange(stall_ns, 0));
+            }
+        }
+        if( idle_ns ) {
+            m_idle_ns_->inc(idle_ns);
+        }
+        // The last worker out ends the stream for the next stage.
+        if( running_.fetch_sub(1) == 1 ) {
+            if constexpr ( !kSink ) {
+                this->out->close();
+            }
+        }
+    }
+
+public:
+    Stage(const std::string& pipeline, const std::string& name, const StageParams& params,
+          size_t capacity, Fn&& fn)
+        : name_{name}
+        , params_{params}
+        , fn_{std::move(fn)}
+        , in_{params.capacity ? params.capacity : capacity}
+        , running_{0}
+        , out_seq_{0}
+        , next_seq_{0}
+        , window_waiters_{0}
+        , m_processed_{metrics::registry().instance<metrics::Counter>(
+                "tec_pipeline_processed_total", "Items taken by a pipeline stage.",
+                metrics::label("pipeline", pipeline) + "," + metrics::label("stage", name))}
+        , m_emitted_{metrics::registry().instance<metrics::Counter>(
+                "tec_pipeline_emitted_total", "Items passed on by a pipeline stage.",
+                metrics::label("pipeline", pipeline) + "," + metrics::label("stage", name))}
+        , m_stall_ns_{metrics::registry().instance<metrics::Counter>(
+                "tec_pipeline_stall_ns_total", "Time blocked on a full output queue or the reorder window.",
+                metrics::label("pipeline", pipeline) + "," + metrics::label("stage", name))}
+        , m_idle_ns_{metrics::registry().instance<metrics::Counter>(
+                "tec_pipeline_idle_ns_total", "Time blocked on an empty input queue.",
+                metrics::label("pipeline", pipeline) + "," + metrics::label("stage", name))}
+    {
+        if( params_.workers == 0 ) {
+            params_.workers = 1;
+        }
+    }
+
+    BoundedQueue<Item<In>>& input() { return in_; }
+
+    void start(const PipelineParams& params) override {
+        PipelineParams thread_params{params};
+        if( thread_params.thread_name.empty() ) {
+            thread_params.thread_name = name_;
+        }
+        running_ = params_.workers;
+        for( size_t i = 0; i < params_.workers; ++i ) {
+            threads_.emplace_back([this, thread_params] {
+                TEC_ENTER("Pipeline::stage");
+                // Attributes are best effort: the stage runs anyway.
+                [[maybe_unused]] auto result = details::apply_thread_params(thread_params);
+                TEC_TRACE("stage thread attributes: {}.", result);
+                work();
+            });
+        }
+    }
+
+    void join() override {
+        for( auto& t: threads_ ) {
+            t.join();
+        }
+        threads_.clear();
+    }
+
+    StageStats stats() const override {
+        return {name_, params_.workers,
+                m_processed_->value(), m_emitted_->value(),
+                m_stall_ns_->value(), m_idle_ns_->value(),
+                in_.size(), in_.capacity()};
+    }
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Pipeline
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+template <typename Source, typename Current>
+class PipelineBuilder;
+
+
+/**
+ * @class      Pipeline
+ * @brief      Stages connected by bounded queues, fed by push().
+ *
+ * @details    Built with Pipeline::build(), see PipelineBuilder.
+ * An unordered stage with several workers emits items as they are
+ * done; set StageParams::ordered to keep the order of its input.
+ * Order is kept end to end if every stage with more than one worker
+ * is ordered.
+ */
+template <typename Source>
+class Pipeline: public Daemon {
+    PipelineParams params_;
+    std::vector<std::unique_ptr<details::StageBase>> stages_;
+    BoundedQueue<details::Item<Source>>* head_;
+    std::atomic<uint64_t> seq_;
+    //! Set once by run() before `flag_running_` is published.
+    std::chrono::steady_clock::time_point started_;
+
+    //! Written under `mtx_`; atomic for stats(), which doesn't lock.
+    std::atomic<bool> flag_running_;
+    bool flag_terminated_;
+    std::mutex mtx_;
+
+    template <typename S, typename C>
+    friend class PipelineBuilder;
+
+    Pipeline(const PipelineParams& params,
+             std::vector<std::unique_ptr<details::StageBase>>&& stages,
+             BoundedQueue<details::Item<Source>>* head)
+        : params_{params}
+        , stages_{std::move(stages)}
+        , head_{head}
+        , seq_{0}
+        , flag_running_{false}
+        , flag_terminated_{false}
+    {}
+
+public:
+    Pipeline(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = delete;
+
+    virtual ~Pipeline() {
+        terminate();
+    }
+
+    //! Starts building a pipeline fed with Source items.
+    static PipelineBuilder<Source, Source> build(const PipelineParams& params) {
+        return PipelineBuilder<Source, Source>{params};
+    }
+
+    const PipelineParams& params() const { return params_; }
+
+    //! Starts all stage threads.
+    Result run() override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        TEC_ENTER("Pipeline::run");
+        if( flag_terminated_ ) {
+            return {"pipeline terminated", Result::Kind::RuntimeErr};
+        }
+        if( flag_running_.load(std::memory_order_relaxed) ) {
+            return {};
+        }
+        started_ = std::chrono::steady_clock::now();
+        for( auto& stage: stages_ ) {
+            stage->start(params_);
+        }
+        flag_running_.store(true, std::memory_order_release);
+        return {};
+    }
+
+    /**
+     * @brief      Feeds an item, waiting while the first stage is full.
+     * @details    Before run(), blocks once the first queue is full.
+     * @return     false after terminate().
+     */
+    bool push(Source value) {
+        return head_->push({seq_.fetch_add(1, std::memory_order_relaxed), std::move(value)});
+    }
+
+    //! Ends the input and waits until every stage has drained.
+    Result terminate() override {
+        std::lock_guard<std::mutex> lk(mtx_);
+        TEC_ENTER("Pipeline::terminate");
+        if( flag_terminated_ ) {
+            return {};
+        }
+        flag_terminated_ = true;
+        head_->close();
+        if( flag_running_.load(std::memory_order_relaxed) ) {
+            for( auto& stage: stages_ ) {
+                stage->join();
+            }
+        }
+        TEC_TRACE("pipeline drained.");
+        return {};
+    }
+
+    //! Safe from any thread, never waits for terminate().
+    PipelineStats stats() const {
+        PipelineStats stats{0, {}};
+        if( flag_running_.load(std::memory_order_acquire) ) {
+            stats.elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - started_).count());
+        }
+        for( const auto& stage: stages_ ) {
+            stats.stages.push_back(stage->stats());
+        }
+        return stats;
+    }
+};
+
+
+/**
+ * @class      PipelineBuilder
+ * @brief      Adds stages to a pipeline whose last stage yields Current.
+ *
+ * @details    Every stage() returns the builder for the next item type;
+ * sink() ends the chain and returns the Pipeline.
+ */
+template <typename Source, typename Current>
+class PipelineBuilder {
+    PipelineParams params_;
+    std::vector<std::unique_ptr<details::StageBase>> stages_;
+    BoundedQueue<details::Item<Source>>* head_;
+    details::StageOutput<Current>* tail_;
+
+    template <typename S, typename C>
+    friend class PipelineBuilder;
+
+    friend class Pipeline<Source>;
+
+    explicit PipelineBuilder(const PipelineParams& params)
+        : params_{params}
+        , head_{nullptr}
+        , tail_{nullptr}
+    {}
+
+    PipelineBuilder(const PipelineParams& params,
+                    std::vector<std::unique_ptr<details::StageBase>>&& stages,
+                    BoundedQueue<details::Item<Source>>* head,
+                    details::StageOutput<Current>* tail)
+        : params_{params}
+        , stages_{std::move(stages)}
+        , head_{head}
+        , tail_{tail}
+    {}
+
+    template <typename TStage>
+    void connect(TStage& stage) {
+        if( tail_ ) {
+            tail_->out = &stage.input();
+        }
+        else if constexpr ( std::is_same_v<Source, Current> ) {
+            head_ = &stage.input();
+        }
+    }
+
+public:
+    //! Adds a stage running `fn(Current)` in one thread.
+    template <typename Fn>
+    auto stage(const std::string& name, Fn fn) && {
+        return std::move(*this).stage(name, StageParams{}, std::move(fn));
+    }
+
+    //! Adds a stage running `fn(Current)`, returning Next or std::optional<Next>.
+    template <typename Fn>
+    auto stage(const std::string& name, const StageParams& params, Fn fn) && {
+        using R = std::invoke_result_t<Fn&, Current&&>;
+        using Next = typename details::unwrap_optional<R>::type;
+        static_assert(!std::is_void_v<R>, "use sink() for a stage returning void");
+
+        auto stage = std::make_unique<details::Stage<Current, Next, Fn>>(
+            params_.name, name, params, params_.capacity, std::move(fn));
+        connect(*stage);
+        details::StageOutput<Next>* tail = stage.get();
+        stages_.push_back(std::move(stage));
+        return PipelineBuilder<Source, Next>{params_, std::move(stages_), head_, tail};
+    }
+
+    //! Ends the pipeline with `fn(Current)` in one thread.
+    template <typename Fn>
+    std::unique_ptr<Pipeline<Source>> sink(const std::string& name, Fn fn) && {
+        return std::move(*this).sink(name, StageParams{}, std::move(fn));
+    }
+
+    //! Ends the pipeline. An ordered sink calls `fn` in input order,
+    //! one item at a time.
+    template <typename Fn>
+    std::unique_ptr<Pipeline<Source>> sink(const std::string& name, const StageParams& params, Fn fn) && {
+        auto stage = std::make_unique<details::Stage<Current, void, Fn>>(
+            params_.name, name, params, params_.capacity, std::move(fn));
+        connect(*stage);
+        stages_.push_back(std::move(stage));
+        return std::unique_ptr<Pipeline<Source>>(
+            new Pipeline<Source>(params_, std::move(stages_), head_));
+    }
+};
+
+
+} // ::tec
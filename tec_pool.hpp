@@ -0,0 +1,463 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_pool.hpp
+ *   @brief Per-thread slab pools for message payloads.
+ *
+ *  A payload allocated by one Worker and released by another costs a
+ *  malloc() on one thread and a free() on the other. A SlabPool is
+ *  owned by the allocating thread: it allocates and frees without
+ *  atomics, while blocks released on other threads are pushed to a
+ *  lock-free remote list that the owner takes back in one exchange
+ *  when its own free list runs dry.
+ *
+ *  PoolPtr<T> is a ref-counted handle to a pooled object, copyable
+ *  into a message:
+ *
+ *  @code
+ *  struct Msg {
+ *      tec::Message::cmd_t command;
+ *      tec::PoolPtr<Order> order;
+ *      bool quit() const { return command == tec::Message::QUIT; }
+ *  };
+ *  // On the producing thread, from its own pool:
+ *  matcher.send({CMD_ORDER, tec::make_pooled<Order>(id, price)});
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                            Slab pool
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct SlabPoolParams {
+    static constexpr size_t kDefaultBlockSize{256};
+    static constexpr size_t kDefaultBlocksPerSlab{256};
+
+    //! Bytes per block including a 16-byte header, rounded up to 16.
+    size_t block_size;
+    //! Blocks carved from one allocation.
+    size_t blocks_per_slab;
+    //! Labels the metrics.
+    std::string name;
+
+    SlabPoolParams()
+        : block_size{kDefaultBlockSize}
+        , blocks_per_slab{kDefaultBlocksPerSlab}
+        , name{"pool"}
+    {}
+};
+
+
+//! SlabPool counters, taken on the owner thread.
+struct SlabPoolStats {
+    uint64_t allocations;    //!< Blocks handed out.
+    uint64_t local_frees;    //!< Blocks released by the owner thread.
+    uint64_t remote_batches; //!< Remote lists taken back.
+    uint64_t slabs;          //!< Slabs allocated.
+    uint64_t blocks;         //!< Blocks in all slabs.
+};
+
+
+class SlabPool;
+
+namespace details {
+
+//! Precedes every block; `next` is valid while the block is free,
+//! `refs` while a PoolPtr holds it.
+struct PoolHeader {
+    SlabPool* pool;
+    union {
+        PoolHeader* next;
+        std::atomic<uint32_t> refs;
+    };
+};
+
+static_assert(sizeof(PoolHeader) == 16, "payloads must stay 16-byte aligned");
+
+} // ::details
+
+
+/**
+ * @class      SlabPool
+ * @brief      Fixed-size blocks owned by one thread, released by any.
+ *
+ * @details    The owner is the first thread that allocates. A pool is
+ * released by its owner, see release(); if blocks are still out, it
+ * is kept aside and freed by a later sweep once they all come back.
+ * Exports `tec_pool_allocations_total`, `tec_pool_remote_batches_total`
+ * and `tec_pool_slabs`, labelled `pool`, updated in batches.
+ */
+class SlabPool {
+public:
+    using Header = details::PoolHeader;
+
+private:
+    const size_t block_size_;
+    const size_t blocks_per_slab_;
+
+    //! Set by the first allocate(), cleared by release().
+    std::atomic<std::thread::id> owner_;
+    //! Owner thread only.
+    Header* local_;
+    std::vector<void*> slabs_;
+    SlabPoolStats stats_;
+    uint64_t published_allocs_;
+
+    //! Blocks released by other threads.
+    alignas(64) std::atomic<Header*> remote_;
+
+    std::shared_ptr<metrics::Counter> m_allocations_;
+    std::shared_ptr<metrics::Counter> m_remote_batches_;
+    std::shared_ptr<metrics::Gauge> m_slabs_;
+
+    explicit SlabPool(const SlabPoolParams& params)
+        : block_size_{params.block_size < 32 ? 32 : (params.block_size + 15) & ~size_t{15}}
+        , blocks_per_slab_{params.blocks_per_slab > 0 ? params.blocks_per_slab : 1}
+        , owner_{std::thread::id{}}
+        , local_{nullptr}
+        , stats_{}
+        , published_allocs_{0}
+        , remote_{nullptr}
+        , m_allocations_{metrics::registry().counter(
+                "tec_pool_allocations_total", "Blocks allocated from slab pools.",
+                metrics::label("pool", params.name))}
+        , m_remote_batches_{metrics::registry().counter(
+                "tec_pool_remote_batches_total", "Remote free lists taken back by the owner.",
+                metrics::label("pool", params.name))}
+        , m_slabs_{metrics::registry().gauge(
+                "tec_pool_slabs", "Slabs allocated by slab pools.",
+                metrics::label("pool", params.name))}
+    {}
+
+    ~SlabPool() {
+        m_slabs_->sub(static_cast<int64_t>(slabs_.size()));
+        for( void* slab: slabs_ ) {
+            std::free(slab);
+        }
+    }
+
+    //! Released pools with blocks still out.
+    struct Graveyard {
+        std::mutex mtx;
+        std::vector<SlabPool*> pools;
+    };
+
+    static Graveyard& graveyard() {
+        static Graveyard g;
+        return g;
+    }
+
+    void publish() {
+        m_allocations_->inc(stats_.allocations - published_allocs_);
+        published_allocs_ = stats_.allocations;
+    }
+
+    bool grow() {
+        // aligned_alloc() requires a size that is a multiple of the alignment.
+        const size_t bytes_per_slab = (block_size_ * blocks_per_slab_ + 63) & ~size_t{63};
+        void* slab = std::aligned_alloc(64, bytes_per_slab);
+        if( !slab ) {
+            return false;
+        }
+        slabs_.push_back(slab);
+        auto* bytes = static_cast<unsigned char*>(slab);
+        for( size_t i = blocks_per_slab_; i > 0; --i ) {
+            auto* h = reinterpret_cast<Header*>(bytes + (i - 1) * block_size_);
+            h->pool = this;
+            h->next = local_;
+            local_ = h;
+        }
+        ++stats_.slabs;
+        stats_.blocks += blocks_per_slab_;
+        m_slabs_->add();
+        publish();
+        return true;
+    }
+
+    bool take_remote() {
+        Header* list = remote_.exchange(nullptr, std::memory_order_acquire);
+        if( !list ) {
+            return false;
+        }
+        local_ = list;
+        ++stats_.remote_batches;
+        m_remote_batches_->inc();
+        publish();
+        return true;
+    }
+
+    //! True if every block is back, the caller owns the pool.
+    bool all_back() {
+        if( Header* list = remote_.exchange(nullptr, std::memory_order_acquire) ) {
+            Header* tail = list;
+            while( tail->next ) {
+                tail = tail->next;
+            }
+            tail->next = local_;
+            local_ = list;
+        }
+        uint64_t free_blocks{0};
+        for( Header* h = local_; h; h = h->next ) {
+            ++free_blocks;
+        }
+        return free_blocks == stats_.blocks;
+    }
+
+public:
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    //! Creates a pool, release() it when done.
+    static SlabPool* create(const SlabPoolParams& params = {}) {
+        sweep();
+        return new SlabPool(params);
+    }
+
+    /**
+     * @brief      Gives the pool up, on the owner thread.
+     *
+     * @details    The pool is freed now if all blocks are back,
+     * otherwise by the first sweep() after the last one returns.
+     */
+    void release() {
+        publish();
+        // From now on every thread frees remotely.
+        owner_.store(std::thread::id{}, std::memory_order_relaxed);
+        if( all_back() ) {
+            delete this;
+            return;
+        }
+        auto& g = graveyard();
+        std::lock_guard<std::mutex> lk(g.mtx);
+        g.pools.push_back(this);
+    }
+
+    //! Frees released pools whose blocks have all come back.
+    //! Also called by create().
+    static void sweep() {
+        auto& g = graveyard();
+        std::lock_guard<std::mutex> lk(g.mtx);
+        for( size_t i = 0; i < g.pools.size(); ) {
+            if( g.pools[i]->all_back() ) {
+                delete g.pools[i];
+                g.pools[i] = g.pools.back();
+                g.pools.pop_back();
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+
+    //! Payload bytes per block.
+    size_t capacity() const { return block_size_ - sizeof(Header); }
+
+    //! A block of capacity() bytes, nullptr if out of memory. Owner thread only.
+    void* allocate() {
+        if( owner_.load(std::memory_order_relaxed) == std::thread::id{} ) {
+            owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        }
+        if( !local_ && !take_remote() && !grow() ) {
+            return nullptr;
+        }
+        Header* h = local_;
+        local_ = h->next;
+        ++stats_.allocations;
+        return h + 1;
+    }
+
+    //! Returns a block to its pool, from any thread.
+    static void deallocate(void* p) {
+        Header* h = static_cast<Header*>(p) - 1;
+        SlabPool* pool = h->pool;
+        if( pool->owner_.load(std::memory_order_relaxed) == std::this_thread::get_id() ) {
+            h->next = pool->local_;
+            pool->local_ = h;
+            ++pool->stats_.local_frees;
+            return;
+        }
+        // The successful push is the last access to the pool.
+        Header* head = pool->remote_.load(std::memory_order_relaxed);
+        do {
+            h->next = head;
+        } while( !pool->remote_.compare_exchange_weak(
+                     head, h, std::memory_order_release, std::memory_order_relaxed) );
+    }
+
+    //! Owner thread only.
+    SlabPoolStats stats() const { return stats_; }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Pooled objects
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      PoolPtr
+ * @brief      Shared handle to an object in a SlabPool.
+ *
+ * @details    Copies share the object; the last one destroys it and
+ * returns the block to its pool, on whatever thread that happens.
+ */
+template <typename T>
+class PoolPtr {
+    T* p_;
+
+    static details::PoolHeader* header(const T* p) {
+        return reinterpret_cast<details::PoolHeader*>(const_cast<std::remove_const_t<T>*>(p)) - 1;
+    }
+
+    template <typename U, typename... Args>
+    friend PoolPtr<U> make_pooled(SlabPool& pool, Args&&... args);
+
+    explicit PoolPtr(T* p): p_{p} {}
+
+public:
+    PoolPtr(): p_{nullptr} {}
+    PoolPtr(std::nullptr_t): p_{nullptr} {}
+
+    PoolPtr(const PoolPtr& other): p_{other.p_} {
+        if( p_ ) {
+            header(p_)->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PoolPtr(PoolPtr&& other) noexcept: p_{other.p_} {
+        other.p_ = nullptr;
+    }
+
+    PoolPtr& operator=(PoolPtr other) noexcept {
+        std::swap(p_, other.p_);
+        return *this;
+    }
+
+    ~PoolPtr() { reset(); }
+
+    void reset() {
+        if( p_ && header(p_)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+            p_->~T();
+            SlabPool::deallocate(const_cast<std::remove_const_t<T>*>(p_));
+        }
+        p_ = nullptr;
+    }
+
+    T* get() const { return p_; }
+    T& operator*() const { return *p_; }
+    T* operator->() const { return p_; }
+    explicit operator bool() const { return p_ != nullptr; }
+};
+
+
+//! Constructs a T in `pool`, on the pool's owner thread.
+//! Returns an empty PoolPtr if out of memory.
+template <typename T, typename... Args>
+PoolPtr<T> make_pooled(SlabPool& pool, Args&&... args) {
+    static_assert(alignof(T) <= 16, "over-aligned types are not pooled");
+    if( sizeof(T) > pool.capacity() ) {
+        return {};
+    }
+    void* p = pool.allocate();
+    if( !p ) {
+        return {};
+    }
+    new (&(static_cast<details::PoolHeader*>(p) - 1)->refs) std::atomic<uint32_t>(1);
+    return PoolPtr<T>(new (p) T(std::forward<Args>(args)...));
+}
+
+
+namespace details {
+
+//! Thread-local pool released at thread exit.
+template <size_t BlockSize>
+struct LocalPool {
+    SlabPool* pool;
+
+    LocalPool() {
+        SlabPoolParams params;
+        params.block_size = BlockSize;
+        params.name = format("local{}", BlockSize);
+        pool = SlabPool::create(params);
+    }
+
+    ~LocalPool() { pool->release(); }
+};
+
+constexpr size_t pool_size_class(size_t bytes) {
+    size_t size{64};
+    while( size < bytes ) {
+        size *= 2;
+    }
+    return size;
+}
+
+} // ::details
+
+
+//! The calling thread's pool of `BlockSize`-byte blocks.
+template <size_t BlockSize>
+SlabPool& local_pool() {
+    thread_local details::LocalPool<BlockSize> local;
+    return *local.pool;
+}
+
+
+//! Constructs a T in the calling thread's pool of its size class (64 .. 4096 bytes).
+template <typename T, typename... Args>
+PoolPtr<T> make_pooled(Args&&... args) {
+    constexpr size_t size = details::pool_size_class(sizeof(details::PoolHeader) + sizeof(T));
+    static_assert(size <= 4096, "use make_pooled(pool, ...) with a pool of large blocks");
+    return make_pooled<T>(local_pool<size>(), std::forward<Args>(args)...);
+}
+
+
+} // ::tec
@@ -0,0 +1,455 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_prometheus.hpp
+ *   @brief Prometheus text exposition endpoint.
+ *
+ *  A tiny HTTP/1.1 server serving the metrics registry (see tec_metrics.hpp)
+ *  at `GET /metrics`. Host it in a ServerWorker:
+ *
+ *  @code
+ *  tec::PrometheusParams params;
+ *  params.port = 9464;
+ *  tec::ServerWorker<tec::PrometheusParams, tec::PrometheusServer> exporter(
+ *      params, std::make_unique<tec::PrometheusServer>(params));
+ *  exporter.run();
+ *  @endcode
+ *
+ *  The text is rendered every `refresh_interval` into a back buffer
+ *  which is then published, so a scrape only copies a ready snapshot
+ *  and never touches the metrics.
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_server.hpp"
+#include "tec/tec_trace.hpp"
+#include "tec/tec_utils.hpp"
+
+#if !defined(__TEC_WINDOWS__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+namespace tec {
+
+namespace metrics {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                  Prometheus text format (0.0.4)
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+inline void write_series(std::ostream& out, const std::string& name, const char* suffix,
+                         const std::string& labels, const std::string& extra) {
+    out << name << suffix;
+    if( !labels.empty() || !extra.empty() ) {
+        out << '{' << labels;
+        if( !labels.empty() && !extra.empty() ) {
+            out << ',';
+        }
+        out << extra << '}';
+    }
+    out << ' ';
+}
+
+} // ::details
+
+
+/**
+ * @brief      Renders all metrics of the registry in Prometheus text format.
+ *
+ * @details    Histograms are exported with `le` buckets at every other
+ * power of two, from 64 ns to 2^36 ns (~69 s), plus `+Inf`,
+ * `_sum` and `_count`.
+ */
+inline void render_prometheus(Registry& reg, std::ostream& out) {
+    // Group by family: HELP and TYPE must be emitted once per name.
+    std::map<std::string, std::ostringstream> families;
+    reg.for_each([&](const Metric& m) {
+        const std::string& name = m.name();
+        auto [it, fresh] = families.try_emplace(name);
+        std::ostringstream& fam = it->second;
+        if( fresh ) {
+            fam << "# HELP " << name << ' ' << m.help() << '\n';
+            fam << "# TYPE " << name << ' ' << type_as_string(m.type()) << '\n';
+        }
+        if( const auto* probe = dynamic_cast<const Probe*>(&m) ) {
+            details::write_series(fam, name, "", m.labels(), {});
+            fam << probe->value() << '\n';
+            return;
+        }
+        switch (m.type()) {
+        case Type::Counter:
+            details::write_series(fam, name, "", m.labels(), {});
+            fam << static_cast<const Counter&>(m).value() << '\n';
+            break;
+        case Type::Gauge:
+            details::write_series(fam, name, "", m.labels(), {});
+            fam << static_cast<const Gauge&>(m).value() << '\n';
+            break;
+        case Type::Histogram: {
+            const auto hist = static_cast<const Histogram&>(m).snapshot();
+            const auto& buckets = hist.buckets();
+            uint64_t cumulative{0};
+            size_t idx{0};
+            // `le` means "less or equal": bounds fall on bucket edges, 2^bits - 1.
+            for( unsigned bits = 6; bits <= 36; bits += 2 ) {
+                const uint64_t le = (uint64_t{1} << bits) - 1;
+                for( ; idx < buckets.size() && tec::details::log_linear::upper(idx) <= le; ++idx ) {
+                    cumulative += buckets[idx];
+                }
+                details::write_series(fam, name, "_bucket", m.labels(), label("le", std::to_string(le)));
+                fam << cumulative << '\n';
+            }
+            details::write_series(fam, name, "_bucket", m.labels(), "le=\"+Inf\"");
+            fam << hist.count() << '\n';
+            details::write_series(fam, name, "_sum", m.labels(), {});
+            fam << hist.sum() << '\n';
+            details::write_series(fam, name, "_count", m.labels(), {});
+            fam << hist.count() << '\n';
+            break;
+        }
+        }
+    });
+    for( const auto& fam: families ) {
+        out << fam.second.str();
+    }
+}
+
+} // ::metrics
+
+
+#if !defined(__TEC_WINDOWS__)
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                     Prometheus exporter
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct PrometheusParams: public ServerParams {
+    //! Default address: local connections only.
+    static constexpr const char kAddr[] = "127.0.0.1";
+    //! Default port, as registered for Prometheus exporters.
+    static constexpr const int kPort{9464};
+    //! Default snapshot refresh interval.
+    static constexpr const MilliSec kRefreshInterval{1000};
+    //! Default deadline for a client request.
+    static constexpr const MilliSec kIoTimeout{1000};
+
+    std::string addr;            //!< IPv4 address to bind to.
+    int port;                    //!< TCP port, 0 to pick a free one (see PrometheusServer::port()).
+    MilliSec refresh_interval;   //!< How often the snapshot is re-rendered.
+    MilliSec io_timeout;         //!< Deadline for a whole request, read to last byte sent.
+
+    PrometheusParams()
+        : addr(kAddr)
+        , port(kPort)
+        , refresh_interval(kRefreshInterval)
+        , io_timeout(kIoTimeout)
+    {
+        name = "prometheus";
+    }
+};
+
+
+/**
+ * @class      PrometheusServer
+ * @brief      Serves `GET /metrics` from a pre-rendered snapshot.
+ *
+ * @details    Single-threaded: the thread calling start() renders
+ * the snapshot and answers scrapes one by one, closing the connection
+ * after each response.
+ */
+class PrometheusServer: public Server {
+    using Lock = std::lock_guard<std::mutex>;
+    using Text = std::shared_ptr<std::string>;
+
+    PrometheusParams params_;
+    metrics::Registry& registry_;
+
+    int listen_fd_;
+    int wake_fd_[2];
+    std::atomic<bool> stop_;
+    std::atomic<int> port_;
+
+    //! Published snapshot and the spare buffer to render into.
+    mutable std::mutex mtx_snapshot_;
+    Text front_;
+    Text back_;
+
+    //! Renders into the back buffer and publishes it.
+    void refresh() {
+        if( !back_ || back_.use_count() > 1 ) {
+            // Somebody still reads the old snapshot, don't touch it.
+            back_ = std::make_shared<std::string>();
+        }
+        std::ostringstream buf;
+        metrics::render_prometheus(registry_, buf);
+        *back_ = buf.str();
+        Lock lk(mtx_snapshot_);
+        front_.swap(back_);
+    }
+
+    Result listen() {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if( listen_fd_ < 0 ) {
+            return {errno, format("socket(): {}", std::strerror(errno)), Result::Kind::NetErr};
+        }
+        int on = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in sa{};
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(static_cast<uint16_t>(params_.port));
+        if( ::inet_pton(AF_INET, params_.addr.c_str(), &sa.sin_addr) != 1 ) {
+            return {format("Invalid IPv4 address \"{}\"", params_.addr), Result::Kind::Invalid};
+        }
+        if( ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0 ) {
+            return {errno, format("bind({}:{}): {}", params_.addr, params_.port, std::strerror(errno)),
+                    Result::Kind::NetErr};
+        }
+        if( ::listen(listen_fd_, 16) < 0 ) {
+            return {errno, format("listen(): {}", std::strerror(errno)), Result::Kind::NetErr};
+        }
+        socklen_t len = sizeof(sa);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&sa), &len);
+        port_ = ntohs(sa.sin_port);
+        return {};
+    }
+
+    void close_fds() {
+        for( int* fd: {&listen_fd_, &wake_fd_[0], &wake_fd_[1]} ) {
+            if( *fd >= 0 ) {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    //! Waits for `events` on `fd`; false once `deadline` has passed.
+    static bool wait_io(int fd, short events, Deadline deadline) {
+        for(;;) {
+            const auto left = std::chrono::duration_cast<MilliSec>(deadline - std::chrono::steady_clock::now());
+            if( left.count() <= 0 ) {
+                return false;
+            }
+            pollfd pfd{fd, events, 0};
+            const int n = ::poll(&pfd, 1, static_cast<int>(left.count()));
+            if( n > 0 ) {
+                return true;
+            }
+            if( n < 0 && errno != EINTR ) {
+                return false;
+            }
+        }
+    }
+
+    static bool send_all(int fd, const char* data, size_t len, Deadline deadline) {
+        while( len > 0 ) {
+            if( !wait_io(fd, POLLOUT, deadline) ) {
+                return false;
+            }
+            ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if( n < 0 ) {
+                if( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) continue;
+                return false;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void respond(int fd, const char* status, const std::string& body, Deadline deadline) {
+        const std::string header = format(
+            "HTTP/1.1 {}\r\n"
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: {}\r\n"
+            "Connection: close\r\n\r\n", status, body.size());
+        if( send_all(fd, header.data(), header.size(), deadline) ) {
+            send_all(fd, body.data(), body.size(), deadline);
+        }
+    }
+
+    //! The whole request must complete within `io_timeout`, however
+    //! slowly the client trickles bytes; the caller then closes `fd`.
+    void serve(int fd) {
+        TEC_ENTER("PrometheusServer::serve");
+        const Deadline deadline = std::chrono::steady_clock::now() + params_.io_timeout;
+
+        // Read the request head; the body (if any) is ignored.
+        std::string req;
+        char buf[1024];
+        while( req.find("\r\n\r\n") == std::string::npos && req.size() < 8192 ) {
+            if( !wait_io(fd, POLLIN, deadline) ) {
+                TEC_TRACE("request deadline passed, closing.");
+                return;
+            }
+            ssize_t n = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if( n <= 0 ) {
+                if( n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) ) continue;
+                return;
+            }
+            req.append(buf, static_cast<size_t>(n));
+        }
+
+        const auto line_end = req.find("\r\n");
+        const std::string line = req.substr(0, line_end);
+        if( line.compare(0, 4, "GET ") != 0 ) {
+            respond(fd, "405 Method Not Allowed", "Method Not Allowed\n", deadline);
+            return;
+        }
+        const auto path_end = line.find(' ', 4);
+        const std::string path = line.substr(4, path_end == std::string::npos ? std::string::npos : path_end - 4);
+        if( path != "/metrics" && path.compare(0, 9, "/metrics?") != 0 ) {
+            respond(fd, "404 Not Found", "Not Found\n", deadline);
+            return;
+        }
+        respond(fd, "200 OK", *snapshot(), deadline);
+    }
+
+public:
+    PrometheusServer(const PrometheusParams& params, metrics::Registry& registry = metrics::registry())
+        : params_{params}
+        , registry_{registry}
+        , listen_fd_{-1}
+        , wake_fd_{-1, -1}
+        , stop_{false}
+        , port_{0}
+        , front_{std::make_shared<std::string>()}
+    {}
+
+    virtual ~PrometheusServer() {
+        close_fds();
+    }
+
+    //! Actual TCP port, valid after start() signalled; useful if `params.port` is 0.
+    int port() const { return port_; }
+
+    //! The current pre-rendered snapshot.
+    std::shared_ptr<const std::string> snapshot() const {
+        Lock lk(mtx_snapshot_);
+        return front_;
+    }
+
+    /**
+     *  @brief Start serving.
+     *
+     *  Binds to `addr:port`, renders the first snapshot and signals
+     *  `sig_started`. Doesn't return until shutdown() is called
+     *  from another thread.
+     *
+     *  @param sig_started Signals the server is started, possible with error.
+     *  @param result tec::Result
+     */
+    void start(Signal& sig_started, Result& result) override {
+        TEC_ENTER("PrometheusServer::start");
+
+        if( ::pipe2(wake_fd_, O_CLOEXEC | O_NONBLOCK) < 0 ) {
+            result = {errno, format("pipe2(): {}", std::strerror(errno)), Result::Kind::System};
+            sig_started.set();
+            return;
+        }
+        result = listen();
+        if( !result ) {
+            TEC_TRACE("!!! Error: {}.", result);
+            close_fds();
+            sig_started.set();
+            return;
+        }
+        refresh();
+        TEC_TRACE("serving metrics on {}:{}.", params_.addr, port());
+        sig_started.set();
+
+        auto next_refresh = Now<MilliSec>() + params_.refresh_interval;
+        while( !stop_ ) {
+            pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fd_[0], POLLIN, 0}};
+            auto timeout = std::max<MilliSec::rep>(0, (next_refresh - Now<MilliSec>()).count());
+            int n = ::poll(fds, 2, static_cast<int>(timeout));
+            if( n < 0 && errno != EINTR ) {
+                break;
+            }
+            if( Now<MilliSec>() >= next_refresh ) {
+                refresh();
+                next_refresh = Now<MilliSec>() + params_.refresh_interval;
+            }
+            if( n > 0 && (fds[0].revents & POLLIN) ) {
+                int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                if( fd >= 0 ) {
+                    serve(fd);
+                    ::close(fd);
+                }
+            }
+        }
+        TEC_TRACE("stopped.");
+    }
+
+    /**
+     *  @brief Stops serving.
+     *
+     *  @param sig_stopped Signalled when the stop is requested; the
+     *  serving thread leaves start() right after.
+     */
+    void shutdown(Signal& sig_stopped) override {
+        TEC_ENTER("PrometheusServer::shutdown");
+        stop_ = true;
+        if( wake_fd_[1] >= 0 ) {
+            char c{0};
+            [[maybe_unused]] auto n = ::write(wake_fd_[1], &c, 1);
+        }
+        sig_stopped.set();
+    }
+};
+
+#endif // !__TEC_WINDOWS__
+
+
+} // ::tec
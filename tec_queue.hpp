@@ -33,11 +33,18 @@ SOFTWARE.
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <queue>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <string>
+#include <utility>
 
 #include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_metrics.hpp"
 
 
 namespace tec {
@@ -50,21 +57,57 @@ private:
     mutable std::mutex m_;
     mutable std::condition_variable c_;
 
+    //! Elements added so far, guarded by m_.
+    uint64_t enqueued_;
+
+    //! Optional metrics, read at scrape time, see tec_metrics.hpp.
+    std::shared_ptr<metrics::Probe> m_depth_;
+    std::shared_ptr<metrics::Probe> m_enqueued_;
+
 public:
     //! Construct the empty queue.
     SafeQueue(void)
         : q_()
         , m_()
         , c_()
+        , enqueued_{0}
+    {}
+
+    //! Construct the empty queue and register its metrics under `name`.
+    //! Both are computed under the queue lock when the registry is read,
+    //! so enqueue() and dequeue() pay nothing for them.
+    explicit SafeQueue(const std::string& name)
+        : q_()
+        , m_()
+        , c_()
+        , enqueued_{0}
+        , m_depth_{metrics::registry().probe(
+                metrics::Type::Gauge, "tec_queue_depth", "Elements in the queue.",
+                metrics::label("queue", name), [this] { return static_cast<int64_t>(size()); })}
+        , m_enqueued_{metrics::registry().probe(
+                metrics::Type::Counter, "tec_queue_enqueued_total", "Elements added to the queue.",
+                metrics::label("queue", name), [this] { return static_cast<int64_t>(enqueued()); })}
     {}
 
-    ~SafeQueue(void) {}
+    SafeQueue(const SafeQueue&) = delete;
+    SafeQueue& operator=(const SafeQueue&) = delete;
+
+    ~SafeQueue(void) {
+        if( m_depth_ ) {
+            m_depth_->detach();
+            m_enqueued_->detach();
+        }
+    }
 
     //! Add an element to the queue.
-    void enqueue(T t) {
+    //! Returns the queue depth after the element has been added.
+    size_t enqueue(T t) {
         std::lock_guard<std::mutex> lock(m_);
-        q_.push(t);
+        q_.push(std::move(t));
+        ++enqueued_;
+        const size_t depth = q_.size();
         c_.notify_one();
+        return depth;
     }
 
     //! Get the front element and remove it from the queue.
@@ -76,18 +119,156 @@ public:
             // Release lock as long as the wait and reaquire it afterwards.
             c_.wait(lock);
         }
-        T val = q_.front();
+        T val = std::move(q_.front());
         q_.pop();
         return val;
     }
 
+    //! Like dequeue(), but gives up at `deadline`.
+    //! Returns false on timeout, leaving `out` unchanged.
+    template <typename Clock, typename Dur>
+    bool dequeue_until(T& out, const std::chrono::time_point<Clock, Dur>& deadline) {
+        std::unique_lock<std::mutex> lock(m_);
+        if( !c_.wait_until(lock, deadline, [this]{ return !q_.empty(); }) ) {
+            return false;
+        }
+        out = std::move(q_.front());
+        q_.pop();
+        return true;
+    }
+
+    //! Takes the front element if any, never waits.
+    //! Returns false if the queue is empty, leaving `out` unchanged.
+    bool try_dequeue(T& out) {
+        std::lock_guard<std::mutex> lock(m_);
+        if( q_.empty() ) {
+            return false;
+        }
+        out = std::move(q_.front());
+        q_.pop();
+        return true;
+    }
+
     //! Wait till a message is avaiable.
     //! Returns false if msg.quit() is set, otherwise true.
     bool poll(T& msg) {
-        msg = std::move(dequeue());
+        msg = dequeue();
         return !msg.quit();
     }
 
+    //! Current number of elements.
+    size_t size(void) const {
+        std::lock_guard<std::mutex> lock(m_);
+        return q_.size();
+    }
+
+    //! Number of elements added so far.
+    uint64_t enqueued(void) const {
+        std::lock_guard<std::mutex> lock(m_);
+        return enqueued_;
+    }
+
+};
+
+
+/**
+ * @class      BoundedQueue
+ * @brief      A blocking queue of fixed capacity.
+ *
+ * @details    push() blocks while the queue is full, which slows a
+ * producer down to the pace of its consumers (backpressure). close()
+ * ends the stream: pending elements are still delivered, then pop()
+ * returns false. Time spent blocked is reported to the caller; the
+ * clock is read only when a call actually blocks.
+ */
+template <class T>
+class BoundedQueue {
+private:
+    std::deque<T> q_;
+    const size_t capacity_;
+    bool closed_;
+    mutable std::mutex m_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+
+    static uint64_t since(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+public:
+    //! A capacity of 0 is taken as 1.
+    explicit BoundedQueue(size_t capacity)
+        : capacity_{capacity > 0 ? capacity : 1}
+        , closed_{false}
+    {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    //! Waits for room, adding the time blocked to `blocked_ns`.
+    //! Returns false if the queue is closed.
+    bool push(T t, uint64_t& blocked_ns) {
+        std::unique_lock<std::mutex> lock(m_);
+        if( q_.size() >= capacity_ && !closed_ ) {
+            const auto start = std::chrono::steady_clock::now();
+            not_full_.wait(lock, [this]{ return q_.size() < capacity_ || closed_; });
+            blocked_ns += since(start);
+        }
+        if( closed_ ) {
+            return false;
+        }
+        q_.push_back(std::move(t));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool push(T t) {
+        uint64_t blocked_ns{0};
+        return push(std::move(t), blocked_ns);
+    }
+
+    //! Waits for an element, adding the time blocked to `blocked_ns`.
+    //! Returns false once the queue is closed and drained.
+    bool pop(T& out, uint64_t& blocked_ns) {
+        std::unique_lock<std::mutex> lock(m_);
+        if( q_.empty() && !closed_ ) {
+            const auto start = std::chrono::steady_clock::now();
+            not_empty_.wait(lock, [this]{ return !q_.empty() || closed_; });
+            blocked_ns += since(start);
+        }
+        if( q_.empty() ) {
+            return false;
+        }
+        out = std::move(q_.front());
+        q_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    bool pop(T& out) {
+        uint64_t blocked_ns{0};
+        return pop(out, blocked_ns);
+    }
+
+    //! No more push(); wakes up all waiting threads.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return q_.size();
+    }
+
+    size_t capacity() const { return capacity_; }
 };
 
 
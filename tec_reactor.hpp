@@ -0,0 +1,303 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_reactor.hpp
+ *   @brief A Worker that also waits on file descriptors.
+ *
+ *  ReactorWorker blocks in `epoll_wait()` instead of on its queue.
+ *  send() wakes it through an `eventfd`, readiness of watched
+ *  descriptors is dispatched to on_readable()/on_writable() on the
+ *  worker thread. Messages, timers, init() and finalize() work as in
+ *  tec::Worker, so sockets, pipes and timerfds need no extra thread.
+ *
+ *  @code
+ *  class Server: public tec::ReactorWorker<Params> {
+ *      tec::Result init() override { return watch(listen_fd_, true); }
+ *      void on_readable(int fd) override { ... }
+ *      void process(const tec::Message& msg) override { ... }
+ *      ...
+ *  };
+ *  @endcode
+ *
+ *  Linux only.
+ *
+*/
+
+#pragma once
+
+#if !defined(__linux__)
+#error "tec_reactor.hpp requires Linux (epoll, eventfd)."
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_thread.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Reactor Worker
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      ReactorWorker
+ * @brief      A Worker whose message loop waits on messages and file descriptors together.
+ *
+ * @details    Descriptors are level-triggered. Errors and hang-ups are
+ * reported to whichever callback watches the descriptor. send() only
+ * writes the eventfd when the worker sleeps in `epoll_wait()`.
+ *
+ * Exports `tec_reactor_fd_events_total` and `tec_reactor_wakeups_total`,
+ * labelled `worker`.
+ *
+ * @note A derived class that overrides callbacks must not rely on
+ * ~Worker() to stop the thread; ~ReactorWorker() does it first.
+ */
+template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec,
+          typename TStats = NoStats>
+class ReactorWorker: public Worker<TWorkerParams, TMessage, Duration, TStats> {
+public:
+    using Base = Worker<TWorkerParams, TMessage, Duration, TStats>;
+    using TimerClock = typename Base::TimerClock;
+
+    //! Readiness events taken by one `epoll_wait()`.
+    static constexpr int kMaxEvents{64};
+
+protected:
+    using Envelope = typename Base::Envelope;
+
+private:
+    int epfd_;
+    int evfd_;
+    //! Error creating the epoll or eventfd descriptor, returned by run().
+    Result setup_;
+    //! The worker thread is in, or about to enter, `epoll_wait()`.
+    std::atomic<bool> sleeping_;
+
+    //! Watched descriptors and their interest, worker thread only.
+    std::unordered_map<int, uint32_t> watched_;
+    std::vector<epoll_event> events_;
+
+    std::shared_ptr<metrics::Counter> m_fd_events_;
+    std::shared_ptr<metrics::Counter> m_wakeups_;
+
+    static uint32_t interest(bool readable, bool writable) {
+        return (readable ? uint32_t{EPOLLIN} : 0u) | (writable ? uint32_t{EPOLLOUT} : 0u);
+    }
+
+    //! Milliseconds to `deadline`, rounded up so that timers are not early.
+    static int timeout_ms(typename TimerClock::time_point deadline) {
+        if( deadline == TimerClock::time_point::max() ) {
+            return -1;
+        }
+        const auto now = TimerClock::now();
+        if( deadline <= now ) {
+            return 0;
+        }
+        const auto ms = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+        return ms > 0x7fffffff ? 0x7fffffff : static_cast<int>(ms);
+    }
+
+    //! Dispatches one readiness event unless the descriptor has been unwatched meanwhile.
+    void dispatch(const epoll_event& ev) {
+        const int fd = ev.data.fd;
+        const uint32_t failed = ev.events & (EPOLLERR | EPOLLHUP);
+        auto it = watched_.find(fd);
+        if( it != watched_.end() && (it->second & EPOLLIN) && (ev.events & (EPOLLIN | failed)) ) {
+            m_fd_events_->inc();
+            on_readable(fd);
+        }
+        // on_readable() may have unwatched it.
+        it = watched_.find(fd);
+        if( it != watched_.end() && (it->second & EPOLLOUT) && (ev.events & (EPOLLOUT | failed)) ) {
+            m_fd_events_->inc();
+            on_writable(fd);
+        }
+    }
+
+public:
+    ReactorWorker(const TWorkerParams& params, Launch launch = Launch::Eager)
+        : Base(params, launch)
+        , epfd_{::epoll_create1(EPOLL_CLOEXEC)}
+        , evfd_{-1}
+        , sleeping_{false}
+        , events_(kMaxEvents)
+        , m_fd_events_{metrics::registry().instance<metrics::Counter>(
+                "tec_reactor_fd_events_total", "Descriptor readiness events dispatched.",
+                metrics::label("worker", this->name_))}
+        , m_wakeups_{metrics::registry().instance<metrics::Counter>(
+                "tec_reactor_wakeups_total", "Wakeups of the reactor by send().",
+                metrics::label("worker", this->name_))}
+    {
+        // The thread, if any, is parked until run().
+        if( epfd_ < 0 ) {
+            setup_ = details::errno_result("epoll_create1()");
+            return;
+        }
+        evfd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if( evfd_ < 0 ) {
+            setup_ = details::errno_result("eventfd()");
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = evfd_;
+        if( ::epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev) != 0 ) {
+            setup_ = details::errno_result("epoll_ctl()");
+        }
+    }
+
+    virtual ~ReactorWorker() {
+        // Stop the loop while the overrides below still exist.
+        if( this->thread_.joinable() ) {
+            this->terminate();
+        }
+        if( evfd_ >= 0 ) {
+            ::close(evfd_);
+        }
+        if( epfd_ >= 0 ) {
+            ::close(epfd_);
+        }
+    }
+
+    //! Fails without starting the thread if the reactor could not be set up.
+    Result run() override {
+        if( !setup_ ) {
+            return setup_;
+        }
+        return Base::run();
+    }
+
+    bool send(const TMessage& msg) override {
+        if( !Base::send(msg) ) {
+            return false;
+        }
+        if( sleeping_.exchange(false) ) {
+            const uint64_t one{1};
+            [[maybe_unused]] auto n = ::write(evfd_, &one, sizeof(one));
+            m_wakeups_->inc();
+        }
+        return true;
+    }
+
+protected:
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     *
+     *     Descriptors, call from init() or the worker thread only
+     *
+     *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /**
+     *  @brief Starts watching `fd`, or changes what is watched.
+     *
+     *  The worker does not own `fd`: unwatch() it before closing.
+     *
+     *  @param fd A descriptor that epoll supports.
+     *  @param readable Call on_readable() when `fd` is readable.
+     *  @param writable Call on_writable() when `fd` is writable.
+     *  @return tec::Result
+     */
+    Result watch(int fd, bool readable, bool writable = false) {
+        if( !setup_ ) {
+            return setup_;
+        }
+        epoll_event ev{};
+        ev.events = interest(readable, writable);
+        ev.data.fd = fd;
+        const bool known = watched_.count(fd) > 0;
+        if( ::epoll_ctl(epfd_, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0 ) {
+            return details::errno_result("epoll_ctl()");
+        }
+        watched_[fd] = ev.events;
+        return {};
+    }
+
+    //! Stops watching `fd`; pending events for it are discarded.
+    Result unwatch(int fd) {
+        if( watched_.erase(fd) == 0 ) {
+            return {format("fd {} is not watched", fd), Result::Kind::Invalid};
+        }
+        if( ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr) != 0 ) {
+            return details::errno_result("epoll_ctl()");
+        }
+        return {};
+    }
+
+    //! Called on the worker thread when `fd` is readable, or failed.
+    virtual void on_readable(int /*fd*/) {
+    }
+
+    //! Called on the worker thread when `fd` is writable, or failed.
+    virtual void on_writable(int /*fd*/) {
+    }
+
+    //! Takes a message if queued, otherwise waits in `epoll_wait()`.
+    bool next_message(Envelope& env, typename TimerClock::time_point deadline) override {
+        if( this->mq_.try_dequeue(env) ) {
+            return true;
+        }
+        // Announce the sleep, then look again: a send() in between
+        // either sees `sleeping_` and writes the eventfd, or is seen here.
+        sleeping_.store(true);
+        if( this->mq_.try_dequeue(env) ) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            return true;
+        }
+        const int n = ::epoll_wait(epfd_, events_.data(), kMaxEvents, timeout_ms(deadline));
+        sleeping_.store(false, std::memory_order_relaxed);
+        for( int i = 0; i < n; ++i ) {
+            if( events_[i].data.fd == evfd_ ) {
+                uint64_t count;
+                [[maybe_unused]] auto r = ::read(evfd_, &count, sizeof(count));
+            }
+            else {
+                dispatch(events_[i]);
+            }
+        }
+        // n < 0 is EINTR: the loop calls again.
+        return this->mq_.try_dequeue(env);
+    }
+
+}; // ::ReactorWorker
+
+
+} // ::tec
@@ -29,24 +29,40 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 /** @class Semaphore
  * @brief      Declares an abstract semaphore.
  *
  * @details    Signalled when a predicate returns `true.`
+ * The predicate type defaults to std::function; a stateless functor
+ * type saves its storage and the indirect call (see Signal).
  *
  */
-template <typename Value>
+template <typename Value, typename TPredicate = std::function<bool(const Value&)>>
 class Semaphore {
 public:
     //! A predicate to check out as a functional object.
-    using Predicate = std::function<bool(const Value&)>;
+    using Predicate = TPredicate;
 
-private:
+protected:
     //@{ Synchronization stuff.
     mutable std::mutex m_;
     mutable std::condition_variable cv_;
@@ -62,7 +78,15 @@ public:
     //! Constructs a semaphore.
     Semaphore(Predicate&& pred)
         : value_{}
-        , pred_(std::function(std::move(pred)))
+        , pred_(std::move(pred))
+    {}
+
+    //! Constructs a semaphore with a stateless predicate, see Signal.
+    //! A type-erased predicate must be given explicitly.
+    template <typename P = Predicate, typename = std::enable_if_t<std::is_empty_v<P>>>
+    Semaphore()
+        : value_{}
+        , pred_{}
     {}
 
     //! Assign a new value to the semaphore and notify all other threads.
@@ -110,11 +134,213 @@ using SemaphoreBool = Semaphore<bool>;
 using SemaphoreInt = Semaphore<int>;
 
 
-//! Extends `SemaphoreBool` with `set() method.
-class Signal: public SemaphoreBool {
+//! Signal predicate: no storage, inlined.
+struct SignalPredicate {
+    bool operator()(bool value) const { return value; }
+};
+
+
+#if defined(__linux__)
+
+namespace tec {
+namespace details {
+
+//! Sleeps while `word` holds `expected`; process-private futex.
+inline void futex_wait_private(const std::atomic<uint32_t>& word, uint32_t expected, const timespec* timeout) {
+    ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+              expected, timeout, nullptr, 0);
+}
+
+//! Wakes every thread sleeping on `word`.
+inline void futex_wake_all_private(const std::atomic<uint32_t>& word) {
+    ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+              INT_MAX, nullptr, nullptr, 0);
+}
+
+} // ::details
+} // ::tec
+
+
+/**
+ * @class      Signal
+ * @brief      A boolean semaphore with `set()` method.
+ *
+ * @details    A single futex word: the set bit and a bit telling that
+ * some thread sleeps on it. set() makes no system call unless there is
+ * a waiter, and the whole signal takes 4 bytes instead of a mutex and
+ * a condition variable.
+ */
+class Signal {
+    static constexpr const uint32_t kSet{1};
+    static constexpr const uint32_t kWaiters{2};
+
+    mutable std::atomic<uint32_t> state_;
+
+    //! Marks a waiter in `v` unless marked already; false if `v` changed.
+    bool mark_waiter(uint32_t& v) const {
+        return (v & kWaiters) ||
+            state_.compare_exchange_weak(v, v | kWaiters, std::memory_order_acquire);
+    }
+
+public:
+    //! Constructs a signal in the unset state.
+    Signal(): state_{0} {}
+
+    Signal(const Signal&) = delete;
+    Signal& operator=(const Signal&) = delete;
+
+    //! Set signalled state and wake all waiters.
+    void set() {
+        if( state_.exchange(kSet, std::memory_order_acq_rel) & kWaiters ) {
+            tec::details::futex_wake_all_private(state_);
+        }
+    }
+
+    //! Reset to the unset state.
+    void reset() { state_.fetch_and(~kSet, std::memory_order_relaxed); }
+
+    //! set() if `value` is true, otherwise reset().
+    void set_value(bool value) {
+        if( value ) {
+            set();
+        }
+        else {
+            reset();
+        }
+    }
+
+    //! Wait for the signal is set, unconditionally.
+    void wait() const {
+        uint32_t v = state_.load(std::memory_order_acquire);
+        while( !(v & kSet) ) {
+            if( mark_waiter(v) ) {
+                tec::details::futex_wait_private(state_, v | kWaiters, nullptr);
+                v = state_.load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    /**
+     * @brief      Wait for the signal is set for the specified amount of time.
+     * @param      dur Duration Amount of time to wait for the signal is set.
+     * @return     bool `false` if timeout otherwise `true`.
+     */
+    template <typename Duration>
+    bool wait_for(Duration dur) const {
+        using Clock = std::chrono::steady_clock;
+        uint32_t v = state_.load(std::memory_order_acquire);
+        if( v & kSet ) {
+            return true;
+        }
+        const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(dur);
+        while( !(v & kSet) ) {
+            const auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+            if( left <= 0 ) {
+                return false;
+            }
+            if( mark_waiter(v) ) {
+                const timespec ts{static_cast<time_t>(left / 1000000000), static_cast<long>(left % 1000000000)};
+                tec::details::futex_wait_private(state_, v | kWaiters, &ts);
+                v = state_.load(std::memory_order_acquire);
+            }
+        }
+        return true;
+    }
+};
+
+#else
+
+//! A boolean semaphore with `set()` method.
+class Signal: public Semaphore<bool, SignalPredicate> {
 public:
     //! Constructs a boolean semaphore.
-    Signal(): SemaphoreBool([](auto f){return f;}) {}
+    Signal() = default;
+    //! Set signalled state.
+    void set() { set_value(true); }
+};
+
+#endif
+
+
+/** @class AsyncSemaphore
+ * @brief      A semaphore that also calls back, see notify_when().
+ *
+ * @details    Keeps a list of callbacks, so plain Semaphore and Signal
+ * stay small; coroutines (tec_coro.hpp) wait on this one. Set the
+ * value through this class: Semaphore::set_value() does not run
+ * the callbacks.
+ *
+ */
+template <typename Value, typename TPredicate = std::function<bool(const Value&)>>
+class AsyncSemaphore: public Semaphore<Value, TPredicate> {
+    using Base = Semaphore<Value, TPredicate>;
+
+public:
+    //! Identifies a callback, see notify_when(); 0 for none.
+    using Token = uint64_t;
+
+private:
+    mutable std::vector<std::pair<Token, std::function<void()>>> waiters_;
+    mutable Token last_token_{0};
+
+public:
+    using Base::Base;
+
+    //! Assign a new value, notify all other threads and run the callbacks
+    //! if the predicate holds.
+    void set_value(const Value& new_value) {
+        std::vector<std::pair<Token, std::function<void()>>> ready;
+        {
+            typename Base::Lock lock(this->m_);
+            this->value_ = new_value;
+            if( !waiters_.empty() && this->pred_(this->value_) ) {
+                ready.swap(waiters_);
+            }
+        }
+        this->cv_.notify_all();
+        for( auto& waiter: ready ) {
+            waiter.second();
+        }
+    }
+
+    /**
+     * @brief      Calls `fn` once the predicate returns `true`, without blocking.
+     * @details    `fn` is called at once if the predicate holds already,
+     * otherwise by the thread that sets a matching value.
+     * @return     Token to pass to cancel(), 0 if `fn` has been called.
+     */
+    Token notify_when(std::function<void()> fn) const {
+        {
+            typename Base::Lock lock(this->m_);
+            if( !this->pred_(this->value_) ) {
+                waiters_.emplace_back(++last_token_, std::move(fn));
+                return last_token_;
+            }
+        }
+        fn();
+        return 0;
+    }
+
+    //! Drops a callback registered by notify_when().
+    //! Returns false if it has been called or is being called.
+    bool cancel(Token token) const {
+        typename Base::Lock lock(this->m_);
+        for( auto it = waiters_.begin(); it != waiters_.end(); ++it ) {
+            if( it->first == token ) {
+                waiters_.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+}; // AsyncSemaphore
+
+
+//! A Signal that coroutines can co_await, see tec_coro.hpp.
+class AsyncSignal: public AsyncSemaphore<bool, SignalPredicate> {
+public:
+    AsyncSignal() = default;
     //! Set signalled state.
     void set() { set_value(true); }
 };
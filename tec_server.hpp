@@ -32,6 +32,8 @@ SOFTWARE.
 
 #pragma once
 
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_stopwatch.hpp"
 #include "tec/tec_trace.hpp"
 #include "tec/tec_utils.hpp"
 #include "tec/tec_worker.hpp"
@@ -127,19 +129,38 @@ private:
     Result result_started_;
     Result result_stopped_;
 
+    //! Standard metrics.
+    std::shared_ptr<metrics::Gauge> m_up_;
+    std::shared_ptr<metrics::Gauge> m_start_ns_;
+    std::shared_ptr<metrics::Gauge> m_shutdown_ns_;
+
+    void register_metrics() {
+        const auto lbl = metrics::label("server", this->name());
+        m_up_ = metrics::registry().instance<metrics::Gauge>(
+            "tec_server_up", "1 if the server is running.", lbl);
+        m_start_ns_ = metrics::registry().instance<metrics::Gauge>(
+            "tec_server_start_duration_ns", "Duration of the server start.", lbl);
+        m_shutdown_ns_ = metrics::registry().instance<metrics::Gauge>(
+            "tec_server_shutdown_duration_ns", "Duration of the server shutdown.", lbl);
+    }
+
 public:
     //! Initialize with a Server.
     ServerWorker(const TServerParams& params, std::unique_ptr<TServer> server)
         : Worker<TServerParams>(params)
         , params_(params)
         , server_(std::move(server))    // Now ServerWorker owns the server!
-    {}
+    {
+        register_metrics();
+    }
 
     //! No Server provided in constructor, use attach_server() later.
     ServerWorker(const TServerParams& params)
         : Worker<TServerParams>(params)
         , params_(params)
-    {}
+    {
+        register_metrics();
+    }
 
     virtual ~ServerWorker() {}
 
@@ -163,6 +184,7 @@ protected:
         }
 
         // A new thread to start the server.
+        BasicStopwatch<MonoClock> sw;
         server_thread_.reset(
             new std::thread([&]{
                 server_->start(sig_started_, result_started_);
@@ -181,6 +203,8 @@ protected:
         }
 
         // Everything is OK.
+        m_start_ns_->set(static_cast<int64_t>(sw.elapsed()));
+        m_up_->set(1);
         return {};
     }
 
@@ -197,6 +221,7 @@ protected:
             return {};
         }
 
+        BasicStopwatch<MonoClock> sw;
         std::thread shutdown_thread([&]{
             server_->shutdown(sig_stopped_);
             });
@@ -213,6 +238,8 @@ protected:
         }
 
         shutdown_thread.join();
+        m_shutdown_ns_->set(static_cast<int64_t>(sw.elapsed()));
+        m_up_->set(0);
         return result_stopped_;
     }
 };
@@ -0,0 +1,820 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_shm.hpp
+ *   @brief Shared-memory mailbox between processes.
+ *
+ *  ShmRing is a single-producer/single-consumer ring of length-prefixed
+ *  records in a shared memory segment, named (shm_open) or anonymous
+ *  (memfd, pass its descriptor to the peer). Waiting sides sleep on
+ *  futexes in the segment; a side that is not waited for makes no
+ *  system call. Each side records its pid, so the other can detect
+ *  a crash through a pidfd.
+ *
+ *  ShmWorker receives fixed-size messages from the ring in its own
+ *  message loop, next to local send(); ShmSender sends them from
+ *  another process:
+ *
+ *  @code
+ *  // Daemon A
+ *  auto ring = tec::ShmRing::create("/quotes", 1 << 20);
+ *  QuoteWorker worker(params, std::move(*ring));
+ *  worker.run();
+ *
+ *  // Daemon B
+ *  auto sender = tec::ShmSender<Quote>::connect("/quotes");
+ *  sender->send(quote);
+ *  @endcode
+ *
+ *  Linux only.
+ *
+*/
+
+#pragma once
+
+#if !defined(__linux__)
+#error "tec_shm.hpp requires Linux (memfd, futex, pidfd)."
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_expected.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_thread.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+//! Side of a ShmRing.
+enum class ShmRole {
+    Producer,
+    Consumer,
+};
+
+
+namespace details {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                       Segment layout
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Placed at the start of the segment, records follow.
+//! Each side writes its own cache lines only.
+struct ShmHeader {
+    static constexpr uint64_t kMagic{0x31474e4952434554}; // "TECRING1"
+    static constexpr uint32_t kVersion{1};
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t capacity;
+
+    //! Written by the producer.
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> space_seq;         //!< Futex: the producer waits for space.
+    std::atomic<uint32_t> producer_waiting;
+    std::atomic<int32_t> producer_pid;
+
+    //! Written by the consumer.
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> data_seq;          //!< Futex: the consumer waits for data.
+    std::atomic<uint32_t> consumer_waiting;
+    std::atomic<int32_t> consumer_pid;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ShmRing needs lock-free 64-bit atomics");
+static_assert(sizeof(ShmHeader) % 64 == 0, "records must be cache line aligned");
+
+
+inline int futex_wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) {
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+                                      FUTEX_WAIT, expected, &ts, nullptr, 0));
+}
+
+inline void futex_wake(std::atomic<uint32_t>& word) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+
+//! Another process, watched through a pidfd.
+class ShmPeer {
+    int32_t pid_;
+    int pidfd_;
+
+public:
+    ShmPeer(): pid_{0}, pidfd_{-1} {}
+    ShmPeer(const ShmPeer&) = delete;
+    ShmPeer& operator=(const ShmPeer&) = delete;
+    ~ShmPeer() { reset(0); }
+
+    void reset(int32_t pid) {
+        if( pidfd_ >= 0 ) {
+            ::close(pidfd_);
+        }
+        pid_ = pid;
+        pidfd_ = pid > 0 ? static_cast<int>(::syscall(SYS_pidfd_open, pid, 0)) : -1;
+    }
+
+    //! False once the process `pid` has exited; true for no process (0).
+    bool alive(int32_t pid) {
+        if( pid <= 0 ) {
+            return true;
+        }
+        if( pid != pid_ ) {
+            reset(pid);
+        }
+        if( pidfd_ >= 0 ) {
+            // A pidfd becomes readable when the process exits.
+            pollfd pfd{pidfd_, POLLIN, 0};
+            return ::poll(&pfd, 1, 0) == 0;
+        }
+        // No pidfd (kernel < 5.3): the pid may have been reused.
+        return ::kill(pid, 0) == 0 || errno == EPERM;
+    }
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Shared ring
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      ShmRing
+ * @brief      SPSC ring of length-prefixed records in shared memory.
+ *
+ * @details    A record is an 8-byte header followed by the payload,
+ * padded to 8 bytes, and never wraps: a record that does not fit at
+ * the end of the ring is preceded by a skip marker. A record becomes
+ * visible only when completely written, so a producer crash never
+ * exposes a partial one.
+ *
+ * Each process attach()es as one side. A side whose process has died
+ * is taken over by the next attach().
+ */
+class ShmRing {
+public:
+    //! Largest record payload for a given capacity is capacity / 2 - 8.
+    static constexpr size_t kRecordHeader{8};
+
+private:
+    static constexpr uint32_t kSkip{0xffffffff};
+
+    int fd_;
+    void* base_;
+    size_t size_;
+    //! Unlinked by the destructor if not empty.
+    std::string owned_name_;
+
+    details::ShmHeader* hdr_;
+    unsigned char* data_;
+    uint64_t mask_;
+
+    //! Cached positions of this side.
+    uint64_t pos_;
+    uint64_t limit_;
+    ShmRole role_;
+    bool attached_;
+    //! try_pop() has dropped malformed data, see take_fault().
+    bool fault_;
+    details::ShmPeer peer_;
+
+    ShmRing(int fd, void* base, size_t size)
+        : fd_{fd}
+        , base_{base}
+        , size_{size}
+        , hdr_{static_cast<details::ShmHeader*>(base)}
+        , data_{static_cast<unsigned char*>(base) + sizeof(details::ShmHeader)}
+        , mask_{hdr_->capacity - 1}
+        , pos_{0}
+        , limit_{0}
+        , role_{ShmRole::Consumer}
+        , attached_{false}
+        , fault_{false}
+    {}
+
+    static constexpr uint64_t record_size(size_t len) {
+        return kRecordHeader + ((len + 7) & ~uint64_t{7});
+    }
+
+    static Expected<std::unique_ptr<ShmRing>> map(int fd, bool init, size_t capacity) {
+        size_t size{0};
+        if( init ) {
+            size = sizeof(details::ShmHeader) + capacity;
+            if( ::ftruncate(fd, static_cast<off_t>(size)) != 0 ) {
+                auto err = details::errno_result("ftruncate()");
+                ::close(fd);
+                return err;
+            }
+        }
+        else {
+            struct stat st;
+            if( ::fstat(fd, &st) != 0 ) {
+                auto err = details::errno_result("fstat()");
+                ::close(fd);
+                return err;
+            }
+            size = static_cast<size_t>(st.st_size);
+            if( size < sizeof(details::ShmHeader) ) {
+                ::close(fd);
+                return Result{"not a ShmRing segment", Result::Kind::Invalid};
+            }
+        }
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if( base == MAP_FAILED ) {
+            auto err = details::errno_result("mmap()");
+            ::close(fd);
+            return err;
+        }
+        auto* hdr = static_cast<details::ShmHeader*>(base);
+        if( init ) {
+            // ftruncate() zeroed the segment, atomics start at 0.
+            hdr->capacity = capacity;
+            hdr->version = details::ShmHeader::kVersion;
+            std::atomic_thread_fence(std::memory_order_release);
+            hdr->magic = details::ShmHeader::kMagic;
+        }
+        else if( hdr->magic != details::ShmHeader::kMagic
+                 || hdr->version != details::ShmHeader::kVersion
+                 || !check_capacity(static_cast<size_t>(hdr->capacity))
+                 || sizeof(details::ShmHeader) + hdr->capacity != size ) {
+            ::munmap(base, size);
+            ::close(fd);
+            return Result{"not a ShmRing segment", Result::Kind::Invalid};
+        }
+        return std::unique_ptr<ShmRing>(new ShmRing(fd, base, size));
+    }
+
+    static Result check_capacity(size_t capacity) {
+        if( capacity < 64 || (capacity & (capacity - 1)) != 0 ) {
+            return {format("ShmRing capacity {} is not a power of 2 >= 64", capacity), Result::Kind::Invalid};
+        }
+        return {};
+    }
+
+    std::atomic<int32_t>& pid_of(ShmRole role) {
+        return role == ShmRole::Producer ? hdr_->producer_pid : hdr_->consumer_pid;
+    }
+
+public:
+    //! Creates the named segment `name` ("/name"), replacing a stale one.
+    //! `capacity` is a power of 2, in bytes.
+    static Expected<std::unique_ptr<ShmRing>> create(const std::string& name, size_t capacity) {
+        if( auto result = check_capacity(capacity); !result ) {
+            return result;
+        }
+        ::shm_unlink(name.c_str());
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if( fd < 0 ) {
+            return details::errno_result("shm_open()");
+        }
+        auto ring = map(fd, true, capacity);
+        if( !ring ) {
+            ::shm_unlink(name.c_str());
+            return ring;
+        }
+        (*ring)->owned_name_ = name;
+        return ring;
+    }
+
+    //! Opens the named segment made by create().
+    static Expected<std::unique_ptr<ShmRing>> open(const std::string& name) {
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if( fd < 0 ) {
+            return details::errno_result("shm_open()");
+        }
+        return map(fd, false, 0);
+    }
+
+    //! Creates an anonymous segment, pass fd() to the peer (fork, SCM_RIGHTS).
+    static Expected<std::unique_ptr<ShmRing>> create_memfd(size_t capacity) {
+        if( auto result = check_capacity(capacity); !result ) {
+            return result;
+        }
+        const int fd = static_cast<int>(::syscall(SYS_memfd_create, "tec_shm_ring", MFD_CLOEXEC));
+        if( fd < 0 ) {
+            return details::errno_result("memfd_create()");
+        }
+        return map(fd, true, capacity);
+    }
+
+    //! Maps a segment descriptor received from the peer, takes ownership of `fd`.
+    static Expected<std::unique_ptr<ShmRing>> attach_fd(int fd) {
+        return map(fd, false, 0);
+    }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    ~ShmRing() {
+        detach();
+        ::munmap(base_, size_);
+        ::close(fd_);
+        if( !owned_name_.empty() ) {
+            ::shm_unlink(owned_name_.c_str());
+        }
+    }
+
+    int fd() const { return fd_; }
+    //! Read once at map(): the header is writable by the peer.
+    size_t capacity() const { return static_cast<size_t>(mask_ + 1); }
+    size_t max_record() const { return capacity() / 2 - kRecordHeader; }
+
+    /**
+     * @brief      Takes the `role` side of the ring for this process.
+     *
+     * @details    Fails if a live process holds it; the side of a dead
+     * one is taken over, resuming from where it stopped.
+     */
+    Result attach(ShmRole role) {
+        if( attached_ ) {
+            return {"ShmRing is attached already", Result::Kind::Invalid};
+        }
+        auto& pid = pid_of(role);
+        const int32_t me = static_cast<int32_t>(::getpid());
+        int32_t holder = pid.load();
+        details::ShmPeer check;
+        do {
+            if( holder != 0 && check.alive(holder) ) {
+                return {format("ShmRing side is held by process {}", holder), Result::Kind::RuntimeErr};
+            }
+        } while( !pid.compare_exchange_weak(holder, me) );
+        role_ = role;
+        attached_ = true;
+        fault_ = false;
+        if( role == ShmRole::Producer ) {
+            pos_ = hdr_->tail.load(std::memory_order_relaxed);
+            limit_ = hdr_->head.load(std::memory_order_acquire) + capacity();
+        }
+        else {
+            pos_ = hdr_->head.load(std::memory_order_relaxed);
+            limit_ = hdr_->tail.load(std::memory_order_acquire);
+        }
+        return {};
+    }
+
+    //! Releases this side, done by the destructor.
+    void detach() {
+        if( attached_ ) {
+            int32_t me = static_cast<int32_t>(::getpid());
+            pid_of(role_).compare_exchange_strong(me, 0);
+            attached_ = false;
+        }
+    }
+
+    //! False if the other side has been attached by a process that died.
+    bool peer_alive() {
+        return peer_.alive(pid_of(role_ == ShmRole::Producer ? ShmRole::Consumer : ShmRole::Producer).load());
+    }
+
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     *                             Producer
+     *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    //! Bytes taken by a record of `len` at the current position, with a skip.
+    uint64_t footprint(size_t len) const {
+        const uint64_t need = record_size(len);
+        const uint64_t tail_room = capacity() - (pos_ & mask_);
+        return tail_room < need ? tail_room + need : need;
+    }
+
+    //! Appends a record, returns false if there is no room.
+    bool try_push(const void* data, size_t len) {
+        if( len > max_record() ) {
+            return false;
+        }
+        const uint64_t need = record_size(len);
+        const uint64_t offset = pos_ & mask_;
+        const uint64_t tail_room = capacity() - offset;
+        const uint64_t total = footprint(len);
+        if( pos_ + total > limit_ ) {
+            limit_ = hdr_->head.load(std::memory_order_acquire) + capacity();
+            if( pos_ + total > limit_ ) {
+                return false;
+            }
+        }
+        uint64_t pos = pos_;
+        if( tail_room < need ) {
+            std::memcpy(data_ + offset, &kSkip, sizeof(kSkip));
+            pos += tail_room;
+        }
+        unsigned char* rec = data_ + (pos & mask_);
+        const uint32_t len32 = static_cast<uint32_t>(len);
+        std::memcpy(rec, &len32, sizeof(len32));
+        std::memcpy(rec + kRecordHeader, data, len);
+        pos_ = pos + need;
+        hdr_->tail.store(pos_, std::memory_order_release);
+        // Pairs with the fence in wait_data().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if( hdr_->consumer_waiting.load(std::memory_order_relaxed) ) {
+            wake_consumer();
+        }
+        return true;
+    }
+
+    //! Waits up to `timeout` for room for a record of `len` bytes.
+    //! Returns false on timeout.
+    bool wait_space(size_t len, std::chrono::nanoseconds timeout) {
+        const uint64_t need = footprint(len);
+        const uint32_t seq = hdr_->space_seq.load(std::memory_order_acquire);
+        hdr_->producer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready = pos_ + need <= hdr_->head.load(std::memory_order_acquire) + capacity();
+        if( !ready ) {
+            details::futex_wait(hdr_->space_seq, seq, timeout);
+            ready = pos_ + need <= hdr_->head.load(std::memory_order_acquire) + capacity();
+        }
+        hdr_->producer_waiting.store(0, std::memory_order_relaxed);
+        return ready;
+    }
+
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     *                             Consumer
+     *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+private:
+    //! Publishes the head, waking a producer waiting for room.
+    void release_space() {
+        hdr_->head.store(pos_, std::memory_order_release);
+        // Pairs with the fence in wait_space(). The producer is woken
+        // once, when half of the ring is free, to batch its writes.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if( hdr_->producer_waiting.load(std::memory_order_relaxed)
+            && (limit_ - pos_ <= capacity() / 2 || pos_ == hdr_->tail.load(std::memory_order_acquire))
+            && hdr_->producer_waiting.exchange(0) ) {
+            hdr_->space_seq.fetch_add(1, std::memory_order_release);
+            details::futex_wake(hdr_->space_seq);
+        }
+    }
+
+    //! Drops all published data after a malformed record.
+    bool discard() {
+        fault_ = true;
+        pos_ = limit_ = hdr_->tail.load(std::memory_order_acquire);
+        release_space();
+        return false;
+    }
+
+public:
+
+    //! Calls `fn(const void* data, size_t len)` for the next record, in place.
+    //! Returns false if the ring is empty. A record with a bad length
+    //! or a tail out of range (a faulty or hostile producer) is never
+    //! passed to `fn`: everything published is dropped, see take_fault().
+    template <typename TFunc>
+    bool try_pop(TFunc&& fn) {
+        for(;;) {
+            if( pos_ == limit_ ) {
+                limit_ = hdr_->tail.load(std::memory_order_acquire);
+                if( pos_ == limit_ ) {
+                    return false;
+                }
+            }
+            if( limit_ - pos_ > capacity() ) {
+                return discard();
+            }
+            const uint64_t offset = pos_ & mask_;
+            uint32_t len;
+            std::memcpy(&len, data_ + offset, sizeof(len));
+            if( len == kSkip ) {
+                pos_ += capacity() - offset;
+                continue;
+            }
+            if( len > max_record()
+                || record_size(len) > capacity() - offset
+                || record_size(len) > limit_ - pos_ ) {
+                return discard();
+            }
+            fn(static_cast<const void*>(data_ + offset + kRecordHeader), static_cast<size_t>(len));
+            pos_ += record_size(len);
+            release_space();
+            return true;
+        }
+    }
+
+    //! True once after try_pop() has dropped malformed data.
+    bool take_fault() {
+        return std::exchange(fault_, false);
+    }
+
+    //! Announces that the consumer is about to sleep.
+    //! Returns the futex value to pass to wait_data().
+    uint32_t prepare_wait() {
+        const uint32_t seq = hdr_->data_seq.load(std::memory_order_acquire);
+        hdr_->consumer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return seq;
+    }
+
+    bool empty() const {
+        return pos_ == hdr_->tail.load(std::memory_order_acquire);
+    }
+
+    //! Sleeps until woken or `timeout`, after prepare_wait() and a check
+    //! that there is still nothing to do.
+    void wait_data(uint32_t seq, std::chrono::nanoseconds timeout) {
+        details::futex_wait(hdr_->data_seq, seq, timeout);
+        hdr_->consumer_waiting.store(0, std::memory_order_relaxed);
+    }
+
+    //! Cancels prepare_wait().
+    void cancel_wait() {
+        hdr_->consumer_waiting.store(0, std::memory_order_relaxed);
+    }
+
+    //! Wakes the consumer if it sleeps in wait_data(), from any thread or process.
+    void wake_consumer() {
+        if( hdr_->consumer_waiting.exchange(0) ) {
+            hdr_->data_seq.fetch_add(1, std::memory_order_release);
+            details::futex_wake(hdr_->data_seq);
+        }
+    }
+
+    //! Whether the consumer may be sleeping: call wake_consumer() after
+    //! making work for it visible.
+    bool consumer_waiting() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return hdr_->consumer_waiting.load(std::memory_order_relaxed) != 0;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                        Typed messages
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      ShmSender
+ * @brief      Sends fixed-size messages to a ShmWorker in another process.
+ *
+ * @details    TMessage is copied byte-wise, so it must be trivially
+ * copyable and must not contain pointers.
+ */
+template <typename TMessage>
+class ShmSender {
+    static_assert(std::is_trivially_copyable_v<TMessage>, "ShmSender needs a trivially copyable message");
+
+    std::unique_ptr<ShmRing> ring_;
+    std::chrono::nanoseconds peer_check_;
+
+public:
+    //! How often a full ring is checked for a dead consumer.
+    static constexpr MilliSec kDefaultPeerCheck{100};
+
+    explicit ShmSender(std::unique_ptr<ShmRing> ring, MilliSec peer_check = kDefaultPeerCheck)
+        : ring_{std::move(ring)}
+        , peer_check_{peer_check}
+    {}
+
+    //! Opens the segment `name` and attaches as the producer.
+    static Expected<ShmSender> connect(const std::string& name, MilliSec peer_check = kDefaultPeerCheck) {
+        auto ring = ShmRing::open(name);
+        if( !ring ) {
+            return ring.error();
+        }
+        if( auto result = (*ring)->attach(ShmRole::Producer); !result ) {
+            return result;
+        }
+        return ShmSender(std::move(*ring), peer_check);
+    }
+
+    //! Waits while the ring is full.
+    //! Returns false if the consumer process has died.
+    bool send(const TMessage& msg) {
+        while( !ring_->try_push(&msg, sizeof(msg)) ) {
+            if( !ring_->wait_space(sizeof(msg), peer_check_) && !ring_->peer_alive() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Returns false if the ring is full.
+    bool try_send(const TMessage& msg) {
+        return ring_->try_push(&msg, sizeof(msg));
+    }
+
+    ShmRing& ring() { return *ring_; }
+};
+
+
+/**
+ * @class      ShmWorker
+ * @brief      A Worker that also receives messages from a ShmRing.
+ *
+ * @details    Local send() and the ring are served by the same message
+ * loop, woken through the futex of the ring. Remote messages skip the
+ * local queue. If the producer process dies or writes a malformed
+ * record, on_peer_lost() is called on the worker thread and a new
+ * producer may attach. QUIT messages from the ring are dropped: only
+ * the owner of the worker stops it, with terminate().
+ *
+ * Exports `tec_shm_received_total` and `tec_shm_peer_lost_total`,
+ * labelled `worker`.
+ */
+template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec,
+          typename TStats = NoStats>
+class ShmWorker: public Worker<TWorkerParams, TMessage, Duration, TStats> {
+    static_assert(std::is_trivially_copyable_v<TMessage>, "ShmWorker needs a trivially copyable message");
+
+public:
+    using Base = Worker<TWorkerParams, TMessage, Duration, TStats>;
+    using TimerClock = typename Base::TimerClock;
+
+    //! How often an idle worker checks for a dead producer.
+    static constexpr MilliSec kDefaultPeerCheck{100};
+
+protected:
+    using Envelope = typename Base::Envelope;
+
+private:
+    std::unique_ptr<ShmRing> ring_;
+    std::chrono::nanoseconds peer_check_;
+    bool peer_lost_;
+    unsigned streak_;
+
+    static constexpr unsigned kLocalEvery{32};
+
+    std::shared_ptr<metrics::Counter> m_received_;
+    std::shared_ptr<metrics::Counter> m_peer_lost_;
+
+public:
+    ShmWorker(const TWorkerParams& params, std::unique_ptr<ShmRing> ring,
+              Launch launch = Launch::Eager, MilliSec peer_check = kDefaultPeerCheck)
+        : Base(params, launch)
+        , ring_{std::move(ring)}
+        , peer_check_{peer_check}
+        , peer_lost_{false}
+        , streak_{0}
+        , m_received_{metrics::registry().instance<metrics::Counter>(
+                "tec_shm_received_total", "Messages received from shared memory.",
+                metrics::label("worker", this->name_))}
+        , m_peer_lost_{metrics::registry().instance<metrics::Counter>(
+                "tec_shm_peer_lost_total", "Producer processes found dead.",
+                metrics::label("worker", this->name_))}
+    {}
+
+    virtual ~ShmWorker() {
+        // Stop the loop while the overrides below still exist.
+        if( this->thread_.joinable() ) {
+            this->terminate();
+        }
+    }
+
+    //! Attaches as the consumer of the ring, then starts the worker.
+    Result run() override {
+        if( !ring_ ) {
+            return {"no ShmRing", Result::Kind::Invalid};
+        }
+        if( auto result = ring_->attach(ShmRole::Consumer); !result ) {
+            return result;
+        }
+        return Base::run();
+    }
+
+    bool send(const TMessage& msg) override {
+        if( !Base::send(msg) ) {
+            return false;
+        }
+        if( ring_->consumer_waiting() ) {
+            ring_->wake_consumer();
+        }
+        return true;
+    }
+
+    ShmRing& ring() { return *ring_; }
+
+protected:
+    //! Called on the worker thread when the producer process has died.
+    virtual void on_peer_lost() {
+    }
+
+    bool next_message(Envelope& env, typename TimerClock::time_point deadline) override {
+        // The local queue is looked at every kLocalEvery remote messages,
+        // sparing its mutex while the ring streams.
+        if( streak_ < kLocalEvery && pop(env) ) {
+            ++streak_;
+            return true;
+        }
+        streak_ = 0;
+        if( this->mq_.try_dequeue(env) || pop(env) ) {
+            return true;
+        }
+        const uint32_t seq = ring_->prepare_wait();
+        if( this->mq_.try_dequeue(env) || pop(env) ) {
+            ring_->cancel_wait();
+            return true;
+        }
+        auto timeout = peer_check_;
+        bool timers_due{false};
+        if( deadline != TimerClock::time_point::max() ) {
+            const auto left = deadline - TimerClock::now();
+            if( left < timeout ) {
+                timeout = left > left.zero()
+                    ? std::chrono::duration_cast<std::chrono::nanoseconds>(left)
+                    : std::chrono::nanoseconds{0};
+                timers_due = true;
+            }
+        }
+        ring_->wait_data(seq, timeout);
+        if( !timers_due && ring_->empty() && this->mq_.size() == 0 ) {
+            check_peer();
+        }
+        return this->mq_.try_dequeue(env) || pop(env);
+    }
+
+private:
+    bool pop(Envelope& env) {
+        bool taken{false};
+        // Records of another size and QUIT messages are skipped.
+        while( !taken && ring_->try_pop([&](const void* data, size_t len) {
+            if( len == sizeof(TMessage) ) {
+                TMessage msg;
+                std::memcpy(&msg, data, sizeof(msg));
+                if( !msg.quit() ) {
+                    env = TStats::wrap(msg);
+                    taken = true;
+                }
+            }
+        }) ) {
+        }
+        if( taken ) {
+            m_received_->inc();
+            peer_lost_ = false;
+        }
+        else if( ring_->take_fault() ) {
+            // A producer writing garbage is as good as dead.
+            lose_peer();
+        }
+        return taken;
+    }
+
+    void check_peer() {
+        if( !ring_->peer_alive() ) {
+            lose_peer();
+        }
+    }
+
+    void lose_peer() {
+        if( !peer_lost_ ) {
+            peer_lost_ = true;
+            m_peer_lost_->inc();
+            on_peer_lost();
+        }
+    }
+};
+
+
+} // ::tec
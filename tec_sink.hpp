@@ -0,0 +1,348 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_sink.hpp
+ *   @brief Buffered, asynchronous and null output sinks.
+ *
+ *  The abstract Sink and the current sink accessors are declared in
+ *  tec_utils.hpp. Install a sink with tec::set_sink() to redirect
+ *  print()/println() and the Tracer:
+ *
+ *  @code
+ *  tec::StdoutSink out;
+ *  tec::set_sink(&out);
+ *  tec::install_flush_handlers();
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+
+#if !defined(__TEC_WINDOWS__)
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace tec {
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Null Sink
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Discards everything.
+class NullSink: public Sink {
+public:
+    void write(const char*, size_t) override {}
+};
+
+
+#if !defined(__TEC_WINDOWS__)
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                     File descriptor sinks
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct SinkParams {
+    //! Default buffer size (64 Kb).
+    static constexpr const size_t kBufferSize{64 * 1024};
+    //! Default flush interval.
+    static constexpr const MilliSec kFlushInterval{100};
+    //! Default limit of pending data for async sinks (16 Mb).
+    static constexpr const size_t kMaxPending{16 * 1024 * 1024};
+
+    size_t buffer_size;       //!< Flush when that many bytes are buffered.
+    MilliSec flush_interval;  //!< Flush buffered data not later than that.
+    size_t max_pending;       //!< Async sinks drop lines above this limit.
+
+    SinkParams()
+        : buffer_size(kBufferSize)
+        , flush_interval(kFlushInterval)
+        , max_pending(kMaxPending)
+    {}
+};
+
+
+namespace details {
+
+//! Writes the whole buffer to `fd`, retrying on EINTR and partial writes.
+inline bool write_fd(int fd, const char* data, size_t len) {
+    while( len > 0 ) {
+        ssize_t n = ::write(fd, data, len);
+        if( n < 0 ) {
+            if( errno == EINTR ) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // ::details
+
+
+/**
+ * @class      FdSink
+ * @brief      Double-buffered sink writing to a file descriptor.
+ *
+ * @details    Lines are accumulated in the front buffer; the flusher
+ * thread swaps buffers and issues a single write(2) when `flush_interval`
+ * expires. In the synchronous mode the writer thread flushes
+ * by itself as soon as `buffer_size` is reached, in the asynchronous mode
+ * it only wakes the flusher up and never blocks on I/O.
+ */
+class FdSink: public Sink {
+public:
+    enum class Mode { Sync, Async };
+
+protected:
+    using Lock = std::lock_guard<std::mutex>;
+    using ULock = std::unique_lock<std::mutex>;
+
+    int fd_;
+    bool own_fd_;
+    Mode mode_;
+    SinkParams params_;
+
+    //! Front buffer synchronization.
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::string front_;
+    bool stop_;
+    size_t dropped_;
+
+    //! Serializes write(2) calls, the back buffer is guarded by it.
+    std::mutex mtx_io_;
+    std::string back_;
+
+    std::thread flusher_;
+
+public:
+    FdSink(int fd, bool own_fd, Mode mode, const SinkParams& params = {})
+        : fd_{fd}
+        , own_fd_{own_fd}
+        , mode_{mode}
+        , params_{params}
+        , stop_{false}
+        , dropped_{0}
+    {
+        front_.reserve(params_.buffer_size);
+        back_.reserve(params_.buffer_size);
+        flusher_ = std::thread([this]{ flusher_proc(); });
+    }
+
+    virtual ~FdSink() {
+        // No new writer may find the sink while it is torn down.
+        detach();
+        {
+            Lock lk(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        flusher_.join();
+        flush();
+        if( own_fd_ && fd_ >= 0 ) {
+            ::close(fd_);
+        }
+    }
+
+    //! File descriptor, negative if the sink failed to open.
+    int fd() const { return fd_; }
+
+    //! Number of bytes dropped because of `max_pending` overflow (async mode only).
+    size_t dropped() {
+        Lock lk(mtx_);
+        return dropped_;
+    }
+
+    void write(const char* data, size_t len) override {
+        bool flush_now{false};
+        bool wake{false};
+        {
+            Lock lk(mtx_);
+            if( mode_ == Mode::Async && front_.size() + len > params_.max_pending ) {
+                dropped_ += len;
+                return;
+            }
+            wake = front_.empty();
+            front_.append(data, len);
+            if( front_.size() >= params_.buffer_size ) {
+                flush_now = (mode_ == Mode::Sync);
+                wake = wake || (mode_ == Mode::Async);
+            }
+        }
+        if( flush_now ) {
+            flush();
+        }
+        else if( wake ) {
+            cv_.notify_one();
+        }
+    }
+
+    void flush() override {
+        Lock lk_io(mtx_io_);
+        {
+            Lock lk(mtx_);
+            front_.swap(back_);
+        }
+        if( !back_.empty() ) {
+            details::write_fd(fd_, back_.data(), back_.size());
+            back_.clear();
+        }
+    }
+
+    //! Writes the front buffer unless it is being modified right now.
+    void emergency_flush() override {
+        if( mtx_.try_lock() ) {
+            details::write_fd(fd_, front_.data(), front_.size());
+            front_.clear();
+            mtx_.unlock();
+        }
+    }
+
+private:
+    void flusher_proc() {
+        ULock lk(mtx_);
+        while( !stop_ ) {
+            // Sleep until something is buffered.
+            cv_.wait(lk, [this]{ return stop_ || !front_.empty(); });
+            if( stop_ ) {
+                break;
+            }
+            // Give the buffer a chance to fill up, unless it is full already.
+            cv_.wait_for(lk, params_.flush_interval, [this]{
+                return stop_ || front_.size() >= params_.buffer_size; });
+            lk.unlock();
+            flush();
+            lk.lock();
+        }
+    }
+};
+
+
+//! Buffered stdout, flushed by size or time.
+class StdoutSink: public FdSink {
+public:
+    StdoutSink(const SinkParams& params = {})
+        : FdSink(STDOUT_FILENO, false, Mode::Sync, params)
+    {
+        // Keep the order with what has been written to std::cout before.
+        std::cout.flush();
+    }
+};
+
+
+//! Asynchronous file sink, appends to the file.
+//! Check fd() to see whether the file has been opened successfully.
+class FileSink: public FdSink {
+public:
+    FileSink(const std::string& path, const SinkParams& params = {})
+        : FdSink(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644),
+                 true, Mode::Async, params)
+    {}
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                 Flushing on exit and fatal signals
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+namespace details {
+
+//! Actions replaced by install_flush_handlers(), indexed by signal.
+inline struct sigaction flush_old_actions[NSIG];
+
+inline void flush_on_exit() {
+    sink()->flush();
+}
+
+inline void flush_on_signal(int sig) {
+    // sink() may initialize a static: read the pointer itself.
+    if( Sink* s = sink_holder::current.load(std::memory_order_acquire) ) {
+        s->emergency_flush();
+    }
+    // Restore the previous action and re-raise: it runs as soon as
+    // this handler returns, be it the default one or a chained handler.
+    ::sigaction(sig, &flush_old_actions[sig], nullptr);
+    ::raise(sig);
+}
+
+} // ::details
+
+
+/**
+ * @brief      Flushes the current sink at exit() and on fatal signals.
+ *
+ * @details    Installs handlers for SIGSEGV, SIGBUS, SIGFPE, SIGILL and
+ * SIGABRT, plus SIGTERM and SIGINT if `termination` is set. Each handler
+ * makes a best-effort emergency_flush(), then restores the handler it
+ * replaced and re-raises the signal, so a previously installed handler
+ * still runs (once) and the default action still applies.
+ * Call it once, after the sink and the application handlers are set.
+ */
+inline void install_flush_handlers(bool termination = false) {
+    static bool installed{false};
+    if( installed ) {
+        return;
+    }
+    installed = true;
+
+    std::atexit(&details::flush_on_exit);
+
+    struct sigaction sa{};
+    sa.sa_handler = &details::flush_on_signal;
+    sigfillset(&sa.sa_mask);
+    for( int sig: {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM, SIGINT} ) {
+        if( !termination && (sig == SIGTERM || sig == SIGINT) ) {
+            continue;
+        }
+        ::sigaction(sig, &sa, &details::flush_old_actions[sig]);
+    }
+}
+
+#endif // !__TEC_WINDOWS__
+
+
+} // ::tec
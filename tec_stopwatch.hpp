@@ -0,0 +1,245 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_stopwatch.hpp
+ *   @brief High-resolution stopwatch.
+ *
+ *  Reads the CPU Time Stamp Counter when it is invariant (x86-64),
+ *  otherwise CLOCK_MONOTONIC_RAW. Laps can be fed into a tec::Histogram:
+ *
+ *  @code
+ *  tec::Histogram hist;
+ *  void process(const Message& msg) {
+ *      tec::ScopedLap lap(hist);
+ *      ...
+ *  }
+ *  ...
+ *  tec::println("process(): {}", hist.summary());
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_histogram.hpp"
+
+#if defined(__x86_64__) && !defined(__TEC_WINDOWS__)
+  #include <cpuid.h>
+  #include <x86intrin.h>
+  #define __TEC_HAS_TSC__ 1
+#endif
+
+#if !defined(__TEC_WINDOWS__)
+  #include <time.h>
+#endif
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                              Clocks
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! CLOCK_MONOTONIC_RAW (steady_clock on Windows), ticks are nanoseconds.
+struct MonoClock {
+    static uint64_t ticks() {
+#if defined(__TEC_WINDOWS__)
+        return static_cast<uint64_t>(Now<NanoSec>().count());
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+    }
+
+    static double ns_per_tick() { return 1.0; }
+};
+
+
+/**
+ * @class      TscClock
+ * @brief      CPU Time Stamp Counter.
+ *
+ * @details    Usable only if available() returns `true` (x86-64 with
+ * invariant TSC). The tick period is calibrated against MonoClock
+ * once, on the first call to ns_per_tick(); call calibrate() at startup
+ * to avoid the ~10 ms delay on a hot path.
+ */
+struct TscClock {
+    //! Is invariant TSC supported?
+    static bool available() {
+#if defined(__TEC_HAS_TSC__)
+        static const bool __invariant = []{
+            unsigned eax, ebx, ecx, edx;
+            if( !__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ) {
+                return false;
+            }
+            return (edx & (1u << 8)) != 0;
+        }();
+        return __invariant;
+#else
+        return false;
+#endif
+    }
+
+    //! Reads TSC, waiting for all previous instructions to complete.
+    static uint64_t ticks() {
+#if defined(__TEC_HAS_TSC__)
+        unsigned aux;
+        return __rdtscp(&aux);
+#else
+        return MonoClock::ticks();
+#endif
+    }
+
+    //! Measures the TSC period over `dur`.
+    static double calibrate(MilliSec dur = MilliSec{10}) {
+        const uint64_t ns0 = MonoClock::ticks();
+        const uint64_t t0 = ticks();
+        const uint64_t wait_ns = static_cast<uint64_t>(NanoSec{dur}.count());
+        uint64_t ns1;
+        do {
+            ns1 = MonoClock::ticks();
+        } while( ns1 - ns0 < wait_ns );
+        const uint64_t t1 = ticks();
+        return (t1 > t0) ? static_cast<double>(ns1 - ns0) / static_cast<double>(t1 - t0) : 1.0;
+    }
+
+    static double ns_per_tick() {
+        static const double __period = calibrate();
+        return __period;
+    }
+};
+
+
+//! TSC if it is invariant, otherwise CLOCK_MONOTONIC_RAW.
+struct FastClock {
+    static bool use_tsc() {
+        static const bool __tsc = TscClock::available();
+        return __tsc;
+    }
+
+    static uint64_t ticks() {
+        return use_tsc() ? TscClock::ticks() : MonoClock::ticks();
+    }
+
+    static double ns_per_tick() {
+        return use_tsc() ? TscClock::ns_per_tick() : MonoClock::ns_per_tick();
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Stopwatch
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      BasicStopwatch
+ * @brief      Nanosecond stopwatch with laps.
+ *
+ * @details    If a histogram is attached, every lap is recorded into it.
+ * Not thread-safe, use one stopwatch per thread.
+ */
+template <typename TClock = FastClock>
+class BasicStopwatch {
+    uint64_t start_;
+    uint64_t last_;
+    double ns_per_tick_;
+    Histogram* hist_;
+
+    uint64_t to_ns(uint64_t ticks) const {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick_);
+    }
+
+public:
+    //! Starts the stopwatch.
+    explicit BasicStopwatch(Histogram* hist = nullptr)
+        : ns_per_tick_{TClock::ns_per_tick()}
+        , hist_{hist}
+    {
+        start();
+    }
+
+    //! Restarts the stopwatch.
+    void start() { start_ = last_ = TClock::ticks(); }
+
+    //! Returns nanoseconds since the previous lap (or start), records them if a histogram is attached.
+    uint64_t lap() {
+        const uint64_t now = TClock::ticks();
+        const uint64_t ns = to_ns(now - last_);
+        last_ = now;
+        if( hist_ ) {
+            hist_->record(ns);
+        }
+        return ns;
+    }
+
+    //! Returns nanoseconds since start().
+    uint64_t elapsed() const { return to_ns(TClock::ticks() - start_); }
+
+    //! Returns elapsed time as Duration.
+    template <typename Duration = NanoSec>
+    Duration elapsed_as() const {
+        return std::chrono::duration_cast<Duration>(NanoSec{elapsed()});
+    }
+
+    //! Attached histogram, may be `nullptr`.
+    Histogram* histogram() const { return hist_; }
+};
+
+using Stopwatch = BasicStopwatch<>;
+
+
+//! Records the lifetime of the scope into a histogram.
+//! THistogram is tec::Histogram or anything with `record(uint64_t)`, e.g. tec::metrics::Histogram.
+template <typename THistogram = Histogram, typename TClock = FastClock>
+class BasicScopedLap {
+    THistogram& hist_;
+    BasicStopwatch<TClock> sw_;
+
+public:
+    explicit BasicScopedLap(THistogram& hist)
+        : hist_{hist}
+    {}
+
+    BasicScopedLap(const BasicScopedLap&) = delete;
+    BasicScopedLap& operator = (const BasicScopedLap&) = delete;
+
+    ~BasicScopedLap() { hist_.record(sw_.elapsed()); }
+};
+
+using ScopedLap = BasicScopedLap<>;
+
+
+} // ::tec
@@ -0,0 +1,197 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_thread.hpp
+ *   @brief Placement, scheduling and naming of the calling thread.
+ *
+ *  All functions act on the calling thread and return a tec::Result
+ *  of Kind::System carrying `errno` on failure. CPU affinity, scheduling
+ *  policies and per-thread nice are Linux only; elsewhere requesting them
+ *  is an error, while an empty request always succeeds.
+ *
+*/
+
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+
+#if !defined(__TEC_WINDOWS__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                       Thread attributes
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! Scheduling policy.
+enum class SchedPolicy {
+    Inherit,     //!< Keep the policy of the creating thread.
+    Other,       //!< SCHED_OTHER, time sharing.
+    Batch,       //!< SCHED_BATCH, CPU-bound, no interactivity boost.
+    Idle,        //!< SCHED_IDLE, lowest priority.
+    Fifo,        //!< SCHED_FIFO, real time, needs CAP_SYS_NICE.
+    RoundRobin,  //!< SCHED_RR, real time, needs CAP_SYS_NICE.
+};
+
+
+namespace details {
+
+inline Result errno_result(const char* what, int err = errno) {
+    return {err, format("{}: {}", what, std::strerror(err)), Result::Kind::System};
+}
+
+inline Result not_supported(const char* what) {
+    return {format("{} is not supported on this platform", what), Result::Kind::System};
+}
+
+} // ::details
+
+
+//! Pins the calling thread to `cpus`; empty means no change.
+inline Result set_thread_affinity(const std::vector<int>& cpus) {
+    if( cpus.empty() ) {
+        return {};
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for( int cpu: cpus ) {
+        if( cpu < 0 || cpu >= CPU_SETSIZE ) {
+            return {format("invalid CPU {}", cpu), Result::Kind::Invalid};
+        }
+        CPU_SET(cpu, &set);
+    }
+    if( int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0 ) {
+        return details::errno_result("pthread_setaffinity_np()", err);
+    }
+    return {};
+#else
+    return details::not_supported("CPU affinity");
+#endif
+}
+
+
+//! CPUs the calling thread may run on.
+inline std::vector<int> get_thread_affinity() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if( pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0 ) {
+        for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+            if( CPU_ISSET(cpu, &set) ) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+
+/**
+ * @brief      Sets scheduling of the calling thread.
+ *
+ * @param      policy Scheduling policy, Inherit leaves it unchanged.
+ * @param      priority Real-time priority 1..99 for Fifo and RoundRobin, ignored otherwise.
+ * @param      nice Nice value -20..19 of the thread, if set.
+ * @return     Result
+ */
+inline Result set_thread_sched(SchedPolicy policy, int priority, std::optional<int> nice) {
+#if defined(__linux__)
+    if( policy != SchedPolicy::Inherit ) {
+        int pol{SCHED_OTHER};
+        switch (policy) {
+        case SchedPolicy::Batch: pol = SCHED_BATCH; break;
+        case SchedPolicy::Idle: pol = SCHED_IDLE; break;
+        case SchedPolicy::Fifo: pol = SCHED_FIFO; break;
+        case SchedPolicy::RoundRobin: pol = SCHED_RR; break;
+        default: break;
+        }
+        sched_param sp{};
+        sp.sched_priority = (pol == SCHED_FIFO || pol == SCHED_RR) ? priority : 0;
+        if( int err = pthread_setschedparam(pthread_self(), pol, &sp); err != 0 ) {
+            return details::errno_result("pthread_setschedparam()", err);
+        }
+    }
+    if( nice ) {
+        // On Linux nice is a per-thread attribute addressed by TID.
+        const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+        if( ::setpriority(PRIO_PROCESS, tid, *nice) != 0 ) {
+            return details::errno_result("setpriority()");
+        }
+    }
+    return {};
+#else
+    if( policy != SchedPolicy::Inherit || nice ) {
+        return details::not_supported("Thread scheduling");
+    }
+    return {};
+#endif
+}
+
+
+//! Names the calling thread as shown by `top -H`, perf and debuggers.
+//! Linux truncates names to 15 characters.
+inline Result set_thread_name(const std::string& name) {
+    if( name.empty() ) {
+        return {};
+    }
+#if defined(__linux__)
+    const std::string truncated = name.substr(0, 15);
+    if( int err = pthread_setname_np(pthread_self(), truncated.c_str()); err != 0 ) {
+        return details::errno_result("pthread_setname_np()", err);
+    }
+    return {};
+#elif defined(__APPLE__)
+    if( int err = pthread_setname_np(name.c_str()); err != 0 ) {
+        return details::errno_result("pthread_setname_np()", err);
+    }
+    return {};
+#else
+    return {};
+#endif
+}
+
+
+} // ::tec
@@ -27,12 +27,14 @@ SOFTWARE.
  *   @brief A simple tracer utilities.
  *
  * Define `_TEC_TRACE_ON` to enable tracing.
+ * Trace lines go to the current sink, see tec::set_sink().
  *
 */
 
 #pragma once
 
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <mutex>
 
@@ -66,34 +68,50 @@ class Tracer {
 
     std::string name_;
 
+    static void emit(std::ostream* out, const std::ostringstream& buf) {
+        *out << buf.str();
+    }
+
+    static void emit(Sink* out, const std::ostringstream& buf) {
+        const auto& line = buf.str();
+        out->write(line.data(), line.size());
+    }
+
 public:
 
     Tracer(const char* name):
         name_{name} {}
 
 
-    void enter(std::ostream* out) {
+    template<typename TOut>
+    void enter(TOut* out) {
         Lock lk(details::trace_mutex::mtx());
         auto tp = Now<Duration>();
-        *out << "[" << tp.count() << "] * " << name_ << " entered.\n";
+        auto& buf = details::line_buffer();
+        buf << "[" << tp.count() << "] * " << name_ << " entered.\n";
+        emit(out, buf);
     }
 
 
-    template<typename T>
-    void trace(std::ostream* out, const T& arg) {
+    template<typename TOut, typename T>
+    void trace(TOut* out, const T& arg) {
         Lock lk(details::trace_mutex::mtx());
         auto tp = Now<Duration>().count();
-        *out << "[" << tp << "] " << name_ << ": ";
-        println<>(out, arg);
+        auto& buf = details::line_buffer();
+        buf << "[" << tp << "] " << name_ << ": ";
+        println<>(&buf, arg);
+        emit(out, buf);
     }
 
 
-    template<typename T, typename... Targs>
-    void trace(std::ostream* out, const char* fmt, const T& value, Targs&&... Args) {
+    template<typename TOut, typename T, typename... Targs>
+    void trace(TOut* out, const char* fmt, const T& value, Targs&&... Args) {
         Lock lk(details::trace_mutex::mtx());
         auto tp = Now<Duration>().count();
-        *out << "[" << tp << "] " << name_ << ": ";
-        println<>(out, fmt, value, Args...);
+        auto& buf = details::line_buffer();
+        buf << "[" << tp << "] " << name_ << ": ";
+        println<>(&buf, fmt, value, Args...);
+        emit(out, buf);
     }
 
 }; // ::Tracer
@@ -111,12 +129,12 @@ public:
 
 #if defined(__TEC_WINDOWS__)
   // Windows-specific version of TEC_ENTER.
-  #define TEC_ENTER(name) Tracer<> tracer__(name); tracer__.enter(&std::cout)
+  #define TEC_ENTER(name) Tracer<> tracer__(name); tracer__.enter(tec::sink())
 #else
-  #define TEC_ENTER(name) tec::Tracer<> tracer__(name); tracer__.enter(&std::cout)
+  #define TEC_ENTER(name) tec::Tracer<> tracer__(name); tracer__.enter(tec::sink())
 #endif
 
-#define TEC_TRACE(...)  tracer__.trace(&std::cout, __VA_ARGS__)
+#define TEC_TRACE(...)  tracer__.trace(tec::sink(), __VA_ARGS__)
 
 #else
 // No trace, please.
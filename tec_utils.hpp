@@ -29,17 +29,30 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <linux/limits.h>
+#include <new>
 #include <optional>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include "tec/tec_def.hpp" // IWYU pragma: keep
 
+#if !defined(__TEC_WINDOWS__)
+#include <unistd.h>
+#include <pwd.h>
+#endif
+
 
 namespace tec {
 
@@ -58,6 +71,10 @@ using TimePointMs = std::chrono::time_point<Clock, MilliSec>;
 using MicroSec = std::chrono::microseconds;
 using TimePointMu = std::chrono::time_point<Clock, MicroSec>;
 
+//! Nanoseconds.
+using NanoSec = std::chrono::nanoseconds;
+using TimePointNs = std::chrono::time_point<Clock, NanoSec>;
+
 //! Returns now() as Duration.
 template <typename Duration>
 Duration Now() { return std::chrono::duration_cast<Duration>(Clock::now() - std::chrono::time_point<Clock, Duration>()); }
@@ -70,6 +87,7 @@ Duration Since(Duration start) { return Now<Duration>() - start; }
 constexpr const char* time_unit(Seconds) { return "s"; }
 constexpr const char* time_unit(MilliSec) { return "ms"; }
 constexpr const char* time_unit(MicroSec) { return "mu"; }
+constexpr const char* time_unit(NanoSec) { return "ns"; }
 
 //! Some duration constants.
 constexpr const Seconds one_hour() { return Seconds(60 * 60); }
@@ -84,7 +102,18 @@ constexpr const Seconds one_day() { return Seconds(24 * 60 * 60); }
 
 /**
  * @class TResult
- * @brief Declares an abstract
+ * @brief Declares a compact result of execution.
+ *
+ * @details TResult has no vtable: the error class, an optional code
+ * and the description fit in 16 bytes with `ECode = int`. A
+ * description is either
+ *
+ * - a string literal (or a Literal), stored by pointer without copying;
+ * - any other string, copied once into a reference-counted block shared
+ *   by the copies of the result.
+ *
+ * Copying a result without a dynamic description is a plain copy.
+ *
  * @include{cpp} ex1.cpp
  */
 template <typename ECode=int, typename EDesc=std::string>
@@ -95,7 +124,7 @@ struct TResult {
     };
 
     //! Error classes
-    enum class Kind: int {
+    enum class Kind: std::uint8_t {
         Ok  //!< Success
         , Err        //!< Generic error
         , IOErr      //!< IO failure
@@ -107,25 +136,203 @@ struct TResult {
         , System     //!< System error
     };
 
+    //! A description with static storage duration, stored by pointer:
+    //! `Result{Result::Literal{"no data"}, Result::Kind::Invalid}`.
+    struct Literal {
+        const char* str;
+    };
+
     //! Returns Result::Kind as string.
-    virtual const char* kind_as_string(Kind k) const {
+    static constexpr const char* kind_as_string(Kind k) {
         switch (k) {
-            case Kind::Ok: { static char s0[]{"Success"}; return s0; }
-            case Kind::Err: { static char s1[]{"Generic"}; return s1; }
-            case Kind::IOErr: { static char s2[]{"IO"}; return s2; }
-            case Kind::RuntimeErr: { static char s3[]{"Runtime"}; return s3; }
-            case Kind::NetErr: { static char s3[]{"Network"}; return s3; }
-            case Kind::GrpcErr: { static char s4[]{"gRpc"}; return s4; }
-            case Kind::TimeoutErr: { static char s5[]{"Timeout"}; return s5; }
-            case Kind::Invalid: { static char s6[]{"Invalid"}; return s6; }
-            case Kind::System: { static char s7[]{"System"}; return s7; }
-            default: { static char s8[]{"Unspecified"}; return s8; }
+            case Kind::Ok: return "Success";
+            case Kind::Err: return "Generic";
+            case Kind::IOErr: return "IO";
+            case Kind::RuntimeErr: return "Runtime";
+            case Kind::NetErr: return "Network";
+            case Kind::GrpcErr: return "gRpc";
+            case Kind::TimeoutErr: return "Timeout";
+            case Kind::Invalid: return "Invalid";
+            case Kind::System: return "System";
+            default: return "Unspecified";
         }
     }
 
-    Kind kind;                 //!< Error class.
-    std::optional<ECode> code; //!< Error code (optional).
-    std::optional<EDesc> desc; //!< Error description (optional).
+    /**
+     * @class      Desc
+     * @brief      Optional description, used like `std::optional<EDesc>`.
+     *
+     * @details    String literals are kept by pointer. A mutable char
+     * array may be a local buffer, so it is copied like a std::string.
+     */
+    class Desc {
+        //! A dynamic description: the reference count, then the text.
+        struct Block {
+            std::atomic<uint32_t> refs;
+
+            const char* text() const { return reinterpret_cast<const char*>(this + 1); }
+
+            static Block* create(const char* data, size_t len) {
+                void* p = ::operator new(sizeof(Block) + len + 1);
+                auto* b = new (p) Block{{1}};
+                char* text = reinterpret_cast<char*>(b + 1);
+                std::memcpy(text, data, len);
+                text[len] = '\0';
+                return b;
+            }
+
+            void release() {
+                if( refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+                    this->~Block();
+                    ::operator delete(this);
+                }
+            }
+        };
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+        //! Tags a Block pointer: the top bit of a 64-bit user-space
+        //! address is clear.
+        static constexpr const uintptr_t kBlock{uintptr_t{1} << 63};
+        uintptr_t bits_;
+
+        bool is_block() const { return (bits_ & kBlock) != 0; }
+        Block* block() const { return reinterpret_cast<Block*>(bits_ & ~kBlock); }
+        void set_block(Block* b) { bits_ = reinterpret_cast<uintptr_t>(b) | kBlock; }
+        void set_text(const char* s) { bits_ = reinterpret_cast<uintptr_t>(s); }
+        const char* text() const { return reinterpret_cast<const char*>(bits_); }
+        //! Copies the representation, not the reference.
+        void take(const Desc& other) { bits_ = other.bits_; }
+#else
+        //! No spare pointer bit, but room for a flag in 8 bytes.
+        const void* ptr_;
+        bool is_block_;
+
+        bool is_block() const { return is_block_; }
+        Block* block() const { return static_cast<Block*>(const_cast<void*>(ptr_)); }
+        void set_block(Block* b) { ptr_ = b; is_block_ = true; }
+        void set_text(const char* s) { ptr_ = s; is_block_ = false; }
+        const char* text() const { return static_cast<const char*>(ptr_); }
+        //! Copies the representation, not the reference.
+        void take(const Desc& other) { ptr_ = other.ptr_; is_block_ = other.is_block_; }
+#endif
+
+        void acquire() const {
+            if( is_block() ) {
+                block()->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void release() {
+            if( is_block() ) {
+                block()->release();
+            }
+        }
+
+    public:
+        Desc() { set_text(nullptr); }
+        Desc(Literal desc) { set_text(desc.str); }
+        template <size_t N>
+        Desc(const char (&desc)[N]) { set_text(desc); }
+        template <size_t N>
+        Desc(char (&desc)[N]): Desc(EDesc{desc}) {}
+        Desc(const EDesc& desc) { set_block(Block::create(desc.data(), desc.size())); }
+
+        Desc(const Desc& other) {
+            other.acquire();
+            take(other);
+        }
+
+        Desc(Desc&& other) noexcept {
+            take(other);
+            other.set_text(nullptr);
+        }
+
+        Desc& operator=(const Desc& other) {
+            if( this != &other ) {
+                other.acquire();
+                release();
+                take(other);
+            }
+            return *this;
+        }
+
+        Desc& operator=(Desc&& other) noexcept {
+            if( this != &other ) {
+                release();
+                take(other);
+                other.set_text(nullptr);
+            }
+            return *this;
+        }
+
+        ~Desc() { release(); }
+
+        bool has_value() const { return c_str() != nullptr; }
+        explicit operator bool() const { return has_value(); }
+
+        //! The description, empty if none.
+        EDesc value() const { return has_value() ? EDesc{c_str()} : EDesc{}; }
+        EDesc operator*() const { return value(); }
+
+        template <typename U>
+        EDesc value_or(U&& other) const {
+            return has_value() ? EDesc{c_str()} : EDesc{std::forward<U>(other)};
+        }
+
+        //! No copy; `nullptr` if none.
+        const char* c_str() const { return is_block() ? block()->text() : text(); }
+        std::string_view view() const { return has_value() ? std::string_view{c_str()} : std::string_view{}; }
+    };
+
+    /**
+     * @class      Code
+     * @brief      Optional error code, used like `std::optional<ECode>`.
+     *
+     * @details    Byte-aligned, so the presence flag packs with
+     * TResult::kind instead of padding the code to 8 bytes.
+     */
+    class Code {
+        static_assert(std::is_trivially_copyable_v<ECode>, "ECode must be trivially copyable");
+
+        unsigned char value_[sizeof(ECode)];
+        bool has_;
+
+        void store(const ECode& code) {
+            std::memcpy(value_, &code, sizeof(ECode));
+            has_ = true;
+        }
+
+    public:
+        Code(): value_{}, has_{false} {}
+        Code(std::nullopt_t): Code() {}
+        Code(const ECode& code) { store(code); }
+
+        Code& operator=(const ECode& code) { store(code); return *this; }
+        Code& operator=(std::nullopt_t) { reset(); return *this; }
+
+        bool has_value() const { return has_; }
+        explicit operator bool() const { return has_; }
+        void reset() { has_ = false; }
+
+        //! The code, ECode{} if none.
+        ECode value() const {
+            ECode code{};
+            if( has_ ) {
+                std::memcpy(&code, value_, sizeof(ECode));
+            }
+            return code;
+        }
+        ECode operator*() const { return value(); }
+
+        template <typename U>
+        ECode value_or(U&& other) const {
+            return has_ ? value() : static_cast<ECode>(std::forward<U>(other));
+        }
+    };
+
+    Desc desc; //!< Error description (optional).
+    Code code; //!< Error code (optional).
+    Kind kind; //!< Error class.
 
     //! Is everything OK?
     bool ok() const { return kind == Kind::Ok; }
@@ -134,14 +341,14 @@ struct TResult {
 
     //! Output Result to a stream.
     friend std::ostream& operator << (std::ostream& out, const TResult& result) {
-        out << "[" << result.kind_as_string(result.kind) << "]"
+        out << "[" << kind_as_string(result.kind) << "]"
             << " Code=" << (result.ok() ? ECode{0} : result.code.value_or(ErrCode::Unspecified))
-            << " Desc=\"" << result.desc.value_or("<unspecified>") << "\"";
+            << " Desc=\"" << (result.desc ? result.desc.c_str() : "<unspecified>") << "\"";
         return out;
     }
 
     //! Return Result as string.
-    std::string as_string() {
+    std::string as_string() const {
         std::ostringstream buf;
         buf << *this;
         return buf.str();
@@ -160,20 +367,48 @@ struct TResult {
      * @param      _kind Error class.
      */
     TResult(Kind _kind)
-        : kind{_kind}
-        , code{ErrCode::Unspecified}
+        : code{ErrCode::Unspecified}
+        , kind{_kind}
     {}
 
     /**
      * @brief      Constructs an unspecified error TResult with description.
      *
-     * @param      _desc Error description.
+     * @param      _desc Error description, copied.
      * @param      _kind Error class (default Kind::Err, a generic error).
      */
     TResult(const EDesc& _desc, Kind _kind = Kind::Err)
-        : kind{_kind}
+        : desc{_desc}
+        , code{ErrCode::Unspecified}
+        , kind{_kind}
+    {}
+
+    /**
+     * @brief      Constructs an unspecified error TResult with a string literal.
+     *
+     * @param      _desc Error description, stored by pointer.
+     * @param      _kind Error class (default Kind::Err, a generic error).
+     */
+    template <size_t N>
+    TResult(const char (&_desc)[N], Kind _kind = Kind::Err)
+        : desc{_desc}
+        , code{ErrCode::Unspecified}
+        , kind{_kind}
+    {}
+
+    //! A mutable char array may be a local buffer: copied.
+    template <size_t N>
+    TResult(char (&_desc)[N], Kind _kind = Kind::Err)
+        : desc{_desc}
         , code{ErrCode::Unspecified}
-        , desc{_desc}
+        , kind{_kind}
+    {}
+
+    //! Constructs an unspecified error TResult with static description.
+    TResult(Literal _desc, Kind _kind = Kind::Err)
+        : desc{_desc}
+        , code{ErrCode::Unspecified}
+        , kind{_kind}
     {}
 
     /**
@@ -183,27 +418,143 @@ struct TResult {
      * @param      _kind Error class (default Kind::Err, a generic error).
      */
     TResult(const ECode& _code, Kind _kind = Kind::Err)
-        : kind{_kind}
-        , code{_code}
+        : code{_code}
+        , kind{_kind}
     {}
 
     /**
      * @brief      Constructs an error TResult with description.
      *
      * @param      _code Error code.
+     * @param      _desc Error description, copied.
      * @param      _kind Error class (default Kind::Err, a generic error).
-     * @param      _desc Error description (default std::string).
      */
     TResult(const ECode& _code, const EDesc& _desc, Kind _kind = Kind::Err)
-        : kind{_kind}
+        : desc{_desc}
+        , code{_code}
+        , kind{_kind}
+    {}
+
+    //! Constructs an error TResult with a string literal, stored by pointer.
+    template <size_t N>
+    TResult(const ECode& _code, const char (&_desc)[N], Kind _kind = Kind::Err)
+        : desc{_desc}
+        , code{_code}
+        , kind{_kind}
+    {}
+
+    //! A mutable char array may be a local buffer: copied.
+    template <size_t N>
+    TResult(const ECode& _code, char (&_desc)[N], Kind _kind = Kind::Err)
+        : desc{_desc}
+        , code{_code}
+        , kind{_kind}
+    {}
+
+    //! Constructs an error TResult with a static description.
+    TResult(const ECode& _code, Literal _desc, Kind _kind = Kind::Err)
+        : desc{_desc}
         , code{_code}
-        , desc{_desc}
+        , kind{_kind}
     {}
 
 };
 
 using Result = TResult<>;
 
+static_assert(sizeof(Result) <= 16, "tec::Result must stay compact");
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                 Output sink (see also tec/tec_sink.hpp)
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      Sink
+ * @brief      Declares an abstract output sink.
+ *
+ * @details    Terminal print()/println() and the Tracer write whole lines
+ * to the current sink, see sink() and set_sink(). All methods must be
+ * thread-safe.
+ */
+class Sink {
+public:
+    Sink() = default;
+    Sink(const Sink&) = delete;
+    Sink(Sink&&) = delete;
+    //! Detaches the sink if it is still the current one.
+    virtual ~Sink();
+
+    //! Writes `len` bytes. May buffer them.
+    virtual void write(const char* data, size_t len) = 0;
+
+    //! Writes out all buffered data.
+    virtual void flush() {}
+
+    //! Best-effort flush callable from a signal handler: must not block or allocate.
+    virtual void emergency_flush() {}
+
+protected:
+    //! Unsets the sink if it is the current one. A derived sink calls
+    //! it first thing in its destructor, before tearing anything down.
+    void detach();
+};
+
+
+namespace details {
+
+//! Holds the current sink, `nullptr` means the default one.
+//! A plain atomic, so that a signal handler may read it.
+struct sink_holder {
+    static inline std::atomic<Sink*> current{nullptr};
+
+    static std::atomic<Sink*>& ptr() { return current; }
+};
+
+//! Default sink: writes to std::cout without forcing a flush per line.
+class CoutSink: public Sink {
+public:
+    void write(const char* data, size_t len) override { std::cout.write(data, len); }
+    void flush() override { std::cout.flush(); }
+};
+
+//! Per-thread line buffer reused by terminal output.
+inline std::ostringstream& line_buffer() {
+    thread_local std::ostringstream __buf;
+    __buf.str(std::string{});
+    __buf.clear();
+    return __buf;
+}
+
+} // ::details
+
+
+inline void Sink::detach() {
+    Sink* self = this;
+    details::sink_holder::ptr().compare_exchange_strong(self, nullptr);
+}
+
+inline Sink::~Sink() {
+    detach();
+}
+
+//! Returns the current sink.
+inline Sink* sink() {
+    if( Sink* s = details::sink_holder::ptr().load(std::memory_order_acquire) ) {
+        return s;
+    }
+    static details::CoutSink __cout_sink;
+    return &__cout_sink;
+}
+
+//! Sets the current sink (`nullptr` restores the default one), returns the previous one.
+//! The caller keeps ownership of the sink.
+inline Sink* set_sink(Sink* s) {
+    return details::sink_holder::ptr().exchange(s, std::memory_order_acq_rel);
+}
+
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 *
@@ -229,36 +580,72 @@ void print(std::ostream* out, const char* fmt, const T& value, Targs&&... Args)
     }
 }
 
+//! NOTE: println() doesn't flush the stream, use std::flush explicitly if needed.
 template <typename T>
 void println(std::ostream* out, const T& arg) {
-    *out << arg << std::endl;
+    *out << arg << '\n';
 }
 
 template <typename T, typename... Targs>
 void println(std::ostream* out, const char* fmt, const T& value, Targs&&... Args) {
     print<>(out, fmt, value, Args...);
-    *out << std::endl;
+    *out << '\n';
+}
+
+
+//@{ Output to a sink
+template <typename T>
+void print(Sink* out, const T& arg) {
+    auto& buf = details::line_buffer();
+    print<>(&buf, arg);
+    const auto& line = buf.str();
+    out->write(line.data(), line.size());
 }
 
+template <typename T, typename... Targs>
+void print(Sink* out, const char* fmt, const T& value, Targs&&... Args) {
+    auto& buf = details::line_buffer();
+    print<>(&buf, fmt, value, Args...);
+    const auto& line = buf.str();
+    out->write(line.data(), line.size());
+}
 
-//@{ Output to terminal
+template <typename T>
+void println(Sink* out, const T& arg) {
+    auto& buf = details::line_buffer();
+    println<>(&buf, arg);
+    const auto& line = buf.str();
+    out->write(line.data(), line.size());
+}
+
+template <typename T, typename... Targs>
+void println(Sink* out, const char* fmt, const T& value, Targs&&... Args) {
+    auto& buf = details::line_buffer();
+    println<>(&buf, fmt, value, Args...);
+    const auto& line = buf.str();
+    out->write(line.data(), line.size());
+}
+//@}
+
+
+//@{ Output to terminal (actually, to the current sink)
 template <typename T>
 void print(const T& arg) {
-    std::cout << arg;
+    print<>(sink(), arg);
 }
 
 template <typename T, typename... Targs>
 void print(const char* fmt, const T& value, Targs&&... Args) {
-    print<>(&std::cout, fmt, value, Args...);
+    print<>(sink(), fmt, value, Args...);
 }
 
 template <typename T>
 void println(const T& arg) {
-    println<>(&std::cout, arg);
+    println<>(sink(), arg);
 }
 template <typename T, typename... Targs>
 void println(const char* fmt, const T& value, Targs&&... Args) {
-    println<>(&std::cout, fmt, value, Args...);
+    println<>(sink(), fmt, value, Args...);
 }
 //@}
 
@@ -315,10 +702,6 @@ public:
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 #if !defined(__TEC_WINDOWS__)
 
-#include <unistd.h>
-#include <pwd.h>
-
-
 //! Returns a computer name or empty string on failure.
 //! Use UTF-8 for non-English encoding.
 inline std::string getcomputername() {
@@ -0,0 +1,1020 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_wal.hpp
+ *   @brief Write-ahead log and a crash-safe Worker mailbox.
+ *
+ *  Wal is an append-only log of records in a directory of mmap'd
+ *  segment files. Appends are made durable by commit() with group
+ *  commit: one caller syncs for every record appended so far, the
+ *  others wait for it. A checkpoint file remembers the last record
+ *  consumed; records after it are replayed by the next open().
+ *
+ *  DurableWorker logs each message before send() returns and replays
+ *  the unprocessed ones on start, before any new message:
+ *
+ *  @code
+ *  tec::WalParams wp;
+ *  wp.dir = "/var/lib/mydaemon/orders";
+ *  auto wal = tec::Wal::open(wp);
+ *  if( !wal ) {
+ *      return wal.error();
+ *  }
+ *  OrderWorker worker(params, std::move(*wal));  // Replays.
+ *  worker.run();
+ *  worker.send(order);                            // Durable on return.
+ *  @endcode
+ *
+ *  Delivery is exactly once across a crash of the process, provided
+ *  process() was not interrupted, and at least once across a power
+ *  loss: the checkpoint is synced lazily. Linux only.
+ *
+ *  Cost: a page of the mapping takes a write fault when first written
+ *  after a sync, and a commit takes one msync(), shared by the batch
+ *  and by concurrent send() callers; WalParams::commit_delay widens the group at the
+ *  price of latency. Measured by bench_wal with 56-byte messages on
+ *  one CPU and a virtio disk, ns per message:
+ *
+ *    in-memory Worker            150
+ *    wal, no sync, batch 256     310  (2.1x)
+ *    wal + sync, batch 256       870  (5.8x)
+ *    wal + sync, batch 4096      410  (2.7x)
+ *
+ *  Synced batches do not get within 2x of in-memory there; the gap
+ *  narrows with the batch size and with a faster device flush.
+ *
+*/
+
+#pragma once
+
+#if !defined(__linux__)
+#error "tec_wal.hpp requires Linux."
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#endif
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_utils.hpp"
+#include "tec/tec_expected.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_thread.hpp"
+#include "tec/tec_worker.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                           Parameters
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct WalParams {
+    static constexpr size_t kDefaultSegmentSize{16 * 1024 * 1024};
+    static constexpr bool kDefaultSync{true};
+    static constexpr MicroSec kDefaultCommitDelay{0};
+
+    //! Directory of the log, created if missing.
+    std::string dir;
+    //! Size of a segment file; a record must fit in one.
+    size_t segment_size;
+    //! commit() syncs to the device; if false, the log survives a crash
+    //! of the process but not of the machine.
+    bool sync;
+    //! How long a commit waits for more records to join its batch.
+    MicroSec commit_delay;
+    //! Labels metrics. Default is "wal".
+    std::string name;
+
+    WalParams()
+        : segment_size{kDefaultSegmentSize}
+        , sync{kDefaultSync}
+        , commit_delay{kDefaultCommitDelay}
+        , name{"wal"}
+    {}
+};
+
+
+/**
+ * @brief      Serializes messages of type T into log records.
+ *
+ * @details    Trivially copyable messages are stored as is.
+ * Specialize for other types:
+ *
+ * @code
+ * template <> struct tec::WalCodec<Order> {
+ *     static size_t size(const Order& o);
+ *     static void encode(const Order& o, void* dst);        // size(o) bytes.
+ *     static bool decode(const void* src, size_t len, Order& o);
+ * };
+ * @endcode
+ */
+template <typename T, typename = void>
+struct WalCodec;
+
+template <typename T>
+struct WalCodec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>> {
+    static size_t size(const T&) { return sizeof(T); }
+
+    static void encode(const T& msg, void* dst) {
+        std::memcpy(dst, &msg, sizeof(T));
+    }
+
+    static bool decode(const void* src, size_t len, T& msg) {
+        if( len != sizeof(T) ) {
+            return false;
+        }
+        std::memcpy(&msg, src, sizeof(T));
+        return true;
+    }
+};
+
+
+namespace details {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                             CRC-32C
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+inline uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t len) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for( uint32_t i = 0; i < 256; ++i ) {
+            uint32_t c = i;
+            for( int k = 0; k < 8; ++k ) {
+                c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    while( len-- ) {
+        crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_hw(uint32_t crc, const unsigned char* p, size_t len) {
+    uint64_t c = crc;
+    for( ; len >= 8; p += 8, len -= 8 ) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = static_cast<uint32_t>(c);
+    while( len-- ) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+//! CRC-32C (Castagnoli) of `len` bytes, continuing `crc`.
+inline uint32_t crc32c(uint32_t crc, const void* data, size_t len) {
+    const auto* p = static_cast<const unsigned char*>(data);
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+    if( hw ) {
+        return ~crc32c_hw(~crc, p, len);
+    }
+#endif
+    return ~crc32c_sw(~crc, p, len);
+}
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          Log segments
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! At the start of a segment file, records follow at kWalDataOffset.
+struct WalSegmentHeader {
+    static constexpr uint64_t kMagic{0x31304c4157434554}; // "TECWAL01"
+    static constexpr uint32_t kVersion{1};
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t first_seq;
+    uint64_t size;
+};
+
+//! Precedes the payload, padded to 8 bytes. A record is valid if
+//! its `seq` follows the previous one and the CRC of `seq` and the
+//! payload matches; the first invalid record ends the segment.
+struct WalRecordHeader {
+    uint32_t len;
+    uint32_t crc;
+    uint64_t seq;
+};
+
+constexpr size_t kWalDataOffset{64};
+
+constexpr size_t wal_record_size(size_t len) {
+    return sizeof(WalRecordHeader) + ((len + 7) & ~size_t{7});
+}
+
+
+//! A mapped segment file.
+class WalSegment {
+    int fd_;
+    unsigned char* base_;
+    size_t size_;
+
+    WalSegment(int fd, void* base, size_t size, std::string path)
+        : fd_{fd}
+        , base_{static_cast<unsigned char*>(base)}
+        , size_{size}
+        , path{std::move(path)}
+        , first_seq{header()->first_seq}
+        , last_seq{first_seq - 1}
+        , offset{kWalDataOffset}
+        , synced{kWalDataOffset}
+    {}
+
+    WalSegmentHeader* header() { return reinterpret_cast<WalSegmentHeader*>(base_); }
+
+    static Expected<std::shared_ptr<WalSegment>> map(int fd, size_t size, std::string path, int flags = 0) {
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | flags, fd, 0);
+        if( base == MAP_FAILED ) {
+            auto err = errno_result("mmap()");
+            ::close(fd);
+            return err;
+        }
+        return std::shared_ptr<WalSegment>(new WalSegment(fd, base, size, std::move(path)));
+    }
+
+public:
+    std::string path;
+    uint64_t first_seq;
+    //! first_seq - 1 if empty.
+    uint64_t last_seq;
+    //! End of the valid records.
+    size_t offset;
+    //! Synced up to here, see Wal::commit().
+    size_t synced;
+
+    //! Creates the file and allocates its blocks, so that writing
+    //! to the mapping cannot fail for lack of space.
+    static Expected<std::shared_ptr<WalSegment>> create(const std::string& path, size_t size, uint64_t first_seq) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if( fd < 0 ) {
+            return errno_result("open()");
+        }
+        if( int err = ::posix_fallocate(fd, 0, static_cast<off_t>(size)); err != 0 ) {
+            ::close(fd);
+            ::unlink(path.c_str());
+            return errno_result("posix_fallocate()", err);
+        }
+        WalSegmentHeader hdr{WalSegmentHeader::kMagic, WalSegmentHeader::kVersion, 0, first_seq, size};
+        if( ::pwrite(fd, &hdr, sizeof(hdr), 0) != static_cast<ssize_t>(sizeof(hdr)) ) {
+            auto err = errno_result("pwrite()");
+            ::close(fd);
+            ::unlink(path.c_str());
+            return err;
+        }
+        // Prefaulted: appends do not stop on page faults.
+        return map(fd, size, path, MAP_POPULATE);
+    }
+
+    //! Maps an existing segment and finds the end of its valid records.
+    static Expected<std::shared_ptr<WalSegment>> open(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if( fd < 0 ) {
+            return errno_result("open()");
+        }
+        WalSegmentHeader hdr{};
+        struct stat st;
+        if( ::fstat(fd, &st) != 0
+            || ::pread(fd, &hdr, sizeof(hdr), 0) != static_cast<ssize_t>(sizeof(hdr))
+            || hdr.magic != WalSegmentHeader::kMagic
+            || hdr.version != WalSegmentHeader::kVersion
+            || hdr.first_seq == 0
+            || hdr.size != static_cast<uint64_t>(st.st_size) ) {
+            ::close(fd);
+            return Result{format("{}: not a WAL segment", path), Result::Kind::Invalid};
+        }
+        auto seg = map(fd, static_cast<size_t>(hdr.size), path);
+        if( seg ) {
+            (*seg)->offset = (*seg)->scan([](uint64_t, const void*, size_t) {});
+            (*seg)->synced = (*seg)->offset;
+        }
+        return seg;
+    }
+
+    WalSegment(const WalSegment&) = delete;
+    WalSegment& operator=(const WalSegment&) = delete;
+
+    ~WalSegment() {
+        ::munmap(base_, size_);
+        ::close(fd_);
+    }
+
+    size_t size() const { return size_; }
+    size_t room() const { return size_ - offset; }
+
+    //! Calls `fn(seq, data, len)` for each valid record; returns
+    //! the end offset and sets last_seq.
+    template <typename TFunc>
+    size_t scan(TFunc&& fn) {
+        size_t pos{kWalDataOffset};
+        uint64_t seq{first_seq};
+        while( pos + sizeof(WalRecordHeader) <= size_ ) {
+            WalRecordHeader rh;
+            std::memcpy(&rh, base_ + pos, sizeof(rh));
+            if( rh.seq != seq || wal_record_size(rh.len) > size_ - pos ) {
+                break;
+            }
+            const unsigned char* data = base_ + pos + sizeof(rh);
+            if( crc32c(crc32c(0, &rh.seq, sizeof(rh.seq)), data, rh.len) != rh.crc ) {
+                break;
+            }
+            fn(seq, static_cast<const void*>(data), static_cast<size_t>(rh.len));
+            pos += wal_record_size(rh.len);
+            ++seq;
+        }
+        last_seq = seq - 1;
+        return pos;
+    }
+
+    //! Writes a record at `offset`; `write(dst)` fills `len` bytes.
+    template <typename TWrite>
+    void append(uint64_t seq, size_t len, TWrite&& write) {
+        unsigned char* dst = base_ + offset;
+        unsigned char* data = dst + sizeof(WalRecordHeader);
+        write(static_cast<void*>(data));
+        WalRecordHeader rh{static_cast<uint32_t>(len), 0, seq};
+        rh.crc = crc32c(crc32c(0, &rh.seq, sizeof(rh.seq)), data, len);
+        std::memcpy(dst, &rh, sizeof(rh));
+        offset += wal_record_size(len);
+        last_seq = seq;
+    }
+
+    //! Writes [from, to) back to the device.
+    Result sync(size_t from, size_t to) {
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        from &= ~(page - 1);
+        if( ::msync(base_ + from, to - from, MS_SYNC) != 0 ) {
+            return errno_result("msync()");
+        }
+        return {};
+    }
+};
+
+
+//! The checkpoint file.
+struct WalCheckpoint {
+    static constexpr uint64_t kMagic{0x31504b4357434554}; // "TECWCKP1"
+
+    uint64_t magic;
+    //! Last record consumed.
+    std::atomic<uint64_t> consumed;
+};
+
+} // ::details
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Write-ahead log
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      Wal
+ * @brief      A segmented append-only log with group commit.
+ *
+ * @details    Records get consecutive sequence numbers starting at 1.
+ * Segment files are named after their first sequence number and
+ * removed once all their records are consumed. A directory is used
+ * by one Wal at a time, enforced with flock().
+ *
+ * open() starts a new segment, so a torn tail left by a crash is never
+ * written over. Appending and committing are thread-safe.
+ */
+class Wal {
+    WalParams params_;
+    size_t segment_size_;
+    int dir_fd_;
+    int lock_fd_;
+    int ckpt_fd_;
+    details::WalCheckpoint* ckpt_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    //! Oldest first, the last one is appended to.
+    std::vector<std::shared_ptr<details::WalSegment>> segments_;
+    uint64_t last_seq_;
+    uint64_t durable_seq_;
+    //! A commit is syncing.
+    bool syncing_;
+    //! A failed sync leaves the log in an unknown state: no more commits.
+    Result failed_;
+
+    std::shared_ptr<metrics::Counter> m_appended_;
+    std::shared_ptr<metrics::Counter> m_commits_;
+    std::shared_ptr<metrics::Gauge> m_segments_;
+
+    static constexpr size_t kCheckpointSize{4096};
+
+    explicit Wal(const WalParams& params)
+        : params_{params}
+        , segment_size_{0}
+        , dir_fd_{-1}
+        , lock_fd_{-1}
+        , ckpt_fd_{-1}
+        , ckpt_{nullptr}
+        , last_seq_{0}
+        , durable_seq_{0}
+        , syncing_{false}
+        , m_appended_{metrics::registry().instance<metrics::Counter>(
+                "tec_wal_appended_total", "Records appended to the log.",
+                metrics::label("wal", params.name))}
+        , m_commits_{metrics::registry().instance<metrics::Counter>(
+                "tec_wal_commits_total", "Syncs of the log, each covering a group of records.",
+                metrics::label("wal", params.name))}
+        , m_segments_{metrics::registry().instance<metrics::Gauge>(
+                "tec_wal_segments", "Segment files of the log.",
+                metrics::label("wal", params.name))}
+    {}
+
+    std::string segment_path(uint64_t first_seq) const {
+        char name[24];
+        std::snprintf(name, sizeof(name), "%016llx.wal", static_cast<unsigned long long>(first_seq));
+        return params_.dir + "/" + name;
+    }
+
+    Result open_checkpoint() {
+        ckpt_fd_ = ::openat(dir_fd_, "checkpoint", O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if( ckpt_fd_ < 0 ) {
+            return details::errno_result("open(checkpoint)");
+        }
+        struct stat st;
+        if( ::fstat(ckpt_fd_, &st) != 0 ) {
+            return details::errno_result("fstat(checkpoint)");
+        }
+        const bool fresh = (st.st_size == 0);
+        if( fresh && ::ftruncate(ckpt_fd_, kCheckpointSize) != 0 ) {
+            return details::errno_result("ftruncate(checkpoint)");
+        }
+        if( !fresh && st.st_size != static_cast<off_t>(kCheckpointSize) ) {
+            return {"invalid WAL checkpoint", Result::Kind::Invalid};
+        }
+        void* base = ::mmap(nullptr, kCheckpointSize, PROT_READ | PROT_WRITE, MAP_SHARED, ckpt_fd_, 0);
+        if( base == MAP_FAILED ) {
+            return details::errno_result("mmap(checkpoint)");
+        }
+        ckpt_ = static_cast<details::WalCheckpoint*>(base);
+        if( fresh ) {
+            ckpt_->magic = details::WalCheckpoint::kMagic;
+        }
+        else if( ckpt_->magic != details::WalCheckpoint::kMagic ) {
+            return {"invalid WAL checkpoint", Result::Kind::Invalid};
+        }
+        return {};
+    }
+
+    Result load_segments() {
+        std::vector<uint64_t> firsts;
+        const int fd = ::dup(dir_fd_);
+        DIR* dir = fd < 0 ? nullptr : ::fdopendir(fd);
+        if( !dir ) {
+            if( fd >= 0 ) {
+                ::close(fd);
+            }
+            return details::errno_result("opendir()");
+        }
+        while( const dirent* ent = ::readdir(dir) ) {
+            const std::string name{ent->d_name};
+            if( name.size() == 20 && name.compare(16, 4, ".wal") == 0
+                && name.find_first_not_of("0123456789abcdef") == 16 ) {
+                firsts.push_back(std::strtoull(name.substr(0, 16).c_str(), nullptr, 16));
+            }
+        }
+        ::closedir(dir);
+        std::sort(firsts.begin(), firsts.end());
+
+        const uint64_t consumed = ckpt_->consumed.load();
+        for( uint64_t first: firsts ) {
+            auto seg = details::WalSegment::open(segment_path(first));
+            if( !seg ) {
+                return seg.error();
+            }
+            last_seq_ = std::max(last_seq_, (*seg)->last_seq);
+            if( (*seg)->last_seq <= consumed || (*seg)->last_seq < (*seg)->first_seq ) {
+                // Consumed or empty.
+                ::unlink((*seg)->path.c_str());
+                continue;
+            }
+            segments_.push_back(std::move(*seg));
+        }
+        last_seq_ = std::max(last_seq_, consumed);
+        durable_seq_ = last_seq_;
+        return add_segment();
+    }
+
+    //! Starts a segment after the last record.
+    Result add_segment() {
+        auto seg = details::WalSegment::create(segment_path(last_seq_ + 1), segment_size_, last_seq_ + 1);
+        if( !seg ) {
+            return seg.error();
+        }
+        if( params_.sync ) {
+            // The new file must survive together with its records.
+            if( ::fdatasync(dir_fd_) != 0 && ::fsync(dir_fd_) != 0 ) {
+                return details::errno_result("fsync(dir)");
+            }
+        }
+        segments_.push_back(std::move(*seg));
+        m_segments_->set(static_cast<int64_t>(segments_.size()));
+        return {};
+    }
+
+    //! Removes the segments consumed entirely, the last one stays.
+    void reclaim() {
+        const uint64_t consumed = ckpt_->consumed.load(std::memory_order_acquire);
+        auto end = segments_.end() - 1;
+        auto it = segments_.begin();
+        for( ; it != end && (*it)->last_seq <= consumed; ++it ) {
+            // A running commit may still hold the mapping.
+            ::unlink((*it)->path.c_str());
+        }
+        segments_.erase(segments_.begin(), it);
+        m_segments_->set(static_cast<int64_t>(segments_.size()));
+    }
+
+    template <typename TWrite>
+    Expected<uint64_t> append_locked(size_t len, TWrite&& write) {
+        if( len > max_record() ) {
+            return Result{format("WAL record of {} bytes exceeds {}", len, max_record()), Result::Kind::Invalid};
+        }
+        if( !failed_ ) {
+            return failed_;
+        }
+        if( segments_.back()->room() < details::wal_record_size(len) ) {
+            if( auto result = add_segment(); !result ) {
+                return result;
+            }
+            reclaim();
+        }
+        const uint64_t seq = last_seq_ + 1;
+        segments_.back()->append(seq, len, std::forward<TWrite>(write));
+        last_seq_ = seq;
+        if( !params_.sync ) {
+            durable_seq_ = seq;
+        }
+        m_appended_->inc();
+        return seq;
+    }
+
+public:
+    //! Opens the log in `params.dir`, creating it if needed.
+    static Expected<std::unique_ptr<Wal>> open(const WalParams& params) {
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        if( params.dir.empty() ) {
+            return Result{"WalParams::dir is empty", Result::Kind::Invalid};
+        }
+        if( params.segment_size < 2 * page ) {
+            return Result{format("WAL segment size {} is too small", params.segment_size), Result::Kind::Invalid};
+        }
+        std::unique_ptr<Wal> wal(new Wal(params));
+        wal->segment_size_ = (params.segment_size + page - 1) & ~(page - 1);
+
+        if( ::mkdir(params.dir.c_str(), 0755) != 0 && errno != EEXIST ) {
+            return details::errno_result("mkdir()");
+        }
+        wal->dir_fd_ = ::open(params.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if( wal->dir_fd_ < 0 ) {
+            return details::errno_result("open(dir)");
+        }
+        wal->lock_fd_ = ::openat(wal->dir_fd_, "LOCK", O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if( wal->lock_fd_ < 0 ) {
+            return details::errno_result("open(LOCK)");
+        }
+        if( ::flock(wal->lock_fd_, LOCK_EX | LOCK_NB) != 0 ) {
+            if( errno == EWOULDBLOCK ) {
+                return Result{format("WAL {} is in use", params.dir), Result::Kind::RuntimeErr};
+            }
+            return details::errno_result("flock()");
+        }
+        if( auto result = wal->open_checkpoint(); !result ) {
+            return result;
+        }
+        if( auto result = wal->load_segments(); !result ) {
+            return result;
+        }
+        return wal;
+    }
+
+    Wal(const Wal&) = delete;
+    Wal& operator=(const Wal&) = delete;
+
+    ~Wal() {
+        segments_.clear();
+        if( ckpt_ ) {
+            if( params_.sync ) {
+                ::msync(ckpt_, kCheckpointSize, MS_SYNC);
+            }
+            ::munmap(ckpt_, kCheckpointSize);
+        }
+        for( int fd: {ckpt_fd_, lock_fd_, dir_fd_} ) {
+            if( fd >= 0 ) {
+                ::close(fd);
+            }
+        }
+    }
+
+    const WalParams& params() const { return params_; }
+
+    //! Largest record payload.
+    size_t max_record() const {
+        return segment_size_ - details::kWalDataOffset - sizeof(details::WalRecordHeader);
+    }
+
+    /**
+     * @brief      Appends a record of `len` bytes written by `write(void* dst)`.
+     *
+     * @details    The record is written into the mapping in place; it is
+     * durable once commit() returns for its sequence number.
+     *
+     * @return     Expected<uint64_t> The sequence number.
+     */
+    template <typename TWrite>
+    Expected<uint64_t> append(size_t len, TWrite&& write) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return append_locked(len, std::forward<TWrite>(write));
+    }
+
+    //! Holds the log lock to append several records in a row.
+    class Batch {
+        Wal& wal_;
+        std::lock_guard<std::mutex> lk_;
+
+    public:
+        explicit Batch(Wal& wal)
+            : wal_{wal}
+            , lk_{wal.mtx_}
+        {}
+
+        //! See Wal::append().
+        template <typename TWrite>
+        Expected<uint64_t> append(size_t len, TWrite&& write) {
+            return wal_.append_locked(len, std::forward<TWrite>(write));
+        }
+    };
+
+    //! Appends a copy of `len` bytes at `data`.
+    Expected<uint64_t> append(const void* data, size_t len) {
+        return append(len, [data, len](void* dst) { std::memcpy(dst, data, len); });
+    }
+
+    /**
+     * @brief      Returns once the records up to `seq` are durable.
+     *
+     * @details    The first caller to find no sync running syncs every
+     * record appended so far, after waiting WalParams::commit_delay for
+     * more to come; the callers arriving meanwhile wait for it and then
+     * find their records synced, or sync the next group.
+     */
+    Result commit(uint64_t seq) {
+        std::unique_lock<std::mutex> lk(mtx_);
+        while( durable_seq_ < seq ) {
+            if( !failed_ ) {
+                return failed_;
+            }
+            if( syncing_ ) {
+                cv_.wait(lk);
+                continue;
+            }
+            syncing_ = true;
+            if( params_.commit_delay.count() > 0 ) {
+                lk.unlock();
+                std::this_thread::sleep_for(params_.commit_delay);
+                lk.lock();
+            }
+            const uint64_t target = last_seq_;
+            struct Range {
+                std::shared_ptr<details::WalSegment> seg;
+                size_t from;
+                size_t to;
+            };
+            std::vector<Range> ranges;
+            for( auto& seg: segments_ ) {
+                if( seg->synced < seg->offset ) {
+                    ranges.push_back({seg, seg->synced, seg->offset});
+                    seg->synced = seg->offset;
+                }
+            }
+            lk.unlock();
+            Result result;
+            for( auto& r: ranges ) {
+                if( result ) {
+                    result = r.seg->sync(r.from, r.to);
+                }
+            }
+            ranges.clear();
+            m_commits_->inc();
+            lk.lock();
+            syncing_ = false;
+            if( result ) {
+                durable_seq_ = std::max(durable_seq_, target);
+            }
+            else {
+                failed_ = result;
+            }
+            cv_.notify_all();
+        }
+        return {};
+    }
+
+    //! Commits every record appended so far.
+    Result commit() {
+        return commit(last_seq());
+    }
+
+    uint64_t last_seq() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return last_seq_;
+    }
+
+    uint64_t durable_seq() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return durable_seq_;
+    }
+
+    //! Last record consumed.
+    uint64_t consumed() const {
+        return ckpt_->consumed.load(std::memory_order_acquire);
+    }
+
+    //! Marks the records up to `seq` consumed: replay() skips them
+    //! and their segments are removed. A store into the mapped
+    //! checkpoint, synced by the destructor only.
+    void consume(uint64_t seq) {
+        ckpt_->consumed.store(seq, std::memory_order_release);
+    }
+
+    /**
+     * @brief      Calls `fn(seq, data, len)` for each record after the checkpoint.
+     *
+     * @details    Meant for startup, before new records are appended.
+     * @return     size_t Records visited.
+     */
+    template <typename TFunc>
+    size_t replay(TFunc&& fn) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        const uint64_t consumed = ckpt_->consumed.load(std::memory_order_acquire);
+        size_t count{0};
+        for( auto& seg: segments_ ) {
+            seg->scan([&](uint64_t seq, const void* data, size_t len) {
+                if( seq > consumed ) {
+                    fn(seq, data, len);
+                    ++count;
+                }
+            });
+        }
+        return count;
+    }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                         Durable worker
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/**
+ * @class      DurableWorker
+ * @brief      A Worker whose messages are logged in a Wal before send() returns.
+ *
+ * @details    A message reaches the queue once its group is committed,
+ * in log order. After process() returns, the message is marked consumed
+ * in the checkpoint. Messages left unprocessed when the worker stops
+ * or crashes are replayed by the constructor of the next one, ahead
+ * of any new message.
+ *
+ * send_batch() logs a batch with a single commit.
+ */
+template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec,
+          typename TStats = NoStats, typename TCodec = WalCodec<TMessage>>
+class DurableWorker: public Worker<TWorkerParams, TMessage, Duration, TStats> {
+public:
+    using Base = Worker<TWorkerParams, TMessage, Duration, TStats>;
+    using TimerClock = typename Base::TimerClock;
+
+protected:
+    using Envelope = typename Base::Envelope;
+
+private:
+    std::unique_ptr<Wal> wal_;
+
+    //! Logged messages waiting for their commit, in log order.
+    std::mutex mtx_pending_;
+    std::deque<std::pair<uint64_t, TMessage>> pending_;
+
+    //! Worker thread: sequence numbers of the queued messages are the
+    //! replayed ones, then consecutive from next_seq_.
+    std::vector<uint64_t> replayed_;
+    size_t replay_pos_;
+    uint64_t next_seq_;
+    //! The message being processed.
+    uint64_t in_hand_;
+
+    std::shared_ptr<metrics::Counter> m_replayed_;
+
+public:
+    DurableWorker(const TWorkerParams& params, std::unique_ptr<Wal> wal, Launch launch = Launch::Eager)
+        : Base(params, launch)
+        , wal_{std::move(wal)}
+        , replay_pos_{0}
+        , next_seq_{0}
+        , in_hand_{0}
+        , m_replayed_{metrics::registry().instance<metrics::Counter>(
+                "tec_wal_replayed_total", "Messages replayed from the log on start.",
+                metrics::label("worker", this->name_))}
+    {
+        // Records that do not decode are skipped, consumed with the next message.
+        wal_->replay([this](uint64_t seq, const void* data, size_t len) {
+            TMessage msg;
+            if( TCodec::decode(data, len, msg) && Base::send(msg) ) {
+                replayed_.push_back(seq);
+            }
+        });
+        m_replayed_->inc(replayed_.size());
+        next_seq_ = wal_->last_seq() + 1;
+    }
+
+    virtual ~DurableWorker() {
+        // Stop the loop while the overrides below still exist.
+        if( this->thread_.joinable() ) {
+            this->terminate();
+        }
+    }
+
+    /**
+     * @brief      Logs `msg` and waits for its commit.
+     *
+     * @return     false if the worker has stopped or the log failed;
+     * true once the message is durable: it will be processed,
+     * by this worker or after a restart.
+     */
+    bool send(const TMessage& msg) override {
+        if( msg.quit() ) {
+            return Base::send(msg);
+        }
+        if( !this->accepting_.load(std::memory_order_relaxed) ) {
+            return false;
+        }
+        uint64_t seq{0};
+        {
+            std::lock_guard<std::mutex> lk(mtx_pending_);
+            auto appended = wal_->append(TCodec::size(msg), [&msg](void* dst) { TCodec::encode(msg, dst); });
+            if( !appended ) {
+                return false;
+            }
+            seq = *appended;
+            hold(seq, msg);
+        }
+        return commit(seq);
+    }
+
+    //! Logs `msgs` in order with a single commit. On false, the
+    //! messages logged before the failing one are still delivered.
+    bool send_batch(const std::vector<TMessage>& msgs) {
+        if( !this->accepting_.load(std::memory_order_relaxed) ) {
+            return false;
+        }
+        uint64_t seq{0};
+        size_t logged{0};
+        {
+            std::lock_guard<std::mutex> lk(mtx_pending_);
+            Wal::Batch batch(*wal_);
+            for( const auto& msg: msgs ) {
+                auto appended = batch.append(TCodec::size(msg), [&msg](void* dst) { TCodec::encode(msg, dst); });
+                if( !appended ) {
+                    break;
+                }
+                seq = *appended;
+                hold(seq, msg);
+                ++logged;
+            }
+        }
+        if( logged > 0 && !commit(seq) ) {
+            return false;
+        }
+        return logged == msgs.size();
+    }
+
+    Wal& wal() { return *wal_; }
+
+protected:
+    bool next_message(Envelope& env, typename TimerClock::time_point deadline) override {
+        if( in_hand_ != 0 ) {
+            // The previous message has been processed.
+            wal_->consume(in_hand_);
+            in_hand_ = 0;
+        }
+        if( !Base::next_message(env, deadline) ) {
+            return false;
+        }
+        if( !env.quit() ) {
+            if( replay_pos_ < replayed_.size() ) {
+                in_hand_ = replayed_[replay_pos_++];
+                if( replay_pos_ == replayed_.size() ) {
+                    std::vector<uint64_t>().swap(replayed_);
+                    replay_pos_ = 0;
+                }
+            }
+            else {
+                in_hand_ = next_seq_++;
+            }
+        }
+        return true;
+    }
+
+private:
+    //! Called under mtx_pending_, so the queue keeps the log order.
+    //! Without sync an appended message is as durable as it gets.
+    void hold(uint64_t seq, const TMessage& msg) {
+        if( wal_->params().sync ) {
+            pending_.emplace_back(seq, msg);
+        }
+        else {
+            Base::send(msg);
+        }
+    }
+
+    //! Waits for `seq` to be durable, then queues the committed messages.
+    bool commit(uint64_t seq) {
+        if( !wal_->params().sync ) {
+            return true;
+        }
+        if( !wal_->commit(seq) ) {
+            return false;
+        }
+        const uint64_t durable = wal_->durable_seq();
+        std::lock_guard<std::mutex> lk(mtx_pending_);
+        while( !pending_.empty() && pending_.front().first <= durable ) {
+            Base::send(pending_.front().second);
+            pending_.pop_front();
+        }
+        return true;
+    }
+};
+
+
+} // ::tec
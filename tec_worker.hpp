@@ -32,15 +32,29 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "tec/tec_def.hpp" // IWYU pragma: keep
 #include "tec/tec_utils.hpp"
+#include "tec/tec_metrics.hpp"
 #include "tec/tec_queue.hpp"
 #include "tec/tec_semaphore.hpp"
+#include "tec/tec_stopwatch.hpp"
+#include "tec/tec_thread.hpp"
 #include "tec/tec_trace.hpp"
+#include "tec/tec_worker_stats.hpp"
 
 
 namespace tec {
@@ -52,9 +66,68 @@ namespace tec {
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
 struct WorkerParams {
+    //! Worker name, used to label metrics. Default is "worker".
+    std::string name;
+
+    //! CPUs to pin the worker thread to, empty to run anywhere.
+    std::vector<int> cpus;
+    //! Scheduling policy of the worker thread.
+    SchedPolicy sched_policy;
+    //! Real-time priority for SchedPolicy::Fifo and SchedPolicy::RoundRobin.
+    int sched_priority;
+    //! Nice value of the worker thread, unchanged if not set.
+    std::optional<int> nice;
+    //! Thread name, defaults to `name`.
+    std::string thread_name;
+
+    WorkerParams()
+        : sched_policy(SchedPolicy::Inherit)
+        , sched_priority(0)
+    {}
 };
 
 
+namespace details {
+
+template <typename T, typename = void>
+struct has_name: std::false_type {};
+
+template <typename T>
+struct has_name<T, std::void_t<decltype(std::declval<const T&>().name)>>: std::true_type {};
+
+//! Returns `params.name` if TParams has one, otherwise "worker".
+template <typename TParams>
+std::string worker_name(const TParams& params) {
+    if constexpr ( has_name<TParams>::value ) {
+        if( !params.name.empty() ) {
+            return params.name;
+        }
+    }
+    return "worker";
+}
+
+//! Applies WorkerParams thread attributes to the calling thread.
+//! Does nothing for parameters not derived from WorkerParams.
+template <typename TParams>
+Result apply_thread_params(const TParams& params) {
+    if constexpr ( std::is_base_of_v<WorkerParams, TParams> ) {
+        if( auto result = set_thread_name(
+                params.thread_name.empty() ? params.name : params.thread_name); !result ) {
+            return result;
+        }
+        if( auto result = set_thread_affinity(params.cpus); !result ) {
+            return result;
+        }
+        return set_thread_sched(params.sched_policy, params.sched_priority, params.nice);
+    }
+    else {
+        return {};
+    }
+}
+
+} // ::details
+
+
 class Daemon
 {
 public:
@@ -99,26 +172,49 @@ TMessage quit() { TMessage msg; msg.command = Message::QUIT; return msg; }
 *
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec>
+//! When the worker thread is created.
+enum class Launch {
+    Eager,  //!< In the constructor, parked until run().
+    Lazy,   //!< In run(); no OS thread exists for a worker that never runs.
+};
+
+//! TStats is a statistics policy, see tec_worker_stats.hpp.
+template <typename TWorkerParams, typename TMessage = Message, typename Duration = MilliSec,
+          typename TStats = NoStats>
 class Worker: public Daemon {
 
 public:
     using id_t = std::thread::id;
 
+    //! Timers run on the steady clock.
+    using TimerClock = std::chrono::steady_clock;
+    //! Identifies a timer: deadline and sequence number, see start_timer().
+    using TimerId = std::pair<TimerClock::time_point, uint64_t>;
+
 protected:
     using Lock = std::lock_guard<std::mutex>;
+    using Envelope = typename TStats::template Envelope<TMessage>;
 
     //! Worker internal thread.
     std::thread thread_;
     id_t thread_id_;
+    Launch launch_;
+    //! send() accepts messages.
+    std::atomic<bool> accepting_;
 
     //! Signals.
     Signal sig_running_;
     Signal sig_inited_;
     Signal sig_terminated_;
 
+    //! Worker name, see WorkerParams::name.
+    std::string name_;
+
     //! Message queue.
-    SafeQueue<TMessage> mq_;
+    SafeQueue<Envelope> mq_;
+
+    //! Statistics policy.
+    TStats stats_;
 
     //! Worker parameters.
     TWorkerParams params_;
@@ -136,21 +232,47 @@ protected:
     bool flag_terminated_;
     std::mutex mtx_terminated_;
 
+    //! Pending timers, worker thread only.
+    std::map<TimerId, std::function<void()>> timers_;
+    uint64_t timer_seq_;
+
+    //! Standard metrics; per-message counters belong to TStats.
+    std::shared_ptr<metrics::Gauge> m_run_ns_;
+    std::shared_ptr<metrics::Gauge> m_terminate_ns_;
+
 public:
 
     /**
      *  @brief Create the worker thread in the suspended state.
      *
-     *  Use `run()` to start the worker thread.
+     *  Use `run()` to start the worker thread. With Launch::Lazy
+     *  the thread is created by run(), messages sent before are queued.
      *
      *  @sa tec::Worker::run()
      */
-    Worker(const TWorkerParams& params)
-        : thread_{detail<TWorkerParams>::thread_proc, std::ref(*this)}
+    Worker(const TWorkerParams& params, Launch launch = Launch::Eager)
+        : launch_{launch}
+        , accepting_{launch == Launch::Lazy}
+        , name_{details::worker_name(params)}
+        , mq_{name_}
+        , stats_{name_}
         , params_{params}
         , flag_running_{false}
         , flag_terminated_{false}
-    {}
+        , timer_seq_{0}
+        , m_run_ns_{metrics::registry().instance<metrics::Gauge>(
+                "tec_worker_run_duration_ns", "Duration of run(), including init().",
+                metrics::label("worker", name_))}
+        , m_terminate_ns_{metrics::registry().instance<metrics::Gauge>(
+                "tec_worker_terminate_duration_ns", "Duration of terminate(), including finalize().",
+                metrics::label("worker", name_))}
+    {
+        if( launch_ == Launch::Eager ) {
+            // Create the thread when all members are constructed.
+            thread_ = std::thread(detail<TWorkerParams>::thread_proc, std::ref(*this));
+            accepting_ = true;
+        }
+    }
 
     Worker(const Worker&) = delete;
     Worker(Worker&&) = delete;
@@ -164,12 +286,18 @@ public:
     //! Worker thread attribute.
     id_t id() const { return thread_id_; }
 
+    //! Worker name, see WorkerParams::name.
+    const std::string& name() const { return name_; }
+
     //! Result of execution.
     Result result() {
         Lock lk(mtx_result_);
         return result_;
     }
 
+    //! Queue and process statistics, see TStats.
+    typename TStats::Snapshot stats() const { return stats_.snapshot(mq_.size()); }
+
     //! Custom parameters.
     const TWorkerParams& params() const { return params_; }
 
@@ -189,7 +317,18 @@ private:
     }
 
     void send_private(const TMessage& msg) {
-        mq_.enqueue(msg);
+        mq_.enqueue(TStats::wrap(msg));
+    }
+
+    //! Runs the timers that are due.
+    void fire_timers() {
+        const auto now = TimerClock::now();
+        while( !timers_.empty() && timers_.begin()->first.first <= now ) {
+            // The callback may start or cancel timers.
+            auto fn = std::move(timers_.begin()->second);
+            timers_.erase(timers_.begin());
+            fn();
+        }
     }
 
 
@@ -217,11 +356,22 @@ private:
             TEC_TRACE("thread {} created.", worker.id());
             worker.sig_running_.wait();
             TEC_TRACE("`sig_running' received.");
+            if( !worker.flag_running_ ) {
+                // Released by terminate() without run().
+                return;
+            }
 
-            // Initialize the worker and set the result.
-            TEC_TRACE("init() called ...");
-            auto init_result = worker.init();
-            TEC_TRACE("init() returned {}.", init_result);
+            // Apply placement and scheduling, then initialize the worker
+            // and set the result. init() is not called if the former fails.
+            auto init_result = details::apply_thread_params(worker.params_);
+            if( init_result ) {
+                TEC_TRACE("init() called ...");
+                init_result = worker.init();
+                TEC_TRACE("init() returned {}.", init_result);
+            }
+            else {
+                TEC_TRACE("thread attributes failed: {}.", init_result);
+            }
             worker.set_result(init_result);
             if( !init_result) {
                 // If error, send QUIT immediately.
@@ -234,11 +384,28 @@ private:
 
             // Start message polling.
             TEC_TRACE("entering message loop.");
-            TMessage msg;
-            while( worker.mq_.poll(msg) ) {
+            Envelope env;
+            for(;;) {
+                const auto deadline = worker.timers_.empty()
+                    ? TimerClock::time_point::max() : worker.timers_.begin()->first.first;
+                if( !worker.next_message(env, deadline) ) {
+                    // The earliest timer may be due.
+                    worker.fire_timers();
+                    continue;
+                }
+                if( env.quit() ) {
+                    break;
+                }
+                const TMessage& msg = TStats::message(env);
                 TEC_TRACE("received Message [cmd={}].", msg.command);
                 // Process a user-defined message
+                const auto mark = worker.stats_.dispatched(env);
                 worker.process(msg);
+                worker.stats_.done(mark);
+                // Timers must not starve under a steady stream of messages.
+                if( !worker.timers_.empty() ) {
+                    worker.fire_timers();
+                }
             }
             TEC_TRACE("leaving message loop.");
 
@@ -268,17 +435,28 @@ public:
         Lock lk{mtx_running_};
         TEC_ENTER("Worker::run");
 
+        if( flag_running_ ) {
+            TEC_TRACE("WARNING: Worker thread is running already!");
+            return {};
+        }
+
+        if( !accepting_ ) {
+            TEC_TRACE("worker terminated.");
+            return {"worker terminated", Result::Kind::RuntimeErr};
+        }
+
+        BasicStopwatch<MonoClock> sw;
+        if( launch_ == Launch::Lazy && !thread_.joinable() ) {
+            thread_ = std::thread(detail<TWorkerParams>::thread_proc, std::ref(*this));
+            TEC_TRACE("thread created.");
+        }
+
         if( !thread_.joinable() ) {
             // No thread exists, possible system failure.
             TEC_TRACE("no active thread.");
             return {"no active thread", Result::Kind::System};
         }
 
-        if( flag_running_ ) {
-            TEC_TRACE("WARNING: Worker thread is running already!");
-            return {};
-        }
-
         // Resume the thread
         flag_running_ = true;
         sig_running_.set();
@@ -287,6 +465,7 @@ public:
         // Wait for thread init() completed
         TEC_TRACE("waiting for `sig_inited' signalled ...");
         sig_inited_.wait();
+        m_run_ns_->set(static_cast<int64_t>(sw.elapsed()));
 
         return result();
     }
@@ -295,16 +474,16 @@ public:
     /**
      *  @brief  Send a message to the worker thread.
      *
-     *  If no Worker thread exists,
-     *  the message will not be sent, returning `false`.
+     *  If no Worker thread exists (and it is not a lazy worker
+     *  waiting for run()), the message will not be sent, returning `false`.
      *
      *  @param  msg a message to send.
      *  @return bool
      */
     virtual bool send(const TMessage& msg) {
         TEC_ENTER("Worker::send");
-        if( thread_.joinable() ) {
-            mq_.enqueue(msg);
+        if( accepting_.load(std::memory_order_relaxed) ) {
+            stats_.enqueued(mq_.enqueue(TStats::wrap(msg)));
             TEC_TRACE("Message [cmd={}] sent.", msg.command);
             return true;
         }
@@ -320,6 +499,8 @@ public:
      *  Sends Message::QUIT message to the message queue
      *  stopping the message polling, then waits for
      *  `sig_terminated` signalled to close the working thread.
+     *  A worker that has never run is released without calling
+     *  init() or finalize().
      *
      *  Returns a Result of thread initialization.
      *
@@ -334,18 +515,40 @@ public:
             return result();
         }
 
-        if( !thread_.joinable() ) {
-            return {"No active thread", Result::Kind::RuntimeErr};
+        {
+            // A lazy run() creates thread_ under mtx_running_.
+            Lock lk_run{mtx_running_};
+            if( !thread_.joinable() ) {
+                if( launch_ == Launch::Lazy ) {
+                    // Never run, nothing to stop.
+                    accepting_ = false;
+                    flag_terminated_ = true;
+                    return result();
+                }
+                return {"No active thread", Result::Kind::RuntimeErr};
+            }
+            if( !flag_running_ ) {
+                // The thread is parked and has never run: release it
+                // without calling init() or finalize().
+                accepting_ = false;
+                sig_running_.set();
+                thread_.join();
+                flag_terminated_ = true;
+                return result();
+            }
         }
 
         // Send Message::QUIT.
+        BasicStopwatch<MonoClock> sw;
         send(quit<TMessage>());
         TEC_TRACE("QUIT sent.");
 
         // Waits for the thread to finish its execution
         TEC_TRACE("waiting for thread {} to finish ...", id());
         thread_.join();
+        accepting_ = false;
         TEC_TRACE("thread {} finished OK.", id());
+        m_terminate_ns_->set(static_cast<int64_t>(sw.elapsed()));
 
         flag_terminated_ = true;
         return result();
@@ -393,6 +596,52 @@ protected:
         return {};
     }
 
+    /**
+     *  @brief Waits for the next message, called by the message loop.
+     *
+     *  Override to wait on something else as well, see tec_reactor.hpp.
+     *
+     *  @param env Receives the message.
+     *  @param deadline The earliest timer, TimerClock::time_point::max() if none.
+     *  @return false if there is no message yet: due timers fire
+     *  and next_message() is called again.
+     */
+    virtual bool next_message(Envelope& env, TimerClock::time_point deadline) {
+        if( deadline == TimerClock::time_point::max() ) {
+            env = mq_.dequeue();
+            return true;
+        }
+        return mq_.dequeue_until(env, deadline);
+    }
+
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+     *
+     *             Timers, call from the worker thread only
+     *
+     *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    /**
+     *  @brief Calls `fn` on the worker thread after `delay`.
+     *
+     *  Timers fire between messages; pending timers are dropped
+     *  when the message loop quits.
+     *
+     *  @return TimerId to cancel the timer.
+     */
+    template <typename Rep, typename Period>
+    TimerId start_timer(std::chrono::duration<Rep, Period> delay, std::function<void()> fn) {
+        const TimerId id{
+            TimerClock::now() + std::chrono::duration_cast<TimerClock::duration>(delay),
+            ++timer_seq_};
+        timers_.emplace(id, std::move(fn));
+        return id;
+    }
+
+    //! Returns false if the timer has already fired or been cancelled.
+    bool cancel_timer(const TimerId& id) {
+        return timers_.erase(id) > 0;
+    }
+
 }; // ::Worker
 
 
@@ -0,0 +1,222 @@
+/*----------------------------------------------------------------------
+------------------------------------------------------------------------
+Copyright (c) 2022-2025 The Emacs Cat (https://github.com/olddeuteronomy/tec).
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------
+----------------------------------------------------------------------*/
+
+/**
+ *   @file tec_worker_stats.hpp
+ *   @brief Worker statistics policies.
+ *
+ *  A policy is the last template parameter of tec::Worker:
+ *
+ *  - NoStats (default) adds nothing: the queue holds bare messages
+ *    and every hook compiles away.
+ *  - WorkerStats counts messages sent and processed, stamps each
+ *    message at send() and records the time spent in the queue and
+ *    inside process(), plus the queue depth.
+ *
+ *  @code
+ *  using MyWorker = tec::Worker<Params, tec::Message, tec::MilliSec, tec::WorkerStats>;
+ *  ...
+ *  tec::println("wait: {}", worker.stats().queue_wait.summary());
+ *  @endcode
+ *
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tec/tec_def.hpp" // IWYU pragma: keep
+#include "tec/tec_histogram.hpp"
+#include "tec/tec_metrics.hpp"
+#include "tec/tec_stopwatch.hpp"
+
+
+namespace tec {
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                          No statistics
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+struct NoStats {
+    //! Queue element: the message itself.
+    template <typename TMessage>
+    using Envelope = TMessage;
+
+    struct Mark {};
+    struct Snapshot {};
+
+    explicit NoStats(const std::string&) {}
+
+    template <typename TMessage>
+    static TMessage wrap(TMessage msg) { return msg; }
+
+    template <typename TMessage>
+    static const TMessage& message(const TMessage& env) { return env; }
+
+    void enqueued(size_t) {}
+
+    template <typename TMessage>
+    Mark dispatched(const TMessage&) { return {}; }
+
+    void done(Mark) {}
+
+    Snapshot snapshot(size_t) const { return {}; }
+};
+
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*
+*                     Queue and process latency
+*
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+//! WorkerStats values, all latencies are in nanoseconds.
+struct WorkerStatsSnapshot {
+    Histogram queue_wait;  //!< From send() to dispatch.
+    Histogram process;     //!< Inside process().
+    uint64_t sent;         //!< Messages sent.
+    uint64_t processed;    //!< Messages processed.
+    uint64_t depth;        //!< Current queue depth.
+    uint64_t max_depth;    //!< Max queue depth seen by send() since the previous snapshot.
+};
+
+
+/**
+ * @class      WorkerStats
+ * @brief      Records enqueue-to-dispatch and dispatch-to-done latencies.
+ *
+ * @details    Every worker owns its metrics; they are registered in
+ * the metrics registry only to be exported, so workers sharing a name
+ * never mix their values (see metrics::Registry::instance()). The
+ * histograms are exported as `tec_worker_queue_wait_ns` and
+ * `tec_worker_process_ns`, the message counters as
+ * `tec_worker_messages_sent_total` and `tec_worker_messages_processed_total`,
+ * the max depth as `tec_worker_queue_depth_max`, all labelled `worker`.
+ * The max depth is reset by every read: a scrape reports the peak since
+ * the previous scrape, snapshot() the peak since the previous snapshot().
+ * The current depth is exported by the queue itself (`tec_queue_depth`).
+ * Costs two clock reads per message plus one at send().
+ */
+class WorkerStats {
+    double ns_per_tick_;
+    std::shared_ptr<metrics::Counter> m_sent_;
+    std::shared_ptr<metrics::Counter> m_processed_;
+    std::shared_ptr<metrics::Histogram> m_wait_;
+    std::shared_ptr<metrics::Histogram> m_process_;
+
+    //! Peak depth since the previous snapshot() and since the previous scrape.
+    mutable std::atomic<uint64_t> max_depth_;
+    std::atomic<uint64_t> max_depth_scraped_;
+    std::shared_ptr<metrics::Probe> m_max_depth_;
+
+    uint64_t to_ns(uint64_t ticks) const {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick_);
+    }
+
+public:
+    //! A message stamped at send().
+    template <typename TMessage>
+    struct Envelope {
+        TMessage msg;
+        uint64_t sent;
+
+        bool quit() const { return msg.quit(); }
+    };
+
+    //! Dispatch time.
+    using Mark = uint64_t;
+    using Snapshot = WorkerStatsSnapshot;
+
+    explicit WorkerStats(const std::string& name)
+        : ns_per_tick_{FastClock::ns_per_tick()}
+        , m_sent_{metrics::registry().instance<metrics::Counter>(
+                "tec_worker_messages_sent_total", "Messages sent to the worker.",
+                metrics::label("worker", name))}
+        , m_processed_{metrics::registry().instance<metrics::Counter>(
+                "tec_worker_messages_processed_total", "Messages processed by the worker.",
+                metrics::label("worker", name))}
+        , m_wait_{metrics::registry().instance<metrics::Histogram>(
+                "tec_worker_queue_wait_ns", "Time from send() to dispatch.",
+                metrics::label("worker", name))}
+        , m_process_{metrics::registry().instance<metrics::Histogram>(
+                "tec_worker_process_ns", "Time inside process().",
+                metrics::label("worker", name))}
+        , max_depth_{0}
+        , max_depth_scraped_{0}
+        , m_max_depth_{metrics::registry().probe(
+                metrics::Type::Gauge, "tec_worker_queue_depth_max",
+                "Max queue depth seen by send() since the previous scrape.",
+                metrics::label("worker", name),
+                [this] { return static_cast<int64_t>(max_depth_scraped_.exchange(0, std::memory_order_relaxed)); })}
+    {}
+
+    WorkerStats(const WorkerStats&) = delete;
+    WorkerStats& operator=(const WorkerStats&) = delete;
+
+    ~WorkerStats() {
+        m_max_depth_->detach();
+    }
+
+    template <typename TMessage>
+    static Envelope<TMessage> wrap(TMessage msg) {
+        return {std::move(msg), FastClock::ticks()};
+    }
+
+    template <typename TMessage>
+    static const TMessage& message(const Envelope<TMessage>& env) { return env.msg; }
+
+    void enqueued(size_t depth) {
+        m_sent_->inc();
+        metrics::details::atomic_max(max_depth_, depth);
+        metrics::details::atomic_max(max_depth_scraped_, depth);
+    }
+
+    template <typename TMessage>
+    Mark dispatched(const Envelope<TMessage>& env) {
+        const uint64_t now = FastClock::ticks();
+        m_wait_->record(now > env.sent ? to_ns(now - env.sent) : 0);
+        return now;
+    }
+
+    void done(Mark mark) {
+        const uint64_t now = FastClock::ticks();
+        m_process_->record(now > mark ? to_ns(now - mark) : 0);
+        m_processed_->inc();
+    }
+
+    Snapshot snapshot(size_t depth) const {
+        return {m_wait_->snapshot(), m_process_->snapshot(),
+                m_sent_->value(), m_processed_->value(), depth,
+                max_depth_.exchange(0, std::memory_order_relaxed)};
+    }
+};
+
+
+} // ::tec